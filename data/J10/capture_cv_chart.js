@@ -5,11 +5,30 @@ let Ctxt = document.getElementById("myChart").getContext("2d");
 
 let timeMs = 0.0;
 let periodMs = 0.5;
-let iScale = 0.05;
+let lsbHi = 0.05; // nominal mA per LSB of each range, replaced by the device's 8888 calibration reply
+let lsbLo = 0.002381;
+let iScale = lsbHi;
 let vScale = 0.00125;
+let channels = 3; // samples carry shunt (bit 0), bus (bit 1), power (bit 2) and/or marker (bit 3) words
+let nMarkers = 0; // marker inputs in the marker word, from the high byte of the 1112 channels word
+let preTrigSamples = 0; // pretrigger capture : samples before the trigger, plotted at negative time
+let nDev = 1; // multi INA226 capture (1113) : devices per sample, device 0 is plotted in Data_mA / Data_V
+let devNames = []; // "I2C<bus> 0x<addr>" of each device
+let devIScale = []; // mA per LSB of each device, 2.5uV / shunt
+let Data_Extra = []; // [mA[], V[]] of devices 1..nDev-1
+let customPeriodUs = 0; // sample period of the custom configuration, from the 6666 reply
+let decimFactor = 0; // decimated capture (1114) : samples per record, 0 = every sample is sent
+let decimMode = 0; // 0 : min/max/avg envelope records, 1 : LTTB records (one real sample per bucket)
+let decimRecord = 0; // records received, record k covers samples k * decimFactor ...
+let packed = false; // packed gated capture (1115) : samples arrive as compressed 2227 blocks
+let packedBlank = 0; // packed capture : samples left in the blanking interval after an auto range switch
+let segRows = ""; // segmented gated capture : one table row per gate window (2226)
 let Time = [];
 let Data_mA = [];
 let Data_V = [];
+let Data_mW = []; // power channel (channels bit 2), computed on the device
+let Data_Env = [[], [], [], []]; // envelope records : mA max, mA min, V max, V min (Data_mA / Data_V hold the averages)
+let Data_Mk = []; // one array per marker input (channels bit 3), level 0/1 drawn at an offset of 1.5 per input
 
 for(let inx = 0; inx < 1000; inx++){
 	Time.push(periodMs*inx);
@@ -39,7 +58,7 @@ function new_chart() {
 			borderColor: "rgb(34, 73, 228)",
 			data: Data_V,        
 			cubicInterpolationMode: 'monotone',
-			}],
+			}].concat(extra_datasets(), power_datasets(), marker_datasets(), envelope_datasets()),
 		},
 	options: {
 		animation: {
@@ -63,12 +82,131 @@ function new_chart() {
 				ticks : {
 					color: "rgb(34, 73, 228)"
 					}
+				},
+			mW : {
+				type: 'linear',
+				position: 'right',
+				display: (channels & 4) != 0,
+				grid: {
+					drawOnChartArea: false
+					},
+				ticks : {
+					color: "rgb(30, 150, 60)"
+					}
+				},
+			DI : {
+				type: 'linear',
+				position: 'right',
+				display: nMarkers > 0,
+				min: -0.5,
+				max: 1.5 * nMarkers,
+				grid: {
+					drawOnChartArea: false
+					},
+				ticks : {
+					display: false
+					}
 				}
 			}    
 		},  
 	});
 }
 
+// additional devices of a multi INA226 capture share the mA and V axes
+function extra_datasets() {
+	let sets = [];
+	for (let d = 1; d < nDev; d++) {
+		let hue = (d * 57) % 360;
+		sets.push({
+			label: 'mA ' + devNames[d],
+			yAxisID: 'mA',
+			backgroundColor: "hsl(" + hue + ", 70%, 45%)",
+			borderColor: "hsl(" + hue + ", 70%, 45%)",
+			data: Data_Extra[d - 1][0],
+			cubicInterpolationMode: 'monotone',
+			});
+		sets.push({
+			label: 'V ' + devNames[d],
+			yAxisID: 'V',
+			backgroundColor: "hsl(" + hue + ", 70%, 70%)",
+			borderColor: "hsl(" + hue + ", 70%, 70%)",
+			borderDash: [4, 2],
+			data: Data_Extra[d - 1][1],
+			cubicInterpolationMode: 'monotone',
+			});
+		}
+	return sets;
+	}
+
+// power channel of a single device capture, on its own axis
+function power_datasets() {
+	if (!(channels & 4)) {
+		return [];
+		}
+	return [{
+		label: 'mW',
+		yAxisID: 'mW',
+		backgroundColor: "rgb(30, 150, 60)",
+		borderColor: "rgb(30, 150, 60)",
+		data: Data_mW,
+		cubicInterpolationMode: 'monotone',
+		}];
+	}
+
+// digital marker inputs sampled with each reading, drawn as stepped traces stacked on their own axis
+function marker_datasets() {
+	let sets = [];
+	for (let k = 0; k < nMarkers; k++) {
+		let hue = 30 + k * 80;
+		sets.push({
+			label: 'M' + k,
+			yAxisID: 'DI',
+			backgroundColor: "hsl(" + hue + ", 60%, 40%)",
+			borderColor: "hsl(" + hue + ", 60%, 40%)",
+			data: Data_Mk[k],
+			stepped: true,
+			});
+		}
+	return sets;
+	}
+
+// min/max band of envelope records, filled between the max and min traces
+function envelope_datasets() {
+	if ((decimFactor == 0) || (decimMode != 0)) {
+		return [];
+		}
+	return [{
+		label: 'mA max',
+		yAxisID: 'mA',
+		backgroundColor: "rgba(209, 20, 61, 0.2)",
+		borderColor: "rgba(209, 20, 61, 0.4)",
+		data: Data_Env[0],
+		fill: '+1',
+		},
+		{
+		label: 'mA min',
+		yAxisID: 'mA',
+		backgroundColor: "rgba(209, 20, 61, 0.2)",
+		borderColor: "rgba(209, 20, 61, 0.4)",
+		data: Data_Env[1],
+		},
+		{
+		label: 'V max',
+		yAxisID: 'V',
+		backgroundColor: "rgba(34, 73, 228, 0.2)",
+		borderColor: "rgba(34, 73, 228, 0.4)",
+		data: Data_Env[2],
+		fill: '+1',
+		},
+		{
+		label: 'V min',
+		yAxisID: 'V',
+		backgroundColor: "rgba(34, 73, 228, 0.2)",
+		borderColor: "rgba(34, 73, 228, 0.4)",
+		data: Data_Env[3],
+		}];
+	}
+
 // Chart Handling
 
 function init_sliders() {
@@ -114,6 +252,23 @@ function update_chart() {
 	ChartInst.data.labels = time_slice;
 	ChartInst.data.datasets[0].data = data_mA_slice;
 	ChartInst.data.datasets[1].data = data_V_slice;
+	for (let d = 1; d < nDev; d++) {
+		ChartInst.data.datasets[2 * d].data = Data_Extra[d - 1][0].slice(min_index, max_index);
+		ChartInst.data.datasets[2 * d + 1].data = Data_Extra[d - 1][1].slice(min_index, max_index);
+		}
+	let data_mW_slice = [];
+	if (channels & 4) {
+		data_mW_slice = Data_mW.slice(min_index, max_index);
+		ChartInst.data.datasets[2 * nDev].data = data_mW_slice;
+		}
+	for (let k = 0; k < nMarkers; k++) {
+		ChartInst.data.datasets[2 * nDev + ((channels >> 2) & 1) + k].data = Data_Mk[k].slice(min_index, max_index);
+		}
+	if ((decimFactor > 0) && (decimMode == 0)) {
+		for (let e = 0; e < 4; e++) {
+			ChartInst.data.datasets[2 + e].data = Data_Env[e].slice(min_index, max_index);
+			}
+		}
 	ChartInst.update(0); // no animation
 
 	let iAvg = 0.0;
@@ -122,18 +277,42 @@ function update_chart() {
 	let iMin = 9999999.0;
 	let vMax = -9999999.0;
 	let vMin = 9999999.0;
+	let iCount = 0;
+	let vCount = 0;
 	for(let t = 0; t < time_slice.length ; t++){
-		let i = parseFloat(data_mA_slice[t]);
-		let v = parseFloat(data_V_slice[t]);
-		iAvg = iAvg + i;
-		vAvg = vAvg + v;
-		if (i > iMax) iMax = i;
-		if (v > vMax) vMax = v;
-		if (i < iMin) iMin = i;
-		if (v < vMin) vMin = v;
+		// a channel left out of the capture is stored as null
+		if (data_mA_slice[t] !== null) {
+			let i = parseFloat(data_mA_slice[t]);
+			iAvg = iAvg + i;
+			if (i > iMax) iMax = i;
+			if (i < iMin) iMin = i;
+			iCount++;
+			}
+		if (data_V_slice[t] !== null) {
+			let v = parseFloat(data_V_slice[t]);
+			vAvg = vAvg + v;
+			if (v > vMax) vMax = v;
+			if (v < vMin) vMin = v;
+			vCount++;
+			}
 		}  
-	iAvg = iAvg/time_slice.length;
-	vAvg = vAvg/time_slice.length;
+	iAvg = iAvg/iCount;
+	vAvg = vAvg/vCount;
+
+	// power of each sample, so the max is the true peak and not iMax * vMax
+	let pAvg = 0.0;
+	let pMax = -9999999.0;
+	let pMin = 9999999.0;
+	let pCount = 0;
+	for (let t = 0; t < data_mW_slice.length; t++) {
+		if (data_mW_slice[t] !== null) {
+			let p = data_mW_slice[t];
+			pAvg = pAvg + p;
+			if (p > pMax) pMax = p;
+			if (p < pMin) pMin = p;
+			pCount++;
+			}
+		}
 	
 	let displayElement = document.getElementsByClassName("rangeValues")[0];
 	displayElement.innerHTML = "[" + min + "," + max + "]mS";
@@ -145,6 +324,10 @@ function update_chart() {
 		"avg : " + vAvg.toFixed(3) + "V<br>" +
 		"min : " + vMin.toFixed(3) + "V<br>" +
 		"max : " + vMax.toFixed(3) + "V";
+	document.getElementById("pstats").innerHTML = (pCount == 0) ? "" :
+		"avg : " + (pAvg/pCount).toFixed(3) + "mW<br>" +
+		"min : " + pMin.toFixed(3) + "mW<br>" +
+		"max : " + pMax.toFixed(3) + "mW";
 	}	
 
 
@@ -182,6 +365,10 @@ function init_web_socket() {
 
 function on_ws_open(event) {
     console.log('Connection opened');
+	// the energy integrator keeps running across reconnects, ask for its totals
+	websocket.send(JSON.stringify({"action" : "cv_integrate", "op" : "status"}));
+	websocket.send(JSON.stringify({"action" : "cv_calib", "op" : "status"}));
+	websocket.send(JSON.stringify({"action" : "cv_mem"}));
 	}
 
 function on_ws_close(event) {
@@ -190,30 +377,170 @@ function on_ws_close(event) {
 	}
 
 
+// start frame period word : microseconds, or negative milliseconds for periods over 32767us
+function period_ms(word) {
+	return word < 0 ? -word : parseFloat(word)/1000.0;
+	}
+
+// append samples starting at view[start], laid out according to channels
+// the first blank samples follow an auto range switch and have no valid current
+function push_samples(view, start, blank = 0) {
+	if (decimFactor > 0) {
+		push_records(view, start);
+		return;
+		}
+	let words = ((channels & 1) + ((channels >> 1) & 1) + ((channels >> 2) & 1) + ((channels >> 3) & 1)) * nDev;
+	let len = Math.floor((view.length - start) / words);
+	for(let t = 0; t < len; t++){
+		let w = start + words*t;
+		// multi capture : (shunt, bus) of devices 1..nDev-1 follow device 0
+		for (let d = 1; d < nDev; d++) {
+			Data_Extra[d - 1][0].push(view[w + 2*d] * devIScale[d]);
+			Data_Extra[d - 1][1].push(view[w + 2*d + 1] * vScale);
+			}
+		Time.push(timeMs);
+		if (channels & 1) {
+			Data_mA.push(t < blank ? null : view[w] * iScale);
+			w++;
+			}
+		else {
+			Data_mA.push(null);
+			}
+		if (channels & 2) {
+			Data_V.push(view[w] * vScale);
+			w++;
+			}
+		else {
+			Data_V.push(null);
+			}
+		// power word = shunt * bus / 40000 : 50 current LSBs x 1V
+		if (channels & 4) {
+			Data_mW.push(t < blank ? null : view[w] * 50 * iScale);
+			w++;
+			}
+		// marker word : bit k = level of marker input k when the conversion completed
+		if (channels & 8) {
+			for (let k = 0; k < nMarkers; k++) {
+				Data_Mk[k].push(((view[w] >> k) & 1) + 1.5 * k);
+				}
+			}
+		timeMs += periodMs;
+		}
+	}
+
+// append decimated records starting at view[start]
+// envelope : [iMin, iMax, iAvg, vMin, vMax, vAvg] per bucket, plotted at the bucket start
+// LTTB : [index in bucket, shunt, bus], a real sample plotted at its own time
+function push_records(view, start) {
+	let words = (decimMode == 1) ? 3 : 6;
+	let len = Math.floor((view.length - start) / words);
+	for (let r = 0; r < len; r++) {
+		let w = start + words*r;
+		if (decimMode == 1) {
+			Time.push(((decimRecord * decimFactor) + view[w]) * periodMs);
+			Data_mA.push(view[w + 1] * iScale);
+			Data_V.push(view[w + 2] * vScale);
+			}
+		else {
+			Time.push(decimRecord * decimFactor * periodMs);
+			Data_Env[1].push(view[w] * iScale);
+			Data_Env[0].push(view[w + 1] * iScale);
+			Data_mA.push(view[w + 2] * iScale);
+			Data_Env[3].push(view[w + 3] * vScale);
+			Data_Env[2].push(view[w + 4] * vScale);
+			Data_V.push(view[w + 5] * vScale);
+			}
+		decimRecord++;
+		}
+	timeMs = decimRecord * decimFactor * periodMs;
+	}
+
+// unpack n - 1 zigzag deltas of width bits, packed LSB first from view[w], into x[1 .. n - 1]
+// returns the number of words read, each channel starts on a word boundary
+function unpack_deltas(view, w, x, n, width) {
+	if (width == 0) {
+		for (let k = 1; k < n; k++) x.push(x[0]);
+		return 0;
+		}
+	let acc = 0, bits = 0, words = 0;
+	let mask = (1 << width) - 1;
+	for (let k = 1; k < n; k++) {
+		while (bits < width) {
+			// at most 15 + 16 bits pending, stays within 32 bit integer ops
+			acc = (acc | ((view[w + words] & 0xFFFF) << bits)) >>> 0;
+			words++;
+			bits += 16;
+			}
+		let z = acc & mask;
+		acc = acc >>> width;
+		bits -= width;
+		x.push((x[k - 1] + ((z >>> 1) ^ -(z & 1))) << 16 >> 16);
+		}
+	return words;
+	}
+
+// append packed records starting at view[start]
+// [2227, n, widths, shunt0, bus0] + shunt deltas + bus deltas : a block of n shunt / bus samples
+// [2224, scale, blank] : auto range switch between blocks, the following samples use the new scale
+function push_packed(view, start) {
+	let w = start;
+	while (w + 3 <= view.length) {
+		if (view[w] == 2224) {
+			iScale = view[w + 1] == 0 ? lsbHi : lsbLo;
+			packedBlank = view[w + 2];
+			w += 3;
+			}
+		else
+		if ((view[w] == 2227) && (w + 5 <= view.length)) {
+			let n = view[w + 1];
+			let widths = view[w + 2];
+			let s = [view[w + 3]];
+			let v = [view[w + 4]];
+			w += 5;
+			w += unpack_deltas(view, w, s, n, widths & 0xFF);
+			w += unpack_deltas(view, w, v, n, (widths >> 8) & 0xFF);
+			for (let t = 0; t < n; t++) {
+				Time.push(timeMs);
+				Data_mA.push(packedBlank > 0 ? null : s[t] * iScale);
+				Data_V.push(v[t] * vScale);
+				if (packedBlank > 0) packedBlank--;
+				timeMs += periodMs;
+				}
+			}
+		else {
+			break;
+			}
+		}
+	}
+
 function on_ws_message(event) {
 	let view = new Int16Array(event.data);
 	if ((view.length == 1) && (view[0] == 1234)){
 		document.getElementById("led").innerHTML = "<div class=\"led-red\"></div>";
 		}
 	else 
-	if ((view.length > 3) && (view[0] == 1111)){
-		// new capture tx start
-		periodMs = parseFloat(view[1])/1000.0;
-		iScale = view[2] == 0 ? 0.05 : 0.002381;
+	if (((view.length >= 3) && (view[0] == 1111)) || ((view.length >= 4) && (view[0] == 1112))){
+		// new capture tx start, 1112 states the channels present in each sample
+		periodMs = period_ms(view[1]);
+		iScale = view[2] == 0 ? lsbHi : lsbLo;
+		channels = view[0] == 1112 ? (view[3] & 0xFF) : 3;
+		decimFactor = 0;
+		packed = false;
+		nMarkers = (channels & 8) ? ((view[3] >> 8) & 0xFF) : 0;
+		Data_Mk = [];
+		for (let k = 0; k < nMarkers; k++) {
+			Data_Mk.push([]);
+			}
+		nDev = 1;
+		segRows = "";
+		document.getElementById("segstats").innerHTML = "";
 		ChartInst.destroy();
-		timeMs = 0.0;
+		timeMs = -preTrigSamples * periodMs;
 		Time = [];
 		Data_mA = [];
 		Data_V = [];
-		let len = (view.length - 3) / 2;
-		for(let t = 0; t < len; t++){
-			Time.push(timeMs);
-			let ima = view[2*t+3] * iScale;
-			let v = view[2*t+4] * vScale;
-			Data_mA.push(ima);
-			Data_V.push(v);
-			timeMs += periodMs;
-			} 
+		Data_mW = [];
+		push_samples(view, view[0] == 1112 ? 4 : 3);
 		// ready to receive next data packet 
 	    websocket.send("x");
 		new_chart();
@@ -221,35 +548,415 @@ function on_ws_message(event) {
 		update_chart();
 		}
 	else 
+	if ((view.length >= 4) && (view[0] == 1113) && (view.length >= 4 + 2*view[3])){
+		// multi INA226 capture : [1113, periodUs, scale, nDev, (id, shunt mOhm) x nDev], then nDev (shunt, bus) pairs per sample
+		periodMs = period_ms(view[1]);
+		channels = 3;
+		nMarkers = 0;
+		Data_Mk = [];
+		decimFactor = 0;
+		packed = false;
+		nDev = view[3];
+		devNames = [];
+		devIScale = [];
+		Data_Extra = [];
+		for (let d = 0; d < nDev; d++) {
+			let id = view[4 + 2*d];
+			devNames.push("I2C" + (id >> 8) + " 0x" + (id & 0xFF).toString(16));
+			devIScale.push(2.5 / (view[5 + 2*d] & 0xFFFF));
+			if (d > 0) Data_Extra.push([[], []]);
+			}
+		iScale = devIScale[0];
+		ChartInst.destroy();
+		timeMs = 0.0;
+		Time = [];
+		Data_mA = [];
+		Data_V = [];
+		Data_mW = [];
+		push_samples(view, 4 + 2*nDev);
+		websocket.send("x");
+		new_chart();
+		init_sliders();
+		update_chart();
+		}
+	else
+	if ((view.length >= 5) && (view[0] == 1114)){
+		// decimated capture : [1114, periodUs, scale, factor, mode], then envelope or LTTB records
+		periodMs = period_ms(view[1]);
+		iScale = view[2] == 0 ? lsbHi : lsbLo;
+		channels = 3;
+		nMarkers = 0;
+		Data_Mk = [];
+		nDev = 1;
+		decimFactor = view[3];
+		decimMode = view[4];
+		decimRecord = 0;
+		packed = false;
+		segRows = "";
+		document.getElementById("segstats").innerHTML = "";
+		ChartInst.destroy();
+		timeMs = 0.0;
+		Time = [];
+		Data_mA = [];
+		Data_V = [];
+		Data_mW = [];
+		Data_Env = [[], [], [], []];
+		push_samples(view, 5);
+		websocket.send("x");
+		new_chart();
+		init_sliders();
+		update_chart();
+		}
+	else
+	if ((view.length >= 4) && (view[0] == 1115)){
+		// packed gated capture : [1115, periodUs, scale, blockSamples], then compressed blocks and range records
+		periodMs = period_ms(view[1]);
+		iScale = view[2] == 0 ? lsbHi : lsbLo;
+		channels = 3;
+		nMarkers = 0;
+		Data_Mk = [];
+		nDev = 1;
+		decimFactor = 0;
+		packed = true;
+		packedBlank = 0;
+		segRows = "";
+		document.getElementById("segstats").innerHTML = "";
+		ChartInst.destroy();
+		timeMs = 0.0;
+		Time = [];
+		Data_mA = [];
+		Data_V = [];
+		Data_mW = [];
+		push_packed(view, 4);
+		websocket.send("x");
+		new_chart();
+		init_sliders();
+		update_chart();
+		}
+	else
+	if (packed && (view.length >= 3) && ((view[0] == 2227) || (view[0] == 2224))){
+		// packed capture packet : about one second of compressed blocks
+		push_packed(view, 0);
+		websocket.send("x");
+		init_sliders();
+		update_chart();
+		}
+	else 
 	if ((view.length > 1) && (view[0] == 2222)){
-		let len = (view.length - 1) / 2;
-		for(let t = 0; t < len; t++){
-			Time.push(timeMs);
-			let ima = view[2*t+1] * iScale;
-			let v = view[2*t+2] * vScale;
-			Data_mA.push(ima);
-			Data_V.push(v);
-			timeMs += periodMs;
-			}  
+		push_samples(view, 1);
 		// ready to receive next data packet 
 		websocket.send("x");
 		init_sliders();
 		update_chart();
 		}
+	else
+	if ((view.length >= 3) && (view[0] == 2224)){
+		// auto range switch : [2224, scale, blank], the following samples use the new scale
+		iScale = view[1] == 0 ? lsbHi : lsbLo;
+		push_samples(view, 3, view[2]);
+		websocket.send("x");
+		init_sliders();
+		update_chart();
+		}
+	else
+	if ((view.length >= 6) && (view[0] == 2225)){
+		// segmented gated capture, start of a gate window : [2225, index, startUs bits 0-15, 16-31, 32-47, 48-63]
+		// windows are plotted back to back, their start times are listed in the window table
+		push_samples(view, 6);
+		websocket.send("x");
+		init_sliders();
+		update_chart();
+		}
+	else
+	if ((view.length >= 22) && (view[0] == 2226)){
+		// gate window summary : [2226, index], int64 startUs, int32 [lengthUs, nSamples, iAvgNa, iMinNa, iMaxNa, iRmsNa, vAvgUv, pAvgUw, iGateNa]
+		// lengthUs comes from the gate edge interrupt, iGateNa weights the first / last sample by the part inside the gate
+		let dv = new DataView(event.data);
+		let f = [Number(dv.getBigInt64(4, true))];
+		for (let k = 0; k < 9; k++) {
+			f.push(dv.getInt32(12 + 4*k, true));
+			}
+		segRows += "<tr><td>" + view[1] + "</td><td>" + (f[0] / 1000.0).toFixed(3) + "</td><td>" + (f[1] / 1000.0).toFixed(3) + "</td><td>" + f[2] +
+			"</td><td>" + (f[3] / 1e6).toFixed(3) + "</td><td>" + (f[4] / 1e6).toFixed(3) + "</td><td>" + (f[5] / 1e6).toFixed(3) +
+			"</td><td>" + (f[6] / 1e6).toFixed(3) + "</td><td>" + (f[7] / 1e6).toFixed(3) + "</td><td>" + (f[8] / 1000.0).toFixed(3) +
+			"</td><td>" + (f[9] * f[1] / 1e9).toFixed(3) + "</td></tr>";
+		document.getElementById("segstats").innerHTML = "<table><tr><th>window</th><th>start ms</th><th>length ms</th><th>samples</th>" +
+			"<th>avg mA</th><th>min mA</th><th>max mA</th><th>rms mA</th><th>avg V</th><th>avg mW</th><th>charge uC</th></tr>" + segRows + "</table>";
+		websocket.send("x");
+		}
+	else
+	if ((view.length >= 3) && (view[0] == 2223)){
+		// samples were dropped on the device before this packet (stream ring overflow)
+		let dropped = (view[1] & 0xFFFF) + (view[2] & 0xFFFF) * 65536;
+		console.log("stream gap : " + dropped + " samples dropped");
+		timeMs += dropped * periodMs;
+		push_samples(view, 3);
+		websocket.send("x");
+		init_sliders();
+		update_chart();
+		}
+	else
+	if ((view.length >= 36) && (view[0] == 7777)){
+		// energy report : int32 [7777, running], int64 [elapsedUs, samples, chargeNc HI/LO, energyNj HI/LO],
+		//                 int32 [iMinUa, iMaxUa, vMinMv, vMaxMv]
+		let dv = new DataView(event.data);
+		let running = dv.getInt32(4, true);
+		let elapsedS = Number(dv.getBigInt64(8, true)) / 1000000.0;
+		let chargeNc = Number(dv.getBigInt64(24, true)) + Number(dv.getBigInt64(32, true));
+		let energyNj = Number(dv.getBigInt64(40, true)) + Number(dv.getBigInt64(48, true));
+		let text = (running ? "integrating " : "stopped ") + format_duration(elapsedS) + " : " +
+			(chargeNc / 3600000000.0).toFixed(4) + "mAh (" + (chargeNc / 1000000000.0).toFixed(3) + "C), " +
+			(energyNj / 3600000000.0).toFixed(4) + "mWh";
+		if (elapsedS > 0) {
+			text += ", avg " + (chargeNc / elapsedS / 1000000.0).toFixed(3) + "mA / " + (energyNj / elapsedS / 1000000.0).toFixed(3) + "mW" +
+				", I " + (dv.getInt32(56, true) / 1000.0).toFixed(3) + " .. " + (dv.getInt32(60, true) / 1000.0).toFixed(3) + "mA" +
+				", V " + (dv.getInt32(64, true) / 1000.0).toFixed(3) + " .. " + (dv.getInt32(68, true) / 1000.0).toFixed(3) + "V";
+			}
+		document.getElementById("energy").innerHTML = text;
+		websocket.send("x");
+		}
+	else
+	if ((view.length >= 26) && (view[0] == 8888)){
+		// calibration reply : int32 [8888, status, range, rawQ4, offsetQ4 x3, gainQ16 x3, lsbHiNa, lsbLoNa, lsbBusUv]
+		// the device applies the calibration when it reads a sample, so samples stay in nominal LSBs
+		let info = new Int32Array(event.data);
+		lsbHi = info[10] / 1000000.0;
+		lsbLo = info[11] / 1000000.0;
+		vScale = info[12] / 1000000.0;
+		let names = ["HI", "LO", "Bus"];
+		let text = "";
+		for (let r = 0; r < 3; r++) {
+			text += names[r] + " : offset " + (info[4 + r] / 16.0).toFixed(2) + " LSB, gain " + (info[7 + r] / 65536.0).toFixed(5) + "&nbsp;&nbsp;";
+			}
+		if (info[1] == 1) {
+			text += "<b>saved</b>";
+			}
+		else
+		if (info[1] == 2) {
+			text += "<b>point rejected : gain outside 0.9 .. 1.1 or points too close</b>";
+			}
+		else
+		if (info[1] == 3) {
+			text += "<b>input off scale</b>";
+			}
+		else
+		if (info[1] == 4) {
+			text += "<b>capture in progress, cancel it first</b>";
+			}
+		else
+		if (info[2] >= 0) {
+			text += names[info[2]] + " measured " + (info[3] / 16.0).toFixed(2) + " LSB";
+			}
+		document.getElementById("calinfo").innerHTML = text;
+		websocket.send("x");
+		}
+	else
+	if ((view.length >= 26) && (view[0] == 9999)){
+		// memory reply : int32 [9999, status, blockBytes, nBlocks, budgetKB, reserveBytes, lastBlocks, peakBlocks, maxSamples,
+		//                       freeBytes, largestBytes, minFreeBytes, fragPct]
+		let info = new Int32Array(event.data);
+		let text = "buffer " + info[3] + " x " + (info[2] / 1024) + "KB (" + info[8] + " samples), budget " +
+			(info[4] > 0 ? info[4] + "KB" : "auto") + ", last capture " + info[6] + " blocks, peak " + info[7] +
+			"&nbsp;&nbsp;heap free " + (info[9] / 1024).toFixed(1) + "KB, largest " + (info[10] / 1024).toFixed(1) +
+			"KB, min free " + (info[11] / 1024).toFixed(1) + "KB, fragmentation " + info[12] + "%, reserve " + (info[5] / 1024) + "KB";
+		if (info[1] == 1) {
+			text += "&nbsp;&nbsp;<b>reallocating</b>";
+			setTimeout(function() { websocket.send(JSON.stringify({"action" : "cv_mem"})); }, 1000);
+			}
+		else if (info[1] == 2) {
+			text += "&nbsp;&nbsp;<b>heap below network reserve, lower the budget or free memory</b>";
+			}
+		else if (info[1] == 3) {
+			text += "&nbsp;&nbsp;<b>budget rejected, minimum " + (8 * info[2] / 1024) + "KB (or 0 for auto)</b>";
+			}
+		document.getElementById("meminfo").innerHTML = text;
+		}
+	else
+	if ((view.length >= 20) && (view[0] == 6666)){
+		// configuration reply : int32 [6666, valid, avg, busUs, shuntUs, cfg, convUs, periodUs, i2cUs, i2cLimited,
+		//                              oversample, outPeriodUs, noiseNa, met]
+		let info = new Int32Array(event.data);
+		if (info[1] == 0) {
+			customPeriodUs = 0;
+			document.getElementById("cfginfo").innerHTML = "invalid configuration";
+			}
+		else {
+			let oversample = (info.length >= 14) ? info[10] : 1;
+			customPeriodUs = (info.length >= 14) ? info[11] : info[7];
+			let text = (1000000.0 / customPeriodUs).toFixed(1) + "Hz : ";
+			if (document.getElementById("autoCfg").checked) {
+				// automatic selection : show the chosen configuration
+				text += "avg=" + info[2] + ", adc=" + info[4] + "uS" + (oversample > 1 ? ", x" + oversample + " oversampling" : "") + ", ";
+				}
+			text += "conversion " + info[6] + "uS, period " + info[7] + "uS, I2C " + info[8] + "uS" +
+				(info[9] ? " <b>(I2C limited)</b>" : "");
+			if ((info.length >= 14) && (info[12] > 0)) {
+				text += ", noise " + (info[12] / 1000.0).toFixed(3) + "uA";
+				}
+			if ((info.length >= 14) && (info[13] == 0)) {
+				text += " <b>(target not met)</b>";
+				}
+			document.getElementById("cfginfo").innerHTML = text;
+			}
+		}
 	else		
-	if ((view.length == 1) && (view[0] == 3333)){
-		// tx complete
+	if ((view.length >= 1) && (view[0] == 3333)){
+		// tx complete, followed by int32 capture summary
+		if (view.length >= 12) {
+			let summary = new Int32Array(event.data);
+			document.getElementById("capstats").innerHTML =
+				summary[1] + " samples @ " + summary[2] + "uS, " +
+				"overruns : " + summary[3] + ", " +
+				"late max/avg : " + summary[4] + "/" + summary[5] + "uS, " +
+				"dropped : " + summary[6];
+			if ((view.length >= 36) && (summary[17] != 0)) {
+				// partial result : samples and statistics up to the cancel, or nothing if the gate / trigger never came
+				document.getElementById("capstats").innerHTML += ", <b>" + (summary[17] == 1 ? "cancelled" : "timed out waiting for gate / trigger") + "</b>";
+				if (summary[7] < 0) preTrigSamples = 0;
+				}
+			if ((view.length >= 38) && (summary[18] > 0)) {
+				document.getElementById("capstats").innerHTML += ", " + summary[18] + " gate windows";
+				}
+			if ((view.length >= 50) && (summary[19] > 0)) {
+				// gate length from the gate edge interrupt, charge from the edge weighted average current
+				let text = "<br>gate : " + (summary[19] / 1000.0).toFixed(3) + "ms, " +
+					"charge : " + (summary[24] * summary[19] / 1e9).toFixed(3) + "uC (avg " + (summary[24] / 1e6).toFixed(4) + "mA)";
+				if (summary[18] == 0) {
+					text += ", first sample " + summary[20] + "uS x" + (summary[22] / 1e6).toFixed(3) +
+						", last sample " + (-summary[21]) + "uS x" + (summary[23] / 1e6).toFixed(3);
+					}
+				document.getElementById("capstats").innerHTML += text;
+				}
+			if ((view.length >= 16) && (summary[7] >= 0)) {
+				document.getElementById("capstats").innerHTML += ", trigger at sample " + summary[7];
+				}
+			if ((view.length >= 18) && (summary[8] > 0)) {
+				// failed I2C transfers or missed conversions : some samples are not valid
+				document.getElementById("capstats").innerHTML += ", <b>I2C errors : " + summary[8] + "</b>";
+				}
+			if ((view.length >= 24) && (summary[11] != 0)) {
+				// power of each sample, computed on the device over the whole capture
+				document.getElementById("capstats").innerHTML += ", power min/avg/max : " +
+					(summary[9] / 1000.0).toFixed(3) + "/" + (summary[10] / 1000.0).toFixed(3) + "/" + (summary[11] / 1000.0).toFixed(3) + "mW";
+				}
+			if (view.length >= 34) {
+				// streaming statistics over every captured sample (percentiles from a device histogram)
+				document.getElementById("capstats").innerHTML += "<br>current std/rms : " +
+					(summary[12] / 1e6).toFixed(4) + "/" + (summary[13] / 1e6).toFixed(4) + "mA, " +
+					"p50/p99 : " + (summary[14] / 1e6).toFixed(4) + "/" + (summary[15] / 1e6).toFixed(4) + "mA";
+				if (summary[16] != 0) {
+					document.getElementById("capstats").innerHTML += ", voltage std : " + (summary[16] / 1000.0).toFixed(3) + "mV";
+					}
+				}
+			}
 		init_sliders();
 		//update_chart();
 		document.getElementById("led").innerHTML = "<div class=\"led-green\"></div>";
 		}
 	}
 
+// Custom configuration
+
+// adds the rate/noise target or the custom averaging and conversion times to a cv_capture request
+function add_custom_cfg(jsonObj) {
+	if (document.getElementById("autoCfg").checked) {
+		// the device picks averaging, conversion times and oversampling from its noise table
+		let rate = document.getElementById("targetRate").value;
+		let noise = document.getElementById("targetNoise").value;
+		if (rate != "") jsonObj["rateHz"] = rate;
+		if (noise != "") jsonObj["noiseUa"] = noise;
+		}
+	else
+	if (document.getElementById("customCfg").checked) {
+		jsonObj["avg"] = document.getElementById("cfgAvg").value;
+		jsonObj["busUs"] = document.getElementById("cfgBusUs").value;
+		jsonObj["shuntUs"] = document.getElementById("cfgShuntUs").value;
+		}
+	}
+
+// asks the device for the conversion time and sample period of the custom configuration
+function on_custom_cfg_change() {
+	let auto = document.getElementById("autoCfg").checked;
+	if (!auto && !document.getElementById("customCfg").checked) {
+		customPeriodUs = 0;
+		document.getElementById("cfginfo").innerHTML = "";
+		return;
+		}
+	let shuntOnly = document.getElementById("shuntOnly").checked;
+	let jsonObj = {};
+	jsonObj["action"] = "cv_config";
+	add_custom_cfg(jsonObj);
+	if (auto && (jsonObj["rateHz"] === undefined) && (jsonObj["noiseUa"] === undefined)) {
+		document.getElementById("cfginfo").innerHTML = "enter a rate or noise target";
+		return;
+		}
+	jsonObj["shuntOnly"] = shuntOnly ? "1" : "0";
+	jsonObj["scale"] = document.getElementById("scale").value;
+	// firmware oversampling is only used by the plain timed capture
+	let plain = !shuntOnly && !document.getElementById("stream").checked && !document.getElementById("multi").checked;
+	jsonObj["oversample"] = plain ? "1" : "0";
+	websocket.send(JSON.stringify(jsonObj));
+	}
+
 // Button handling
 
 function init_capture_buttons() {
     document.getElementById("capture").addEventListener("click", on_capture_click);
     document.getElementById("captureGated").addEventListener("click", on_capture_gated_click);
+    document.getElementById("captureTriggered").addEventListener("click", on_capture_triggered_click);
+    document.getElementById("captureCancel").addEventListener("click", function() { websocket.send(JSON.stringify({"action" : "cv_cancel"})); });
+    document.getElementById("integrate").addEventListener("click", on_integrate_click);
+    document.getElementById("integrateStop").addEventListener("click", function() { send_integrate_op("stop"); });
+    document.getElementById("integrateReset").addEventListener("click", function() { send_integrate_op("reset"); });
+    document.getElementById("calPoint0").addEventListener("click", function() { send_calib_op("point", 0); });
+    document.getElementById("calPoint1").addEventListener("click", function() { send_calib_op("point", 1); });
+    document.getElementById("calSave").addEventListener("click", function() { send_calib_op("save"); });
+    document.getElementById("calReset").addEventListener("click", function() { send_calib_op("reset"); });
+    document.getElementById("memStatus").addEventListener("click", function() { websocket.send(JSON.stringify({"action" : "cv_mem"})); });
+    document.getElementById("memApply").addEventListener("click", function() {
+		websocket.send(JSON.stringify({"action" : "cv_mem", "budgetKB" : document.getElementById("memBudget").value}));
+		});
+	}
+
+// Energy integration
+
+function format_duration(seconds) {
+	let s = Math.floor(seconds);
+	let h = Math.floor(s / 3600);
+	let m = Math.floor((s % 3600) / 60);
+	return h + "h " + m + "m " + (s % 60) + "s";
+	}
+
+function on_integrate_click(event) {
+	let jsonObj = {};
+	jsonObj["action"] = "cv_capture";
+	jsonObj["cfgIndex"] = document.getElementById("cfgInx").value;
+	jsonObj["captureSecs"] = "0";
+	jsonObj["scale"] = document.getElementById("scale").value;
+	add_custom_cfg(jsonObj);
+	jsonObj["capture"] = "integrate";
+	jsonObj["reportMs"] = document.getElementById("reportMs").value;
+	websocket.send(JSON.stringify(jsonObj));
+	}
+
+// Calibration
+// point 0 : input at a known value (usually no load / 0V), sets the offset
+// point 1 : known load measured with a reference meter, sets the gain (and the offset together with point 0)
+
+function send_calib_op(op, point) {
+	let jsonObj = {};
+	jsonObj["action"] = "cv_calib";
+	jsonObj["op"] = op;
+	jsonObj["range"] = document.getElementById("calRange").value;
+	if (op == "point") {
+		jsonObj["point"] = point.toString();
+		jsonObj["ref"] = document.getElementById(point == 0 ? "calRef0" : "calRef1").value;
+		}
+	websocket.send(JSON.stringify(jsonObj));
+	}
+
+function send_integrate_op(op) {
+	websocket.send(JSON.stringify({"action" : "cv_integrate", "op" : op}));
 	}
 
 function on_capture_click(event) {
@@ -261,6 +968,32 @@ function on_capture_click(event) {
 	jsonObj["cfgIndex"] = cfgIndex;
 	jsonObj["captureSecs"] = captureSeconds.toString();
 	jsonObj["scale"] = scale;
+	add_custom_cfg(jsonObj);
+	preTrigSamples = 0;
+	// per sample power channel, timed buffer captures only
+	jsonObj["power"] = document.getElementById("power").checked ? "1" : "0";
+	// digital marker inputs recorded with each sample, timed buffer captures only
+	jsonObj["markers"] = document.getElementById("markers").value;
+	// on-device decimation of timed buffer captures : one envelope or LTTB record per N samples
+	let decimate = parseInt(document.getElementById("decimate").value);
+	if (decimate > 1) {
+		jsonObj["decimate"] = decimate.toString();
+		jsonObj["decimMode"] = document.getElementById("decimMode").value;
+		}
+	if (document.getElementById("stream").checked) {
+		jsonObj["capture"] = "stream";
+		}
+	else
+	if (document.getElementById("multi").checked) {
+		// every INA226 found on both I2C buses, time aligned
+		jsonObj["capture"] = "multi";
+		jsonObj["shunts"] = document.getElementById("multiShunts").value;
+		}
+	else
+	if (document.getElementById("shuntOnly").checked) {
+		// shunt-only conversions, no bus voltage, about twice the sample rate
+		jsonObj["capture"] = "shunt";
+		}
     websocket.send(JSON.stringify(jsonObj));
 	// set capture led to red, indicate capturing
 	document.getElementById("led").innerHTML = "<div class=\"led-red\"></div>";
@@ -276,14 +1009,104 @@ function on_capture_gated_click(event) {
 	// set capture seconds to 0 for gated capture
 	jsonObj["captureSecs"] = "0"; 
 	jsonObj["scale"] = scale;
+	add_custom_cfg(jsonObj);
+	jsonObj["timeoutMs"] = (parseFloat(document.getElementById("waitSecs").value) * 1000).toFixed(0);
+	let windows = parseInt(document.getElementById("gateWindows").value);
+	if (windows > 1) {
+		// segmented capture : several gate windows without a round trip in between, the wait limit applies to each window
+		jsonObj["capture"] = "segmented";
+		jsonObj["segments"] = windows.toString();
+		}
+	else
+	if (document.getElementById("packed").checked) {
+		// compressed sample blocks, a longer gate window fits in the same buffer
+		jsonObj["packed"] = "1";
+		}
+	preTrigSamples = 0;
 	websocket.send(JSON.stringify(jsonObj));
 	// set capture led to yellow, indicate waiting for gate
 	document.getElementById("led").innerHTML = "<div class=\"led-yellow\"></div>";
 	}
 	
 
+function on_capture_triggered_click(event) {
+	let cfgIndex = document.getElementById("cfgInx").value;
+	let captureSeconds = document.getElementById("captureSecs").value;
+	let scale = document.getElementById("scale").value;
+	// capture seconds covers the whole window, split into pre and post trigger samples
+	let sampleRate = [2000, 1000, 400][parseInt(cfgIndex)];
+	if ((document.getElementById("customCfg").checked || document.getElementById("autoCfg").checked) && (customPeriodUs > 0)) {
+		sampleRate = 1000000.0 / customPeriodUs;
+		}
+	let total = Math.max(2, Math.floor(parseInt(captureSeconds) * sampleRate));
+	let pre = Math.round(total * parseFloat(document.getElementById("trigPrePct").value) / 100.0);
+	if (pre >= total) pre = total - 1;
+	// hardware trigger : the INA226 alert limit fires the capture, no samples are read before it
+	let hw = document.getElementById("trigHw").checked;
+	if (hw) pre = 0;
+	let jsonObj = {};
+	jsonObj["action"] = "cv_capture";
+	jsonObj["cfgIndex"] = cfgIndex;
+	jsonObj["captureSecs"] = captureSeconds.toString();
+	// pretrigger captures do not switch ranges, Auto is measured on the full range
+	jsonObj["scale"] = (scale == "2") ? "0" : scale;
+	add_custom_cfg(jsonObj);
+	jsonObj["capture"] = "pretrig";
+	jsonObj["trigSrc"] = document.getElementById("trigSrc").value;
+	jsonObj["trigSlope"] = document.getElementById("trigSlope").value;
+	jsonObj["trigLevel"] = document.getElementById("trigLevel").value.toString();
+	jsonObj["trigHyst"] = document.getElementById("trigHyst").value.toString();
+	jsonObj["trigHw"] = hw ? "1" : "0";
+	jsonObj["preSamples"] = pre.toString();
+	jsonObj["postSamples"] = (total - pre).toString();
+	jsonObj["timeoutMs"] = (parseFloat(document.getElementById("waitSecs").value) * 1000).toFixed(0);
+	preTrigSamples = pre;
+	websocket.send(JSON.stringify(jsonObj));
+	// set capture led to yellow, indicate waiting for trigger
+	document.getElementById("led").innerHTML = "<div class=\"led-yellow\"></div>";
+	}
+
+function on_stream_change(checkObject) {
+	let docobj = document.getElementById("captureSecs");
+	if (checkObject.checked) {
+		// streaming capture is not limited by the sample buffer
+		docobj.max = "86400";
+		}
+	else {
+		on_sample_rate_change(document.getElementById("cfgInx"));
+		}
+	// oversampling is not available while streaming
+	on_custom_cfg_change();
+	update_auto_scale();
+	}
+
+// stream, shunt-only, multi and decimated captures cannot switch ranges during the capture,
+// the device measures them on the full 1638mA range when Auto is requested
+function update_auto_scale() {
+	let fixed = document.getElementById("stream").checked || document.getElementById("shuntOnly").checked ||
+		document.getElementById("multi").checked || (parseInt(document.getElementById("decimate").value) > 1);
+	let scale = document.getElementById("scale");
+	document.getElementById("scaleAuto").disabled = fixed;
+	if (fixed && (scale.value == "2")) {
+		scale.value = "0";
+		}
+	}
+
+function on_decimate_change() {
+	update_auto_scale();
+	if (parseInt(document.getElementById("decimate").value) > 1) {
+		// decimated captures hold one record per N samples, the device limits the length to its buffer
+		document.getElementById("captureSecs").max = "3600";
+		}
+	else {
+		on_sample_rate_change(document.getElementById("cfgInx"));
+		}
+	}
+
 function on_sample_rate_change(selectObject) {
 	let value = selectObject.value;  
+	if (document.getElementById("stream").checked) return;
+	if (parseInt(document.getElementById("decimate").value) > 1) return;
 	let docobj = document.getElementById("captureSecs");
 	if (value == "0") {
 		docobj.max = "8";
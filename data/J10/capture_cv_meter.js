@@ -1,5 +1,7 @@
 
-let iScale = 0.05;
+let lsbHi = 0.05; // nominal mA per LSB of each range, replaced by the device's 8888 calibration reply
+let lsbLo = 0.002381;
+let iScale = lsbHi;
 let vScale = 0.00125;
 let offScale = 0;
 let i, v, bgColor;
@@ -53,6 +55,7 @@ function init_web_socket() {
 
 function on_ws_open(event) {
     console.log('Connection opened');
+	websocket.send(JSON.stringify({"action" : "cv_calib", "op" : "status"}));
 	}
 
 function on_ws_close(event) {
@@ -64,12 +67,20 @@ function on_ws_close(event) {
 function on_ws_message(event) {
 	let view = new Int16Array(event.data);
 	if ((view.length == 5) && (view[0] == 4444)){
-		iScale = (view[1] == 0 ? 0.05 : 0.002381);
+		iScale = (view[1] == 0 ? lsbHi : lsbLo);
 		i = view[2] * iScale;
 		v = view[3] * vScale;
 		offScale = view[4];
 		update_meter();
 		} 
+	else
+	if ((view.length >= 26) && (view[0] == 8888)){
+		// calibration reply : the device applies the calibration, samples are in nominal LSBs
+		let info = new Int32Array(event.data);
+		lsbHi = info[10] / 1000000.0;
+		lsbLo = info[11] / 1000000.0;
+		vScale = info[12] / 1000000.0;
+		}
 	// acknowledge packet 
 	websocket.send("x");
 	}
@@ -9,9 +9,16 @@
 #define g_K00_PIN_FET_05hm				19	 // 0.05Ω 샤운트 저항을 제어하는 FET (스위치 역할)
 #define g_K00_PIN_INA226_SDA			22	 // I2C SDA 핀 (INA226 전류 센서와 통신)
 #define g_K00_PIN_INA226_SCL			21	 // I2C SCL 핀 (INA226 전류 센서와 통신)
+#define g_K00_PIN_INA226_SDA1			25	 // 두 번째 I2C 버스 SDA 핀 (추가 INA226 보드, 선택)
+#define g_K00_PIN_INA226_SCL1			26	 // 두 번째 I2C 버스 SCL 핀 (추가 INA226 보드, 선택)
 #define g_K00_PIN_GATE					4	 // 외부 전류 모니터의 게이트 신호를 수신하는 핀
 #define g_K00_PIN_INA226_ALERT			5	 // INA226의 알림 핀 (전류/전압 초과 등 이벤트 발생 시)
 #define g_K00_PIN_LED					14	 // 상태 LED를 제어하는 핀
+#define g_K00_PIN_MARKER_0				16	 // 디지털 마커 입력 0 ~ 3 (DUT 상태 핀 등, 샘플마다 함께 기록)
+#define g_K00_PIN_MARKER_1				17	 // (GPIO_IN_REG 한 번으로 읽도록 모두 GPIO 32 미만)
+#define g_K00_PIN_MARKER_2				23
+#define g_K00_PIN_MARKER_3				27
+#define G_K00_NUM_MARKERS				4	 // 마커 입력 수
 
 
 // 측정 모드 정의
@@ -29,6 +36,15 @@ typedef struct {
 	int		 	scale;		// 측정 스케일 (샤운트 저항 값에 따른 스케일)
 	int		 	nSamples;	// 측정할 샘플의 개수
 	uint32_t 	periodUs;	// 샘플링 주기 (마이크로초 단위)
+	int		 	capture;	// 캡처 방식 (G_K40_INA226_CAPTURE_xxx)
+	int		 	oversample;	// 펌웨어 오버샘플링 (출력 샘플당 변환 결과 읽기 수, 버퍼 캡처만, 1 = 사용 안 함)
+	int		 	channels;	// 추가 샘플 채널 (G_K40_INA226_CH_POWER, G_K40_INA226_CH_MARKER, 시간 지정 버퍼 캡처만, 0 = 션트 + 버스)
+	int		 	markers;	// 기록할 마커 입력 수 (G_K40_INA226_CH_MARKER, 0 ~ G_K00_NUM_MARKERS)
+	uint32_t 	timeoutMs;	// 게이트 또는 트리거 대기 제한 시간 (ms, 0 = 취소할 때까지 대기)
+	int		 	segments;	// 기록할 게이트 창 수 (분할 게이트 캡처, 캡처 후 기록한 창 수)
+	int		 	decimate;	// 데시메이션 배수 (데시메이션 캡처, 레코드당 샘플 수)
+	int		 	decimMode;	// 데시메이션 모드 (G_K51_MODE_ENVELOPE, G_K51_MODE_LTTB)
+	int		 	packed;		// 1 : 샘플을 압축 블록으로 저장/전송 (K52, 게이트 캡처만)
 
 	// 출력 (측정 결과)
 	float 		sampleRate;  // 샘플링 속도 (Hz 단위)
@@ -38,6 +54,14 @@ typedef struct {
 	float 		iavgma;	   // 평균 전류 (mA 단위)
 	float 		imaxma;	   // 최대 전류 (mA 단위)
 	float 		iminma;	   // 최소 전류 (mA 단위)
+	float 		pavgmw;	   // 평균 전력 (mW 단위, 샘플별 전류 x 전압의 평균)
+	float 		pmaxmw;	   // 최대 전력 (mW 단위, 같은 샘플의 전류 x 전압 중 최대)
+	float 		pminmw;	   // 최소 전력 (mW 단위)
+	float 		istdma;	   // 전류 표준편차 (mA 단위, 버퍼 캡처)
+	float 		irmsma;	   // 전류 RMS (mA 단위, 버퍼 캡처)
+	float 		ip50ma;	   // 전류 중앙값 (mA 단위, 히스토그램 근사)
+	float 		ip99ma;	   // 전류 99번째 백분위 (mA 단위, 히스토그램 근사)
+	float 		vstd;	   // 전압 표준편차 (V 단위, 버퍼 캡처)
 } CV_MEASURE_t;
 
 // 주파수 측정을 위한 구조체 정의
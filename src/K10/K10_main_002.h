@@ -33,6 +33,10 @@
 #include "K35_WebSrv_003.h"
 
 #include "K40_ina226_002.h"
+#include "K44_ina226_multi_001.h"
+#include "K46_ina226_energy_001.h"
+#include "K49_ina226_segment_001.h"
+#include "K51_ina226_decimate_001.h"
 #include "K50_nv_data_002.h"
 
 extern K50_OPTIONS_t g_K50_NV_Options; 
@@ -42,8 +46,6 @@ const char*        G_K10_Firmware_Rev = "0.97";
 static const char*     G_K10_TAG  = "K10_main";
 
 // 전역 변수 선언
-volatile int             g_K40_INA226_TxSamples;                           // 웹소켓으로 전송할 샘플 수
-
 extern volatile bool     g_K35_WebSocket_ConnectedFlag;              // 웹소켓 연결 상태 플래그
 extern uint32_t             g_K35_WS_ClientID;                   // 연결된 웹소켓 클라이언트 ID
 
@@ -69,6 +71,7 @@ enum K10_SYSTEM_STATE_TYPE {
 static void K10_wifi_task(void* pvParameter);              // Wi-Fi 태스크
 static void K10_current_voltage_task(void* pvParameter);  // 전류 및 전압 측정 태스크
 static void K10_reset_flags();                              // 플래그 초기화 함수
+static void K10_send_block(const K43_BLOCK_DESC_t& desc);   // 패킷 전송 함수
 
 /*
  * setup 함수: 시스템 초기화 및 태스크 생성
@@ -82,6 +85,10 @@ void K10_init() {
     pinMode(g_K00_PIN_FET_1Ohm, OUTPUT);    // FET 제어 핀 1 (외부 풀다운)
     pinMode(g_K00_PIN_FET_05hm, OUTPUT);    // FET 제어 핀 2 (외부 풀다운)
     pinMode(g_K00_PIN_LED, OUTPUT);    // 상태 LED
+    pinMode(g_K00_PIN_MARKER_0, INPUT_PULLDOWN);    // 디지털 마커 입력 (연결하지 않은 입력은 0)
+    pinMode(g_K00_PIN_MARKER_1, INPUT_PULLDOWN);
+    pinMode(g_K00_PIN_MARKER_2, INPUT_PULLDOWN);
+    pinMode(g_K00_PIN_MARKER_3, INPUT_PULLDOWN);
     digitalWrite(g_K00_PIN_LED, LOW);    // LED 초기 상태 (꺼짐)
 
     // 직렬 포트 초기화
@@ -93,6 +100,7 @@ void K10_init() {
 
     // 저장된 옵션을 불러오기 (Wi-Fi SSID, 비밀번호 등)
     K50_NV_options_load(g_K50_NV_Options);
+    K47_INA226_calib_load();    // 범위별 보정 (없으면 공칭 LSB)
 
     // 기본 측정 모드 설정 (전류/전압 측정)
     g_K10_Measure.mode = G_K00_MEASURE_MODE_CURRENT_VOLTAGE;
@@ -124,14 +132,21 @@ void K10_run() {
  * - 각종 상태 플래그를 초기화하여 통신 및 측정 상태를 리셋
  */
 void K10_reset_flags() {
-    g_K40_INA226_DataReadyFlag      = false;
-    g_K40_INA226_GateOpenFlag      = false;
-    g_K40_INA226_EndCaptureFlag      = false;
-    g_K40_INA226_MeterReadyFlag      = false;
     g_K20_FreqReadyFlag      = false;
     LastPacketAckFlag = false;
 }
 
+/*
+ * 패킷 전송 함수
+ * - 디스크립터가 가리키는 버퍼 영역을 웹소켓으로 보내고 디스크립터를 큐에서 제거 (블록 반환)
+ * - 웹소켓 binary()는 데이터를 복사하므로 전송 직후 캡처 태스크가 블록을 재사용할 수 있음
+ */
+static void K10_send_block(const K43_BLOCK_DESC_t& desc) {
+    LastPacketAckFlag = false;
+    g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t*)(g_K10_Buffer + desc.offset), desc.words * sizeof(int16_t));
+    K43_queue_pop(g_K40_INA226_TxQueue);
+}
+
 void K10_LittleFS_init(){
     // LittleFS 파일 시스템을 마운트 (실패 시 재부팅)
     if (!LittleFS.begin(false)) {
@@ -161,10 +176,9 @@ static void K10_wifi_task(void* pVParameter) {
 
     K10_SYSTEM_STATE_TYPE g_K10_System_State = K10_ST_IDLE;      // 상태 초기화 (대기 상태)
 
-    int          bufferOffset = 0;    // 데이터 버퍼 오프셋 초기화
     int          numBytes;        // 전송할 데이터의 바이트 수
-    volatile int16_t* pb;
     int16_t          msg;
+    K43_BLOCK_DESC_t desc;        // 전송 큐 디스크립터
     uint32_t      t1, t2;  // 전송 시간 측정 변수
     
     K10_reset_flags();       // 상태 플래그 초기화
@@ -184,47 +198,40 @@ static void K10_wifi_task(void* pVParameter) {
                         default:
                             break;
                         case K10_ST_IDLE:                       // 대기 상태
-                            if (g_K40_INA226_MeterReadyFlag == true) {  // 전류/전압 측정 완료 시
-                                g_K40_INA226_MeterReadyFlag      = false;
-                                LastPacketAckFlag   = false;
-                                numBytes            = 5 * sizeof(int16_t);          // 전송할 데이터 크기 (5개의 int16_t 데이터)
-                                g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t*)g_K10_Buffer, numBytes);  // 웹소켓을 통해 클라이언트로 데이터 전송
-                                g_K10_System_State  = K10_ST_METER_COMPLETE;                          // 측정 완료 상태로 전환
-                            } else if (g_K40_INA226_GateOpenFlag) {                              // 게이트가 열렸을 때
-                                g_K40_INA226_GateOpenFlag = false;
+                            if (K43_queue_peek(g_K40_INA226_TxQueue, desc) == false) {
+                                break;
+                            }
+                            if (desc.flags & G_K43_BLOCK_GATE_OPEN) {                            // 게이트가 열렸을 때
+                                K43_queue_pop(g_K40_INA226_TxQueue);
                                 ESP_LOGD(G_K10_TAG, "Socket msg : Capture Gate Open");
                                 msg = G_K40_INA226_MSG_GATE_OPEN;                     // 게이트 열림 메시지
                                 g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t*)&msg, 2);     // 게이트 열림 상태를 클라이언트로 전송
-                            } else if (g_K40_INA226_DataReadyFlag == true) {             // 데이터가 준비된 경우
-                                g_K40_INA226_DataReadyFlag = false;
+                            } else if (desc.flags & G_K43_BLOCK_METER) {                          // 전류/전압 측정 완료 시
+                                K10_send_block(desc);                                             // 5개의 int16_t 데이터 전송
+                                g_K10_System_State  = K10_ST_METER_COMPLETE;                      // 측정 완료 상태로 전환
+                            } else if (desc.flags & G_K43_BLOCK_END) {                            // 데이터 없이 캡처 종료
+                                K43_queue_pop(g_K40_INA226_TxQueue);
+                                t1                 = micros();
+                                LastPacketAckFlag  = true;                                        // 기다릴 ACK 없음
+                                g_K10_System_State = K10_ST_TX_COMPLETE;
+                            } else {                                                              // 캡처 첫 패킷
                                 ESP_LOGD(G_K10_TAG, "Socket msg : Tx Start");
-                                numBytes = (3 + g_K40_INA226_TxSamples * 2) * sizeof(int16_t);  // 전송할 데이터 크기 계산
-                                t1         = micros();                               // 전송 시작 시간 기록
-                                g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t*)g_K10_Buffer, numBytes);   // 데이터 전송
-                                bufferOffset += numBytes / 2;                       // 버퍼 오프셋 업데이트 (샘플 단위)
-                                if (g_K40_INA226_EndCaptureFlag == true) {                       // 캡처가 종료되면
-                                    g_K40_INA226_EndCaptureFlag = false;
-                                    g_K10_System_State           = K10_ST_TX_COMPLETE;  // 전송 완료 상태로 전환
-                                } else {
-                                    g_K10_System_State = K10_ST_TX;    // 계속 전송 상태 유지
-                                }
+                                t1 = micros();                                                    // 전송 시작 시간 기록
+                                K10_send_block(desc);                                             // 데이터 전송
+                                g_K10_System_State = K10_ST_TX;                                   // 전송 상태로 전환
                             }
                             break;
 
                         case K10_ST_TX:                                                           // 데이터 전송 중 상태
-                            if ((g_K40_INA226_DataReadyFlag == true) && (LastPacketAckFlag == true)) {  // 데이터 준비 완료 및 마지막 패킷 ACK 수신
-                                LastPacketAckFlag = false;
-                                g_K40_INA226_DataReadyFlag      = false;
-                                t2                  = micros();                                // 전송 완료 시간 기록
-                                ESP_LOGD(G_K10_TAG, "Socket msg : %dus, Tx ...", t2 - t1);    // 전송 시간 출력
-                                t1         = t2;                                                // 새로운 전송 시간 갱신
-                                pb         = g_K10_Buffer + bufferOffset;                            // 전송할 데이터 버퍼
-                                numBytes = (1 + g_K40_INA226_TxSamples * 2) * sizeof(int16_t);            // 전송할 바이트 수 계산
-                                g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t*)pb, numBytes);                // 웹소켓으로 데이터 전송
-                                bufferOffset += numBytes / 2;                                // 버퍼 오프셋 갱신
-                                if (g_K40_INA226_EndCaptureFlag == true) {                                // 캡처 종료 플래그 확인
-                                    g_K40_INA226_EndCaptureFlag = false;
-                                    g_K10_System_State           = K10_ST_TX_COMPLETE;  // 전송 완료 상태로 전환
+                            if ((LastPacketAckFlag == true) && K43_queue_peek(g_K40_INA226_TxQueue, desc)) {  // 마지막 패킷 ACK 수신 및 다음 디스크립터 준비
+                                if (desc.flags & G_K43_BLOCK_END) {                                // 캡처 종료
+                                    K43_queue_pop(g_K40_INA226_TxQueue);
+                                    g_K10_System_State = K10_ST_TX_COMPLETE;                       // ACK 상태 유지 → 바로 종료 프레임 전송
+                                } else {
+                                    t2 = micros();                                                 // 전송 완료 시간 기록
+                                    ESP_LOGD(G_K10_TAG, "Socket msg : %dus, Tx ...", t2 - t1);    // 전송 시간 출력
+                                    t1 = t2;                                                       // 새로운 전송 시간 갱신
+                                    K10_send_block(desc);                                          // 웹소켓으로 데이터 전송
                                 }
                             }
                             break;
@@ -234,12 +241,11 @@ static void K10_wifi_task(void* pVParameter) {
                                 t2 = micros();
                                 ESP_LOGD(G_K10_TAG, "Socket msg : %dus, Tx ...", t2 - t1);
                                 ESP_LOGD(G_K10_TAG, "Socket msg : Tx Complete");
-                                msg = G_K40_INA226_MSG_TX_COMPLETE;                     // 전송 완료 메시지
-                                g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t*)&msg, 2);     // 클라이언트로 전송 완료 메시지 전송
+                                // 전송 완료 메시지 + 캡처 요약 (캡처 태스크가 종료 디스크립터 전에 작성)
+                                ESP_LOGD(G_K10_TAG, "Capture : %d samples, %d overruns, max late %dus", g_K40_INA226_TxEnd.nSamples, g_K40_INA226_TxEnd.overruns, g_K40_INA226_TxEnd.maxLateUs);
+                                g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t*)&g_K40_INA226_TxEnd, sizeof(g_K40_INA226_TxEnd));     // 클라이언트로 전송 완료 메시지 전송
                                 K10_reset_flags();                             // 플래그 초기화
                                 g_K10_System_State         = K10_ST_IDLE;                     // 대기 상태로 전환
-                                g_K40_INA226_TxSamples     = 0;                         // 전송할 샘플 수 초기화
-                                bufferOffset = 0;                         // 버퍼 오프셋 초기화
                             }
                             break;
 
@@ -283,6 +289,10 @@ static void K10_wifi_task(void* pVParameter) {
         } else {
             // 소켓 연결 해제 시, 상태 및 플래그 초기화
             K10_reset_flags();
+            if ((g_K40_INA226_CaptureState != G_K40_INA226_STATE_IDLE) && (g_K10_Measure.m.cv_meas.capture != G_K40_INA226_CAPTURE_INTEGRATE)) {
+                g_K40_INA226_AbortFlag = true;    // 받을 클라이언트가 없으므로 캡처 중단 (적분은 연결이 끊겨도 계속)
+            }
+            K43_queue_drain(g_K40_INA226_TxQueue);    // 전송 대기 중인 패킷 폐기 (블록 반환)
             g_K10_Measure.mode = G_K00_MEASURE_MODE_INVALID;  // 측정 모드를 무효로 설정
             g_K10_System_State         = K10_ST_IDLE;          // 대기 상태로 전환
         }
@@ -299,9 +309,8 @@ static void K10_current_voltage_task(void* pvParameter) {
     ESP_LOGI(G_K10_TAG, "current_voltage_task running on core %d with priority %d", xPortGetCoreID(), uxTaskPriorityGet(NULL));
     g_K40_INA226_CVCaptureFlag = false;
 
-    // I2C 초기화 (SDA, SCL 핀 설정 및 400kHz로 통신 설정)
-    Wire.begin(g_K00_PIN_INA226_SDA, g_K00_PIN_INA226_SCL);
-    Wire.setClock(400000);
+    // I2C 초기화 (SDA, SCL 핀 설정, G_K42_I2C_BACKEND 백엔드, G_K42_I2C_CLOCK_HZ(기본 400kHz) 클럭)
+    K42_INA226_i2c_begin(g_K00_PIN_INA226_SDA, g_K00_PIN_INA226_SCL);
 
     // INA226 센서 ID 확인
     uint16_t id = K40_INA226_read_reg(G_K40_INA226_REG_ID);
@@ -314,30 +323,67 @@ static void K10_current_voltage_task(void* pvParameter) {
     }
 
     K40_INA226_reset();     // INA226 센서 리셋
+    K40_INA226_measure_i2c();    // 샘플당 I2C 읽기 시간 측정 (설정 주기 검증용)
+
+    // 두 번째 I2C 버스 초기화 및 추가 INA226 검색 (다중 캡처, 연결된 장치가 없어도 동작)
+    K42_INA226_i2c_begin(g_K00_PIN_INA226_SDA1, g_K00_PIN_INA226_SCL1, 1);
+    ESP_LOGI(G_K10_TAG, "INA226 channels = %d", K44_INA226_scan());
+    K44_INA226_multi_begin();
+
+#ifdef G_K42_I2C_BENCH
+    // I2C 백엔드 벤치마크 : 연속 변환 중 션트 + 버스 읽기 시간 측정
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, g_K40_INA226_Config[0].reg | 0x0007);
+    K42_INA226_bench(G_K40_INA226_I2C_ADDR, G_K40_INA226_REG_SHUNT, G_K40_INA226_REG_VBUS, 10000);
+    K40_INA226_reset();
+#endif
 
-    // 최대 할당 가능한 메모리 크기 계산
-    int32_t maxBufferBytes = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
-    ESP_LOGI(G_K10_TAG, "Free memory malloc-able for sample Buffer = %d bytes", maxBufferBytes);
-
-    // 측정 데이터 버퍼 할당
-    g_K10_Buffer = (int16_t*)malloc(maxBufferBytes);
-    if (g_K10_Buffer == nullptr) {
-        ESP_LOGE(G_K10_TAG, "Could not allocate sample Buffer with %d bytes", maxBufferBytes);
+    // 측정 데이터 버퍼 할당 (고정 크기 블록, 네트워크 예비 힙을 남기고 NVS 예산 이내)
+    if (!K53_MEM_begin()) {
+        ESP_LOGE(G_K10_TAG, "Could not allocate sample Buffer");
         ESP_LOGE(G_K10_TAG, "Halting...");
         while (1) {
             vTaskDelay(1);    // 메모리 할당 실패 시 무한 대기
         }
     }
 
-    // 버퍼에 저장할 수 있는 최대 샘플 수 계산
-    g_K40_MaxSamples = (maxBufferBytes - 8) / 4;
-    ESP_LOGI(G_K10_TAG, "Max Samples = %d", g_K40_MaxSamples);
-
     // 측정 루프: CVCaptureFlag가 설정되면 측정 시작
     while (1) {
-        if (g_K40_INA226_CVCaptureFlag == true) {
+        // 예산이 바뀌면 전송 태스크가 버퍼를 다 보낸 뒤 재할당
+        if (g_K53_ResizeFlag && (g_K40_INA226_CVCaptureFlag == false) && (K43_queue_count(g_K40_INA226_TxQueue) == 0)) {
+            K53_MEM_resize();
+        }
+        // 이전 캡처의 패킷이 모두 전송된 뒤 시작 (새 캡처가 버퍼 앞부분부터 덮어쓰므로)
+        if ((g_K40_INA226_CVCaptureFlag == true) && (K43_queue_count(g_K40_INA226_TxQueue) == 0)) {
             g_K40_INA226_CVCaptureFlag = false;
-            if (g_K10_Measure.m.cv_meas.nSamples == 0) {    // 게이트 기반 샘플 캡처
+            g_K40_INA226_AbortFlag     = false;    // 이전 캡처의 취소 요청 제거
+            g_K40_INA226_CaptureState  = G_K40_INA226_STATE_RUNNING;    // 게이트/트리거 대기는 캡처 함수가 WAITING으로 표시
+            K42_INA226_stats_reset();    // 캡처별 I2C 전송 통계
+            K53_MEM_capture_begin();     // 캡처별 블록 사용량
+            if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_PRETRIG) {    // 프리트리거 캡처 (트리거 대기)
+                ESP_LOGD(G_K10_TAG, "Waiting for trigger using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
+                K40_INA226_capture_pretrig(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_INTEGRATE) {    // 에너지/전하 적분 (중지할 때까지)
+                ESP_LOGD(G_K10_TAG, "Integrating using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
+                K46_INA226_integrate(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_CALIB) {    // 보정 점 측정
+                ESP_LOGD(G_K10_TAG, "Measuring calibration point using cfg = 0x%04X", g_K10_Measure.m.cv_meas.cfg);
+                K40_INA226_capture_calib(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_SEGMENTED) {    // 분할 게이트 캡처 (게이트 창 여러 개)
+                ESP_LOGD(G_K10_TAG, "Capturing %d gate windows using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.segments, g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
+                K49_INA226_capture_segmented(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_DECIMATE) {    // 데시메이션 캡처 (긴 캡처)
+                ESP_LOGD(G_K10_TAG, "Capturing %d samples decimated by %d using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.nSamples, g_K10_Measure.m.cv_meas.decimate, g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
+                K51_INA226_capture_decimated(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_MULTI) {  // 다중 INA226 캡처
+                ESP_LOGD(G_K10_TAG, "Capturing %d samples from %d devices using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.nSamples, g_K44_NumChannels, g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
+                K44_INA226_capture_multi(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_SHUNT) {  // 션트 전용 고속 캡처
+                ESP_LOGD(G_K10_TAG, "Capturing %d shunt samples using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.nSamples, g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
+                K40_INA226_capture_buffer_shunt(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.capture == G_K40_INA226_CAPTURE_STREAM) {  // 스트리밍 캡처
+                ESP_LOGD(G_K10_TAG, "Streaming %d samples using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.nSamples, g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
+                K40_INA226_capture_stream(g_K10_Measure, g_K10_Buffer);
+            } else if (g_K10_Measure.m.cv_meas.nSamples == 0) {    // 게이트 기반 샘플 캡처
                 ESP_LOGD(G_K10_TAG, "Capturing gated samples using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
                 K40_INA226_capture_buffer_gated(g_K10_Measure, g_K10_Buffer);
             } else if (g_K10_Measure.m.cv_meas.nSamples == 1) {  // 단일 샘플 캡처 (저속, 고속, 자동 스케일)
@@ -370,6 +416,11 @@ static void K10_current_voltage_task(void* pvParameter) {
                 ESP_LOGD(G_K10_TAG, "Capturing %d samples using cfg = 0x%04X, scale %d", g_K10_Measure.m.cv_meas.nSamples, g_K10_Measure.m.cv_meas.cfg, g_K10_Measure.m.cv_meas.scale);
                 K40_INA226_capture_buffer_triggered(g_K10_Measure, g_K10_Buffer);
             }
+            g_K40_INA226_CaptureState = G_K40_INA226_STATE_IDLE;
+            if (g_K10_Measure.m.cv_meas.nSamples != 1) {
+                K42_INA226_stats_log("capture");    // 미터 측정은 제외
+                K53_MEM_capture_end();
+            }
         }
         vTaskDelay(1);    // 잠시 대기 후 다시 실행
     }
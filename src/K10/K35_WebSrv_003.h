@@ -35,6 +35,19 @@
  *      - `m`: 전류 및 전압 측정 모드 설정
  *      - `f`: 주파수 측정 모드 설정
  *      - `cv_capture`: JSON 형식으로 전송된 명령어로 전류/전압 측정을 캡처
+ *                      power = "1"이면 시간 지정 버퍼 캡처에 샘플별 전력 채널 추가
+ *                      markers = "1" ~ "4"이면 시간 지정 버퍼 캡처에 마커 GPIO 비트필드 채널 추가 (마커 입력 수)
+ *                      decimate = N (2 ~ 1000)이면 시간 지정 버퍼 캡처를 N 샘플마다 레코드 하나로 줄여 전송 (K51)
+ *                      decimMode = "env" (최소/최대/평균, 기본) 또는 "lttb"
+ *                      packed = "1"이면 게이트 버퍼 캡처를 압축 블록으로 저장/전송 (K52, 같은 버퍼로 더 긴 캡처)
+ *                      timeoutMs가 있으면 게이트/트리거 대기 제한 시간 (없으면 취소할 때까지 대기)
+ *                      capture = "segmented"이면 게이트 창 segments개를 한 번에 기록 (K49, 대기 제한은 창마다 적용)
+ *      - `cv_cancel`: 진행 중인 캡처 또는 적분을 중단하고 그때까지의 결과를 보냄 (종료 프레임 status = 취소)
+ *      - `cv_config`: 평균 횟수와 변환 시간으로 INA226 설정과 샘플 주기를 계산하여 응답 (MSG_CFG_INFO)
+ *                     rateHz / noiseUa 목표가 있으면 K45 특성 표로 설정과 오버샘플링 배수를 골라 응답
+ *      - `cv_integrate`: 에너지/전하 적분 중지, 누적기 초기화, 현재 누적값 요청 (K46)
+ *      - `cv_calib`: 범위별 보정 점 측정, 보정 저장/초기화, 현재 보정 표 요청 (K47, MSG_CALIB, 캡처 중 측정/초기화는 거부)
+ *      - `cv_mem`: 샘플 버퍼 블록 사용량과 힙 지표 요청, budgetKB가 있으면 버퍼 예산 저장 후 재할당 (K53, MSG_MEM)
  *      - `oscfreq`: JSON 형식으로 전송된 주파수 측정 설정
  *
  * 5. **전류/전압 및 주파수 측정**
@@ -81,7 +94,12 @@
 // #endif
 
 #include "K40_ina226_002.h"
+#include "K44_ina226_multi_001.h"
+#include "K45_ina226_profile_001.h"
+#include "K46_ina226_energy_001.h"
+#include "K49_ina226_segment_001.h"
 #include "K50_nv_data_002.h"
+#include "K51_ina226_decimate_001.h"
 extern K50_OPTIONS_t g_K50_NV_Options; 
 
 static const char*    G_K35_TAG = "K25_WebSrv_cfg";    // ESP32 로그 태그
@@ -311,6 +329,7 @@ void K35_WebSocket_handle_message(void *arg, uint8_t *data, size_t len) {
             g_K10_Measure.m.cv_meas.cfg       = g_K40_INA226_Config[1].reg;            // 측정 설정
             g_K10_Measure.m.cv_meas.periodUs = g_K40_INA226_Config[1].periodUs;    // 측정 주기 설정
             g_K10_Measure.m.cv_meas.scale       = (int)(data[1] - '0');    // 스케일 설정
+            g_K10_Measure.m.cv_meas.capture     = G_K40_INA226_CAPTURE_BUFFER;
             g_K40_INA226_CVCaptureFlag               = true;                    // 전류/전압 캡처 플래그 설정
         } else if (data[0] == 'f') {
             // 'f' 명령어: 주파수 측정 모드 설정
@@ -338,26 +357,324 @@ void K35_WebSocket_handle_message(void *arg, uint8_t *data, size_t len) {
 
                 int cfgIndex       = strtol(szCfgIndex, NULL, 10);           // 설정 인덱스 변환
                 int captureSeconds = strtol(szCaptureSeconds, NULL, 10);   // 캡처 시간 변환
-                int sampleRate       = 1000000 / g_K40_INA226_Config[cfgIndex].periodUs;  // 샘플링 속도 계산
-                int numSamples       = captureSeconds * sampleRate;           // 총 샘플 수 계산
-                int scale           = strtol(szScale, NULL, 10);               // 스케일 변환
+                uint16_t cfgReg      = g_K40_INA226_Config[cfgIndex].reg;       // 설정 레지스터 값
+                uint32_t periodUs    = g_K40_INA226_Config[cfgIndex].periodUs;  // 샘플링 주기
+                const char *szCapture      = json["capture"];                  // 캡처 방식 (선택 : "stream", "pretrig", "shunt", "multi", "segmented")
+                bool shuntOnly      = (szCapture != NULL) && (strcmp(szCapture, "shunt") == 0);
+
+                // 사용자 설정 (선택) : 평균 횟수와 버스/션트 변환 시간(us)이 모두 있으면 cfgIndex 대신 사용
+                const char *szAvg     = json["avg"];
+                const char *szBusUs   = json["busUs"];
+                const char *szShuntUs = json["shuntUs"];
+                // 자동 선택 (선택) : 출력 샘플 속도(Hz) 또는 전류 노이즈(uA RMS) 목표가 있으면 K45 특성 표로 설정을 고름
+                // 펌웨어 오버샘플링은 시간 지정 버퍼 캡처와 적분만 지원
+                const char *szRateHz  = json["rateHz"];
+                const char *szNoiseUa = json["noiseUa"];
+                int  scale          = strtol(szScale, NULL, 10);               // 스케일 변환
+                int  oversample     = 1;
+                if ((szRateHz != NULL) || (szNoiseUa != NULL)) {
+                    K40_INA226_CFG_INFO_t info;
+                    bool integrate    = (szCapture != NULL) && (strcmp(szCapture, "integrate") == 0);
+                    int maxOversample = (((szCapture == NULL) && (captureSeconds > 0)) || integrate) ? G_K45_MAX_OVERSAMPLE : 1;
+                    if (K45_INA226_select((szRateHz != NULL) ? strtof(szRateHz, NULL) : 0.0f,
+                                          (szNoiseUa != NULL) ? strtof(szNoiseUa, NULL) : 0.0f,
+                                          scale, shuntOnly, maxOversample, info)) {
+                        cfgReg     = (uint16_t)info.cfg;
+                        periodUs   = (uint32_t)info.outPeriodUs;
+                        oversample = info.oversample;
+                    }
+                } else if ((szAvg != NULL) && (szBusUs != NULL) && (szShuntUs != NULL)) {
+                    K40_INA226_CFG_INFO_t info;
+                    if (K40_INA226_config_build(strtol(szAvg, NULL, 10), strtol(szBusUs, NULL, 10), strtol(szShuntUs, NULL, 10), shuntOnly, info)) {
+                        cfgReg   = (uint16_t)info.cfg;
+                        periodUs = (uint32_t)info.periodUs;
+                    } else {
+                        ESP_LOGW(G_K35_TAG, "Invalid config avg %s bus %sus shunt %sus, using cfgIndex %d", szAvg, szBusUs, szShuntUs, cfgIndex);
+                    }
+                } else if (shuntOnly) {
+                    periodUs = K40_INA226_shunt_only_period(cfgReg);    // 션트 전용 : 버스 변환이 없으므로 주기가 짧아짐
+                }
+                // 총 샘플 수 계산 (게이트 캡처는 0, 1초보다 긴 주기에서도 미터 측정(1)으로 바뀌지 않도록 최소 2)
+                int numSamples       = (int)(((int64_t)captureSeconds * 1000000) / periodUs);
+                if ((captureSeconds > 0) && (numSamples < 2)) {
+                    numSamples = 2;
+                }
+                int capture         = G_K40_INA226_CAPTURE_BUFFER;
+                int segments        = 0;
+                if ((szCapture != NULL) && (strcmp(szCapture, "stream") == 0)) {
+                    capture = G_K40_INA226_CAPTURE_STREAM;
+                } else if (shuntOnly) {
+                    // 션트 전용 고속 캡처
+                    capture    = G_K40_INA226_CAPTURE_SHUNT;
+                } else if ((szCapture != NULL) && (strcmp(szCapture, "multi") == 0)) {
+                    // 다중 INA226 캡처 : 추가 채널의 션트 저항 (mΩ, 쉼표로 구분, 채널 1부터)
+                    const char *szShunts = json["shunts"];
+                    if (szShunts != NULL) {
+                        char *next = (char *)szShunts;
+                        for (int ch = 1; (ch < g_K44_NumChannels) && (*next != 0); ch++) {
+                            K44_INA226_set_shunt(ch, strtol(next, &next, 10));
+                            next += (*next == ',') ? 1 : 0;
+                        }
+                    }
+                    capture = G_K40_INA226_CAPTURE_MULTI;
+                } else if ((szCapture != NULL) && (strcmp(szCapture, "integrate") == 0)) {
+                    // 에너지/전하 적분 : 중지할 때까지 실행, reportMs마다 누적값 보고
+                    const char *szReportMs = json["reportMs"];
+                    if (szReportMs != NULL) {
+                        g_K46_ReportMs = strtol(szReportMs, NULL, 10);
+                    }
+                    g_K46_StopFlag = false;
+                    capture        = G_K40_INA226_CAPTURE_INTEGRATE;
+                } else if ((szCapture != NULL) && (strcmp(szCapture, "segmented") == 0)) {
+                    // 분할 게이트 캡처 : 기록할 게이트 창 수
+                    const char *szSegments = json["segments"];
+                    segments   = (szSegments != NULL) ? strtol(szSegments, NULL, 10) : G_K49_MAX_SEGMENTS;
+                    numSamples = 0;
+                    capture    = G_K40_INA226_CAPTURE_SEGMENTED;
+                } else if ((szCapture != NULL) && (strcmp(szCapture, "pretrig") == 0)) {
+                    // 프리트리거 캡처 : 트리거 조건 (레벨/히스테리시스는 mA 또는 V)
+                    const char *szTrigSrc     = json["trigSrc"];        // "i" (전류) 또는 "v" (버스 전압)
+                    const char *szTrigSlope   = json["trigSlope"];      // "rise", "fall", "both"
+                    const char *szTrigLevel   = json["trigLevel"];
+                    const char *szTrigHyst    = json["trigHyst"];
+                    const char *szTrigHw      = json["trigHw"];         // "1" : INA226 경고 한계 레지스터로 트리거
+                    const char *szPreSamples  = json["preSamples"];
+                    const char *szPostSamples = json["postSamples"];
+                    int source = ((szTrigSrc != NULL) && (szTrigSrc[0] == 'v')) ? G_K40_INA226_TRIG_SRC_BUS : G_K40_INA226_TRIG_SRC_SHUNT;
+                    int slope  = G_K40_INA226_TRIG_RISE;
+                    if ((szTrigSlope != NULL) && (strcmp(szTrigSlope, "fall") == 0)) {
+                        slope = G_K40_INA226_TRIG_FALL;
+                    } else if ((szTrigSlope != NULL) && (strcmp(szTrigSlope, "both") == 0)) {
+                        slope = G_K40_INA226_TRIG_BOTH;
+                    }
+                    float level = (szTrigLevel != NULL) ? strtof(szTrigLevel, NULL) : 0.0f;
+                    float hyst  = (szTrigHyst != NULL) ? strtof(szTrigHyst, NULL) : 0.0f;
+                    if (scale == G_K40_INA226_SCALE_AUTO) {
+                        scale = G_K40_INA226_SCALE_HI;    // 프리트리거 캡처는 범위 전환 없음 : 트리거 레벨도 HI 기준
+                    }
+
+                    g_K40_INA226_Trigger.source      = source;
+                    g_K40_INA226_Trigger.slope       = slope;
+                    g_K40_INA226_Trigger.level       = K40_INA226_to_raw(source, scale, level);
+                    g_K40_INA226_Trigger.hyst        = K40_INA226_to_raw(source, scale, hyst < 0.0f ? -hyst : hyst);
+                    g_K40_INA226_Trigger.hardware    = (szTrigHw != NULL) && (szTrigHw[0] == '1');
+                    g_K40_INA226_Trigger.preSamples  = (szPreSamples != NULL) ? strtol(szPreSamples, NULL, 10) : 0;
+                    g_K40_INA226_Trigger.postSamples = (szPostSamples != NULL) ? strtol(szPostSamples, NULL, 10) : numSamples;
+                    numSamples = g_K40_INA226_Trigger.preSamples + g_K40_INA226_Trigger.postSamples;
+                    capture    = G_K40_INA226_CAPTURE_PRETRIG;
+                    ESP_LOGI(G_K35_TAG, "trigger src %d slope %d level %d hyst %d hw %d pre %d post %d", source, slope,
+                             g_K40_INA226_Trigger.level, g_K40_INA226_Trigger.hyst, g_K40_INA226_Trigger.hardware,
+                             g_K40_INA226_Trigger.preSamples, g_K40_INA226_Trigger.postSamples);
+                }
+
+                // 스트리밍, 션트 전용, 다중 캡처는 게이트 모드가 없음 : 캡처 시간 0은 1초로 (게이트 캡처로 바뀌지 않도록)
+                if ((numSamples == 0) && ((capture == G_K40_INA226_CAPTURE_STREAM) || (capture == G_K40_INA226_CAPTURE_SHUNT) ||
+                                          (capture == G_K40_INA226_CAPTURE_MULTI))) {
+                    numSamples = (int)(1000000 / periodUs);
+                    numSamples = (numSamples < 2) ? 2 : numSamples;
+                    ESP_LOGW(G_K35_TAG, "Capture %d has no gated mode, capturing 1 second (%d samples)", capture, numSamples);
+                }
+
+                // 전력 채널 (선택, "power" = "1") : 시간 지정 버퍼 캡처에서 샘플마다 전력 워드 추가
+                const char *szPower = json["power"];
+                int channels        = 0;
+                if ((szPower != NULL) && (szPower[0] == '1') && (capture == G_K40_INA226_CAPTURE_BUFFER) && (numSamples > 0)) {
+                    channels = G_K40_INA226_CH_POWER;
+                }
+                // 마커 채널 (선택, "markers" = 마커 입력 수) : 시간 지정 버퍼 캡처에서 샘플마다 마커 비트필드 워드 추가
+                const char *szMarkers = json["markers"];
+                int markers           = (szMarkers != NULL) ? strtol(szMarkers, NULL, 10) : 0;
+                markers               = (markers < 0) ? 0 : ((markers > G_K00_NUM_MARKERS) ? G_K00_NUM_MARKERS : markers);
+                if ((markers > 0) && (capture == G_K40_INA226_CAPTURE_BUFFER) && (numSamples > 0)) {
+                    channels |= G_K40_INA226_CH_MARKER;
+                } else {
+                    markers = 0;
+                }
+
+                // 데시메이션 (선택, "decimate" = 배수) : 시간 지정 버퍼 캡처를 장치에서 줄여 전송 (추가 채널 없음)
+                const char *szDecimate  = json["decimate"];
+                const char *szDecimMode = json["decimMode"];
+                int decimate            = (szDecimate != NULL) ? strtol(szDecimate, NULL, 10) : 0;
+                int decimMode           = ((szDecimMode != NULL) && (strcmp(szDecimMode, "lttb") == 0)) ? G_K51_MODE_LTTB : G_K51_MODE_ENVELOPE;
+                if ((decimate >= G_K51_MIN_FACTOR) && (capture == G_K40_INA226_CAPTURE_BUFFER) && (numSamples > 1)) {
+                    decimate = (decimate > G_K51_MAX_FACTOR) ? G_K51_MAX_FACTOR : decimate;
+                    capture  = G_K40_INA226_CAPTURE_DECIMATE;
+                    channels = 0;
+                    markers  = 0;
+                } else {
+                    decimate = 0;
+                }
+
+                // 압축 저장 (선택, "packed" = "1") : 게이트 버퍼 캡처만
+                const char *szPacked = json["packed"];
+                int packed           = ((szPacked != NULL) && (strcmp(szPacked, "1") == 0) && (capture == G_K40_INA226_CAPTURE_BUFFER) && (numSamples == 0)) ? 1 : 0;
+
+                // 자동 스케일은 범위를 전환하는 캡처만 (나머지는 LO FET로 잘리지 않도록 전체 범위 HI)
+                if ((scale == G_K40_INA226_SCALE_AUTO) && !K40_INA226_capture_autoranges(capture)) {
+                    scale = G_K40_INA226_SCALE_HI;
+                }
+
+                // 게이트/트리거 대기 제한 시간 (선택, ms)
+                const char *szTimeoutMs = json["timeoutMs"];
+                uint32_t timeoutMs      = (szTimeoutMs != NULL) ? (uint32_t)strtoul(szTimeoutMs, NULL, 10) : 0;
 
                 // 측정 모드 및 설정 적용
                 g_K10_Measure.mode               = G_K00_MEASURE_MODE_CURRENT_VOLTAGE;
-                g_K10_Measure.m.cv_meas.cfg       = g_K40_INA226_Config[cfgIndex].reg;
+                g_K10_Measure.m.cv_meas.cfg       = cfgReg;
                 g_K10_Measure.m.cv_meas.scale       = scale;
                 g_K10_Measure.m.cv_meas.nSamples = numSamples;
-                g_K10_Measure.m.cv_meas.periodUs = g_K40_INA226_Config[cfgIndex].periodUs;
+                g_K10_Measure.m.cv_meas.periodUs = periodUs;
+                g_K10_Measure.m.cv_meas.capture  = capture;
+                g_K10_Measure.m.cv_meas.oversample = oversample;
+                g_K10_Measure.m.cv_meas.channels   = channels;
+                g_K10_Measure.m.cv_meas.markers    = markers;
+                g_K10_Measure.m.cv_meas.timeoutMs  = timeoutMs;
+                g_K10_Measure.m.cv_meas.segments   = segments;
+                g_K10_Measure.m.cv_meas.decimate   = decimate;
+                g_K10_Measure.m.cv_meas.decimMode  = decimMode;
+                g_K10_Measure.m.cv_meas.packed     = packed;
 
                 // 로그 출력
                 ESP_LOGI(G_K35_TAG, "Mode = %d", g_K10_Measure.mode);
                 ESP_LOGI(G_K35_TAG, "cfgIndex = %d", cfgIndex);
                 ESP_LOGI(G_K35_TAG, "scale = %d", scale);
                 ESP_LOGI(G_K35_TAG, "nSamples = %d", numSamples);
-                ESP_LOGI(G_K35_TAG, "periodUs = %d", g_K40_INA226_Config[cfgIndex].periodUs);
+                ESP_LOGI(G_K35_TAG, "periodUs = %d", periodUs);
+                ESP_LOGI(G_K35_TAG, "capture = %d", capture);
+                ESP_LOGI(G_K35_TAG, "oversample = %d", oversample);
+                ESP_LOGI(G_K35_TAG, "channels = 0x%X", channels);
+                ESP_LOGI(G_K35_TAG, "markers = %d", markers);
+                ESP_LOGI(G_K35_TAG, "timeoutMs = %u", timeoutMs);
+                ESP_LOGI(G_K35_TAG, "segments = %d", segments);
+                ESP_LOGI(G_K35_TAG, "decimate = %d mode %d", decimate, decimMode);
+                ESP_LOGI(G_K35_TAG, "packed = %d", packed);
 
                 g_K40_INA226_CVCaptureFlag = true;  // 캡처 플래그 설정
             }
+            // 'cv_cancel' 명령어: 진행 중인 캡처 중단 (캡처 태스크가 다음 패킷 경계에서 그때까지의 결과와 종료 프레임을 보냄)
+            else if (strcmp(szAction, "cv_cancel") == 0) {
+                g_K40_INA226_CVCaptureFlag = false;    // 아직 시작하지 않은 캡처 요청 취소
+                if (g_K40_INA226_CaptureState != G_K40_INA226_STATE_IDLE) {
+                    g_K40_INA226_AbortFlag = true;
+                }
+                ESP_LOGI(G_K35_TAG, "cv_cancel : state %d", g_K40_INA226_CaptureState);
+            }
+            // 'cv_config' 명령어: 평균 횟수와 변환 시간으로 설정 및 주기 계산, MSG_CFG_INFO 프레임으로 응답
+            else if (strcmp(szAction, "cv_config") == 0) {
+                const char *szAvg       = json["avg"];
+                const char *szBusUs     = json["busUs"];
+                const char *szShuntUs   = json["shuntUs"];
+                const char *szShuntOnly = json["shuntOnly"];    // "1" : 션트 전용 변환
+                const char *szRateHz    = json["rateHz"];       // 자동 선택 목표 (출력 샘플 속도, Hz)
+                const char *szNoiseUa   = json["noiseUa"];      // 자동 선택 목표 (전류 노이즈, uA RMS)
+                const char *szScale     = json["scale"];
+                const char *szOversample = json["oversample"];  // "1" : 펌웨어 오버샘플링 허용 (버퍼 캡처)
+                bool shuntOnly = (szShuntOnly != NULL) && (szShuntOnly[0] == '1');
+                K40_INA226_CFG_INFO_t info;
+                if ((szRateHz != NULL) || (szNoiseUa != NULL)) {
+                    K45_INA226_select((szRateHz != NULL) ? strtof(szRateHz, NULL) : 0.0f,
+                                      (szNoiseUa != NULL) ? strtof(szNoiseUa, NULL) : 0.0f,
+                                      (szScale != NULL) ? strtol(szScale, NULL, 10) : G_K40_INA226_SCALE_HI, shuntOnly,
+                                      ((szOversample != NULL) && (szOversample[0] == '1')) ? G_K45_MAX_OVERSAMPLE : 1, info);
+                } else {
+                    K40_INA226_config_build((szAvg != NULL) ? strtol(szAvg, NULL, 10) : 0,
+                                            (szBusUs != NULL) ? strtol(szBusUs, NULL, 10) : 0,
+                                            (szShuntUs != NULL) ? strtol(szShuntUs, NULL, 10) : 0,
+                                            shuntOnly, info);
+                }
+                ESP_LOGI(G_K35_TAG, "cv_config : valid %d cfg 0x%04X conv %dus period %dus i2c %dus%s", info.valid, info.cfg,
+                         info.convUs, info.periodUs, info.i2cUs, info.i2cLimited ? " (I2C limited)" : "");
+                g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t *)&info, sizeof(info));
+            }
+            // 'cv_integrate' 명령어: 에너지/전하 적분 중지, 누적기 초기화, 현재 누적값 요청
+            else if (strcmp(szAction, "cv_integrate") == 0) {
+                const char *szOp = json["op"];
+                g_K10_Measure.mode = G_K00_MEASURE_MODE_CURRENT_VOLTAGE;    // 재연결 후 보고를 다시 받음
+                if ((szOp != NULL) && (strcmp(szOp, "stop") == 0)) {
+                    g_K46_StopFlag = true;
+                } else if ((szOp != NULL) && (strcmp(szOp, "reset") == 0)) {
+                    if (g_K46_Running) {
+                        g_K46_ResetFlag = true;    // 캡처 태스크가 다음 보고 시점에 초기화
+                    } else {
+                        K46_INA226_energy_reset();
+                    }
+                }
+                if (!g_K46_Running) {
+                    // 적분 중이 아니면 현재 누적값을 바로 응답 (적분 중이면 다음 보고)
+                    K46_ENERGY_REPORT_t report;
+                    K46_INA226_energy_report(report, false);
+                    g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t *)&report, sizeof(report));
+                }
+                ESP_LOGI(G_K35_TAG, "cv_integrate : %s", (szOp != NULL) ? szOp : "");
+            }
+            // 'cv_calib' 명령어: 보정 점 측정, 저장, 초기화, 현재 보정 표 요청 (MSG_CALIB 프레임으로 응답)
+            else if (strcmp(szAction, "cv_calib") == 0) {
+                const char *szOp    = json["op"];       // "point", "save", "reset", "status"
+                const char *szRange = json["range"];    // "hi", "lo", "bus" (reset은 없으면 모든 범위)
+                const char *szPoint = json["point"];    // "0" (보통 무부하) 또는 "1" (기준 부하)
+                const char *szRef   = json["ref"];      // 기준 계측기 값 (mA 또는 V)
+                int range = -1;
+                if (szRange != NULL) {
+                    range = (strcmp(szRange, "lo") == 0) ? G_K47_RANGE_LO : ((strcmp(szRange, "bus") == 0) ? G_K47_RANGE_BUS : G_K47_RANGE_HI);
+                }
+                // 캡처 중에는 측정 설정(g_K10_Measure)과 샘플마다 적용하는 보정 표를 바꾸지 않음
+                bool busy = (g_K40_INA226_CaptureState != G_K40_INA226_STATE_IDLE) || g_K40_INA226_CVCaptureFlag;
+                bool point = (szOp != NULL) && (strcmp(szOp, "point") == 0) && (range >= 0);
+                bool reset = (szOp != NULL) && (strcmp(szOp, "reset") == 0);
+                if (busy && (point || reset)) {
+                    K47_CALIB_INFO_t info;
+                    K47_INA226_calib_info(info, G_K47_STATUS_BUSY, range);
+                    g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t *)&info, sizeof(info));
+                    ESP_LOGW(G_K35_TAG, "cv_calib : %s rejected, capture state %d", szOp, g_K40_INA226_CaptureState);
+                } else if (point) {
+                    g_K10_Measure.mode = G_K00_MEASURE_MODE_CURRENT_VOLTAGE;
+                    // 기준값을 공칭 LSB 기준 원시값(1/16 LSB)으로 바꾸어 캡처 태스크에 측정 요청
+                    float ref = (szRef != NULL) ? strtof(szRef, NULL) : 0.0f;
+                    float lsb = (range == G_K47_RANGE_BUS) ? G_K40_INA226_LSB_BUS_V : ((range == G_K47_RANGE_LO) ? G_K40_INA226_LSB_LO_MA : G_K40_INA226_LSB_HI_MA);
+                    g_K47_Request.range = range;
+                    g_K47_Request.point = ((szPoint != NULL) && (szPoint[0] == '1')) ? 1 : 0;
+                    g_K47_Request.refQ4 = (int32_t)lroundf(ref * 16.0f / lsb);
+                    g_K10_Measure.m.cv_meas.cfg      = g_K40_INA226_Config[1].reg;
+                    g_K10_Measure.m.cv_meas.periodUs = g_K40_INA226_Config[1].periodUs;
+                    g_K10_Measure.m.cv_meas.nSamples = G_K47_CAL_SAMPLES;
+                    g_K10_Measure.m.cv_meas.capture  = G_K40_INA226_CAPTURE_CALIB;
+                    g_K40_INA226_CVCaptureFlag        = true;    // 결과는 캡처 태스크가 전송
+                } else {
+                    g_K10_Measure.mode = G_K00_MEASURE_MODE_CURRENT_VOLTAGE;
+                    int status = G_K47_STATUS_OK;
+                    if ((szOp != NULL) && (strcmp(szOp, "save") == 0)) {
+                        K47_INA226_calib_save();
+                        status = G_K47_STATUS_SAVED;
+                    } else if (reset) {
+                        K47_INA226_calib_reset(range);    // 저장하기 전까지 NVS의 보정은 유지
+                    }
+                    K47_CALIB_INFO_t info;
+                    K47_INA226_calib_info(info, status, range);
+                    g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t *)&info, sizeof(info));
+                }
+                ESP_LOGI(G_K35_TAG, "cv_calib : %s range %d", (szOp != NULL) ? szOp : "", range);
+            }
+            // 'cv_mem' 명령어: 버퍼 예산 변경 (선택), 블록 사용량과 힙 지표 응답 (MSG_MEM 프레임)
+            else if (strcmp(szAction, "cv_mem") == 0) {
+                const char *szBudgetKB = json["budgetKB"];    // 0 : 네트워크 예비 공간을 뺀 전체
+                int status = G_K53_STATUS_OK;
+                K53_MEM_INFO_t info;
+                if (szBudgetKB != NULL) {
+                    uint32_t budgetKB = (uint32_t)strtoul(szBudgetKB, NULL, 10);
+                    if (K53_MEM_budget_valid(budgetKB)) {
+                        g_K53_BudgetKB = budgetKB;
+                        K50_NV_mem_budget_store(g_K53_BudgetKB);
+                        g_K53_ResizeFlag = true;    // 캡처 태스크가 캡처 사이에 재할당
+                        status           = G_K53_STATUS_PENDING;
+                    } else {
+                        status = G_K53_STATUS_REJECTED;    // 최소 블록이 들어가지 않는 예산
+                        ESP_LOGW(G_K35_TAG, "cv_mem : budget %uKB below minimum %dKB", budgetKB, G_K53_MIN_BUDGET_KB);
+                    }
+                }
+                K53_MEM_info(info, status);
+                g_K35_WebSocket.binary(g_K35_WS_ClientID, (uint8_t *)&info, sizeof(info));
+                ESP_LOGI(G_K35_TAG, "cv_mem : budget %uKB, %d blocks", g_K53_BudgetKB, g_K53_Blocks);
+            }
             // 'oscfreq' 명령어: 주파수 측정 설정
             else if (strcmp(szAction, "oscfreq") == 0) {
                 g_K10_Measure.mode            = G_K00_MEASURE_MODE_FREQUENCY;
@@ -18,11 +18,11 @@
  *
  * 1. K40_INA226_write_reg(uint8_t regAddr, uint16_t data)
  *    - 지정된 레지스터에 16비트 데이터를 쓰는 함수입니다.
- *    - I2C 통신을 통해 데이터를 전송합니다.
+ *    - I2C 전송 계층(K42)을 통해 데이터를 전송합니다.
  *
  * 2. K40_INA226_read_reg(uint8_t regAddr)
  *    - 지정된 레지스터에서 16비트 데이터를 읽어 반환하는 함수입니다.
- *    - I2C 통신을 통해 데이터를 읽어옵니다.
+ *    - I2C 전송 계층(K42)을 통해 읽으며, 장치의 레지스터 포인터가 이미 같은 레지스터이면 주소 쓰기를 생략합니다.
  *
  * 3. K40_INA226_reset()
  *    - INA226 장치를 리셋하여 설정을 초기화합니다.
@@ -39,19 +39,73 @@
  * 6. K40_INA226_capture_buffer_triggered(volatile MEASURE_t &measure, volatile int16_t* buffer)
  *    - 트리거 기반으로 데이터를 캡처하고, 일정 샘플 수가 쌓이면 데이터를 전송하는 함수입니다.
  *    - 샘플링 주기에 맞춰 데이터를 버퍼에 저장하고 전송합니다.
+ *    - cv_meas.oversample이 1보다 크면 출력 샘플마다 변환 결과 여러 개를 평균합니다. (펌웨어 오버샘플링, K45 자동 설정 선택)
+ *    - cv_meas.channels에 G_K40_INA226_CH_POWER가 있으면 MSG_TX_START_CH 헤더로 샘플마다 전력 워드(고정소수점)를 추가합니다.
+ *    - cv_meas.channels에 G_K40_INA226_CH_MARKER가 있으면 변환 완료 시점의 마커 GPIO(cv_meas.markers개)를 비트필드 워드로 샘플마다 추가합니다.
+ *      (비트 k = 마커 k 레벨, 채널 워드의 상위 바이트 = 마커 수, 펌웨어 단계 마커와 전류를 같은 타임라인에 표시)
  *
  * 7. K40_INA226_capture_buffer_gated(volatile MEASURE_t &measure, volatile int16_t* buffer)
  *    - 외부 게이트 신호가 활성화된 동안 데이터를 캡처하는 함수입니다.
  *    - 게이트 신호가 LOW로 유지되는 동안 샘플을 수집하고, 게이트가 닫히면 측정을 중지합니다.
+ *    - 게이트 창 여러 개를 한 번의 캡처로 기록하려면 분할 게이트 캡처(K49, G_K40_INA226_CAPTURE_SEGMENTED)를 사용합니다.
+ *    - 게이트 경계는 루프가 핀을 확인하는 샘플 주기 단위가 아니라 게이트 핀 에지 ISR(K41)의 시각입니다.
+ *      샘플 시각(ALERT ISR의 변환 완료 시각 - 변환 시간 / 2)을 중앙으로 하는 한 주기 슬롯 중 게이트 안의 비율로
+ *      첫/마지막 샘플을 가중하여 에지 가중 평균 전류를 구하고, 게이트 길이와 함께 종료 프레임(gateUs, iGateNa 등)으로 보냅니다.
+ *      (창 전하 = iGateNa x gateUs, 게이트 경계의 샘플 때문에 생기던 최대 한 샘플의 전하 오차 제거)
+ *    - cv_meas.packed이면 샘플을 K52 압축 블록(델타 + 지그재그 + 비트 패킹)으로 버퍼에 기록하고 그대로 전송합니다. (MSG_TX_START_PACKED)
+ *      패킷은 약 1초 분량의 블록이며, 범위 전환은 블록을 끝내고 [MSG_TX_RANGE, scale, blank] 레코드를 블록 사이에 넣습니다.
+ *    - 6, 7번 캡처는 자동 스케일(G_K40_INA226_SCALE_AUTO)이면 포화 또는 여유 부족 시 캡처 중에 FET로 범위를 전환하고,
+ *      전환 직후 블랭킹 구간의 샘플 수와 새 범위를 범위 패킷(MSG_TX_RANGE) 헤더로 전송합니다.
  *
- * 8. K50_INA226_test_capture()
+ * 8. K40_INA226_capture_stream(volatile MEASURE_t &measure, volatile int16_t* buffer)
+ *    - 고정 크기 블록 링에 샘플을 기록하고, 전송 태스크가 블록을 비우는 동안 계속 캡처하는 스트리밍 함수입니다.
+ *    - 메모리 사용량이 고정되므로 캡처 길이가 g_K40_MaxSamples에 제한되지 않습니다.
+ *    - 블록 반환은 전송 큐(g_K40_INA226_TxQueue)로 판단하며, 링이 가득 차면 샘플을 덮어쓰지 않고 버리며, 버린 샘플 수를 다음 블록(MSG_TX_GAP)과 종료 프레임으로 보고합니다.
+ *
+ * 9. K40_INA226_capture_pretrig(volatile MEASURE_t &measure, volatile int16_t* buffer)
+ *    - 오실로스코프처럼 트리거 조건(전류 또는 버스 전압 레벨, 기울기, 히스테리시스)을 기다리는 동안 최근 N개 샘플을 원형 버퍼에 유지합니다.
+ *    - 트리거가 발생하면 트리거 이전 N개 샘플과 이후 M개 샘플을 기존 MSG_TX_START / MSG_TX 패킷 형식으로 전송합니다.
+ *    - 하드웨어 트리거를 선택하면 INA226의 경고 한계 기능(SOL/SUL/BOL/BUL, 래치)으로 칩이 직접 트리거를 감지하며,
+ *      트리거 전까지 I2C로 샘플을 읽지 않고 ALERT 핀 인터럽트만 기다립니다. (트리거 이전 샘플 없음)
+ *
+ * 10. K40_INA226_capture_buffer_shunt(volatile MEASURE_t &measure, volatile int16_t* buffer)
+ *    - INA226을 션트 전용 연속 변환 모드(모드 0x5)로 설정하고 션트 전압만 읽는 고속 캡처 함수입니다.
+ *    - 버스 변환 시간과 버스 레지스터 읽기가 없으므로 같은 변환 설정에서 약 두 배의 전류 샘플 속도를 얻습니다.
+ *    - 시작 프레임(MSG_TX_START_CH)에 포함된 채널을 표시합니다.
+ *
+ * 11. K40_INA226_config_build(int avg, int busUs, int shuntUs, bool shuntOnly, K40_INA226_CFG_INFO_t& info)
+ *    - 평균 횟수(1~1024)와 버스/션트 변환 시간(140us~8.244ms, 서로 달라도 됨)으로 설정 레지스터 값을 만듭니다.
+ *    - 데이터시트 변환 시간(평균 x (션트 + 버스))에 여유를 더해 샘플 주기를 구하고, 시작 시 측정한 I2C 읽기 시간과 비교하여 검증합니다.
+ *    - 웹소켓 cv_config 명령으로 결과를 조회하고, cv_capture 명령의 avg/busUs/shuntUs로 캡처에 사용합니다.
+ *    - 32767us보다 긴 주기는 시작 프레임에 음수 ms 단위로 기록합니다. (K40_INA226_period_word)
+ *
+ * 보정:
+ *    - 션트/버스 원시값은 읽을 때 범위별 오프셋/이득(K47, 고정소수점)으로 공칭 LSB 기준 값으로 바뀌며, 모든 캡처가 같은 읽기 함수를 사용합니다.
+ *    - 물리 단위 변환은 공칭 LSB(G_K40_INA226_LSB_xxx)만 사용합니다.
+ *    - K40_INA226_capture_calib()는 보정 전 원시값을 평균하여 보정 점을 측정합니다. (cv_calib 명령)
+ *
+ * 전력 통계:
+ *    - 버스 전압을 읽는 캡처는 샘플마다 전류 x 전압을 정수로 곱해 최소/평균/최대 전력을 구합니다. (cv_meas.pavgmw 등, 종료 프레임 pMinUw 등)
+ *    - 최대 전력은 같은 샘플의 곱이므로 최대 전류와 최대 전압이 다른 시점이어도 정확합니다.
+ *
+ * 취소:
+ *    - 버퍼 캡처는 패킷(블록) 경계마다 g_K40_INA226_AbortFlag(cv_cancel 명령, 연결 해제)를 확인하고, 취소되면 그때까지의 샘플, 통계와
+ *      종료 프레임(status = G_K40_INA226_STATUS_CANCELLED)을 보냅니다.
+ *    - 게이트/트리거 대기도 취소할 수 있으며, cv_meas.timeoutMs를 넘기면 status = G_K40_INA226_STATUS_TIMEOUT으로 종료합니다.
+ *      (프리트리거 캡처는 원형 버퍼에 남은 샘플을 트리거 위치 없이 보냄)
+ *
+ * 캡처 통계:
+ *    - 버퍼 캡처(6~10번, 다중 캡처)는 샘플마다 K48 커널로 전류/버스 전압 통계를 누적하고, 종료 디스크립터 전에 K40_INA226_stats_end()로 기록합니다.
+ *    - 평균/최소/최대와 함께 표준편차, RMS, 히스토그램 근사 P50/P99 전류(cv_meas.istdma 등, 종료 프레임 iStdNa 등)를 보고합니다.
+ *
+ * 12. K50_INA226_test_capture()
  *    - 원샷 샘플 캡처 기능을 테스트하는 함수입니다.
  *    - 다양한 설정에서 원샷 모드 측정을 수행하여 성능을 테스트합니다.
  *
  * 기타 주요 변수:
  * - g_K40_INA226_Config[]: 측정에 사용되는 설정 값 배열입니다. 각 설정은 측정 주기 및 평균 샘플 수를 정의합니다.
  * - g_K40_MaxSamples: 최대 샘플 수를 저장하는 변수입니다.
- * - g_K40_INA226_DataReadyFlag, g_K40_INA226_MeterReadyFlag 등: 다양한 상태 플래그를 정의하여, 데이터 준비 상태 또는 측정 완료 상태를 관리합니다.
+ * - g_K40_INA226_TxQueue: 캡처 태스크가 전송할 패킷의 위치(오프셋, 워드 수, 플래그)를 전송 태스크에 넘기는 블록 디스크립터 큐입니다.
  *
  * INA226을 사용한 전류 및 전압 측정 작업을 용이하게 하며, 이 라이브러리를 통해 다양한 캡처 모드 및 전송 방식을 사용할 수 있습니다.
  */
@@ -60,6 +114,15 @@
 
 #include <Arduino.h>
 #include <Wire.h>
+#include <soc/gpio_reg.h>
+
+#include "K41_ina226_sched_001.h"
+#include "K42_ina226_i2c_001.h"
+#include "K43_block_queue_001.h"
+#include "K47_ina226_calib_001.h"
+#include "K48_ina226_stats_001.h"
+#include "K52_ina226_pack_001.h"
+#include "K53_capture_mem_001.h"
 
 // INA226 I2C 주소 정의
 // 이 값은 데이터 시트에서 제공하는 INA226의 기본 7비트 주소입니다.
@@ -74,12 +137,26 @@
 #define     G_K40_INA226_REG_ALERT            0x07          // 경고 한계 레지스터, 경고 임계값을 설정
 #define     G_K40_INA226_REG_ID                0xFE          // 제조사 ID 레지스터
 
+// 마스크/활성 레지스터 비트 정의
+// 경고 기능(SOL~CNVR)은 한 번에 하나만 사용합니다. (여러 비트가 켜지면 상위 비트가 우선)
+#define     G_K40_INA226_MASK_SOL            0x8000        // 션트 전압이 한계값 초과 시 경고
+#define     G_K40_INA226_MASK_SUL            0x4000        // 션트 전압이 한계값 미만 시 경고
+#define     G_K40_INA226_MASK_BOL            0x2000        // 버스 전압이 한계값 초과 시 경고
+#define     G_K40_INA226_MASK_BUL            0x1000        // 버스 전압이 한계값 미만 시 경고
+#define     G_K40_INA226_MASK_CNVR           0x0400        // 변환 완료 시 경고
+#define     G_K40_INA226_MASK_LEN            0x0001        // 경고 래치 (마스크 레지스터를 읽을 때까지 ALERT 핀 유지)
+
 // 전류 측정 스케일 정의
 // 이 값들은 측정하려는 전류의 범위에 따라 션트 저항을 변경하기 위한 값입니다.
 #define G_K40_INA226_SCALE_HI        0  // 고스케일: 션트 저항 = 0.05옴, 최대 전류 = 1.64A
 #define G_K40_INA226_SCALE_LO        1  // 저스케일: 션트 저항 = 1.05옴, 최대 전류 = 78mA
 #define G_K40_INA226_SCALE_AUTO        2  // 자동 모드: 측정에 따라 스케일을 자동으로 전환
 
+// 원시값 1 LSB의 물리 단위 (공칭값, 보드별 오차는 읽을 때 K47 보정으로 원시값에서 제거)
+#define G_K40_INA226_LSB_HI_MA       (G_K47_LSB_HI_NA / 1000000.0f)    // 0.05mA
+#define G_K40_INA226_LSB_LO_MA       (G_K47_LSB_LO_NA / 1000000.0f)    // 0.002381mA
+#define G_K40_INA226_LSB_BUS_V       (G_K47_LSB_BUS_UV / 1000000.0f)   // 0.00125V
+
 // 메시지 ID 정의
 // 각 메시지는 특정 상태나 명령을 전달하기 위한 코드로 사용됩니다.
 #define G_K40_INA226_MSG_GATE_OPEN        1234  // 게이트가 열렸을 때 보내는 메시지
@@ -87,6 +164,77 @@
 #define G_K40_INA226_MSG_TX                2222  // 데이터 전송 중 메시지
 #define G_K40_INA226_MSG_TX_COMPLETE     3333  // 데이터 전송 완료 메시지
 #define G_K40_INA226_MSG_TX_CV_METER     4444  // CV 미터 데이터 전송 메시지
+#define G_K40_INA226_MSG_CFG_INFO        6666  // 설정 계산 결과 메시지 (K40_INA226_CFG_INFO_t, cv_config 명령 응답)
+#define G_K40_INA226_MSG_ENERGY          7777  // 에너지/전하 적분 보고 메시지 (K46_ENERGY_REPORT_t)
+#define G_K40_INA226_MSG_TX_GAP            2223  // 데이터 전송 메시지 (앞에 버려진 샘플 있음, 다음 2워드 = 버린 샘플 수)
+#define G_K40_INA226_MSG_TX_RANGE          2224  // 데이터 전송 메시지 (자동 범위 전환) [2224, scale, blank] + 샘플
+                                                 // (이후 샘플은 scale 범위, 첫 blank개 샘플은 FET 전환 직후의 블랭킹 구간)
+#define G_K40_INA226_MSG_TX_START_CH       1112  // 채널 지정 전송 시작 메시지 [1112, periodUs, scale, channels] + 샘플
+                                                 // (샘플당 워드 수 = channels의 비트 수, 이후 MSG_TX 패킷도 같은 형식)
+#define G_K40_INA226_MSG_TX_START_MULTI    1113  // 다중 INA226 전송 시작 메시지 [1113, periodUs, scale, nDev, (id, shunt mΩ) x nDev] + 샘플
+                                                 // (시간 단계마다 nDev개의 (shunt, bus) 쌍, K44 참고)
+#define G_K40_INA226_MSG_TX_START_DECIM    1114  // 데시메이션 전송 시작 메시지 [1114, periodUs, scale, factor, mode] + 레코드 (K51 참고)
+#define G_K40_INA226_MSG_TX_START_PACKED   1115  // 압축 전송 시작 메시지 [1115, periodUs, scale, blockSamples] + 압축 블록 (K52 참고)
+#define G_K40_INA226_MSG_TX_PACKED         G_K52_MSG_TX_PACKED    // 압축 블록 [2227, n, widths, shunt0, bus0] + 델타 (2227)
+#define G_K40_INA226_MSG_TX_SEGMENT        2225  // 분할 게이트 캡처의 창 시작 [2225, index, startUs int64 (16비트 x 4)] + 샘플 (K49 참고)
+#define G_K40_INA226_MSG_TX_SEG_END        2226  // 분할 게이트 캡처의 창 요약 [2226, index] + K49_SEGMENT_t (int64 startUs 를 하위/상위 int32로 나눈 int32 배열)
+
+// 샘플 채널 비트 정의 (MSG_TX_START_CH의 channels)
+#define G_K40_INA226_CH_SHUNT              0x0001    // 션트 전압
+#define G_K40_INA226_CH_BUS                0x0002    // 버스 전압
+#define G_K40_INA226_CH_POWER              0x0004    // 전력 (장치에서 계산, shunt x bus / G_K40_INA226_POWER_DIV)
+#define G_K40_INA226_CH_MARKER             0x0008    // 디지털 마커 비트필드 (비트 k = g_K00_PIN_MARKER_k)
+#define G_K40_INA226_CH_MARKERS_SHIFT      8         // 시작 프레임 채널 워드에서 마커 수의 위치
+
+// 전력 채널 워드 = shunt x bus / 40000 (고정소수점, 전력 LSB = 전류 LSB x 50 x 1V, HI 2.5mW, LO 119uW, 최대 23592)
+#define G_K40_INA226_POWER_DIV             40000
+
+// 캡처 방식 정의 (CV_MEASURE_t.capture)
+#define G_K40_INA226_CAPTURE_BUFFER        0     // 버퍼 캡처 (nSamples 만큼 선형 버퍼에 기록)
+#define G_K40_INA226_CAPTURE_STREAM        1     // 스트리밍 캡처 (블록 링, 길이 제한 없음)
+#define G_K40_INA226_CAPTURE_PRETRIG       2     // 프리트리거 캡처 (g_K40_INA226_Trigger 조건, 트리거 전후 샘플)
+#define G_K40_INA226_CAPTURE_SHUNT         3     // 션트 전용 고속 캡처 (버스 전압 없음)
+#define G_K40_INA226_CAPTURE_MULTI         4     // 다중 INA226 캡처 (K44, 두 I2C 버스에서 시간 정렬)
+#define G_K40_INA226_CAPTURE_INTEGRATE     5     // 에너지/전하 적분 (K46, 샘플을 저장하지 않고 중지할 때까지 실행)
+#define G_K40_INA226_CAPTURE_CALIB         6     // 보정 점 측정 (K47, g_K47_Request)
+#define G_K40_INA226_CAPTURE_SEGMENTED     7     // 분할 게이트 캡처 (K49, 게이트 창 cv_meas.segments개를 한 번에 기록)
+#define G_K40_INA226_CAPTURE_DECIMATE      8     // 데시메이션 캡처 (K51, 샘플 cv_meas.decimate개마다 엔벨로프 또는 LTTB 레코드)
+
+// 캡처 상태 정의 (g_K40_INA226_CaptureState, 캡처 태스크가 기록)
+#define G_K40_INA226_STATE_IDLE            0     // 캡처 없음
+#define G_K40_INA226_STATE_WAITING         1     // 게이트 또는 트리거 대기 (샘플 기록 전)
+#define G_K40_INA226_STATE_RUNNING         2     // 샘플 기록 중
+
+// 캡처 종료 상태 정의 (종료 프레임 status)
+#define G_K40_INA226_STATUS_COMPLETE       0     // 요청한 캡처 완료 (게이트 캡처는 게이트가 닫힘)
+#define G_K40_INA226_STATUS_CANCELLED      1     // 취소 명령(cv_cancel) 또는 연결 해제로 중단, 그때까지의 샘플과 통계
+#define G_K40_INA226_STATUS_TIMEOUT        2     // 게이트 또는 트리거 대기 시간 초과 (cv_meas.timeoutMs)
+
+#define G_K40_INA226_ABORT_POLL_MS         50    // 하드웨어 트리거 대기 중 취소 확인 주기
+
+// 프리트리거 캡처의 트리거 소스 및 기울기 정의
+#define G_K40_INA226_TRIG_SRC_SHUNT        0     // 션트 전압 (전류)
+#define G_K40_INA226_TRIG_SRC_BUS          1     // 버스 전압
+#define G_K40_INA226_TRIG_RISE             0     // 상승 에지 : 레벨 - 히스테리시스 아래로 내려간 뒤 레벨 이상
+#define G_K40_INA226_TRIG_FALL             1     // 하강 에지 : 레벨 + 히스테리시스 위로 올라간 뒤 레벨 이하
+#define G_K40_INA226_TRIG_BOTH             2     // 양쪽 에지
+
+// 버퍼 캡처 자동 범위 전환 정의 (scale == G_K40_INA226_SCALE_AUTO)
+// LO 스케일 풀스케일(32767)의 약 90%를 넘으면 HI로 올리고, HI 스케일에서 LO 환산 값이 77% 미만인 샘플이
+// 연속으로 이어지면 LO로 내립니다. 두 임계값 사이의 간격이 히스테리시스 역할을 합니다.
+#define G_K40_INA226_AUTO_UP_RAW           29000 // LO 스케일에서 |션트|가 이 값 이상이면 HI로 전환 (포화 또는 여유 부족, 약 69mA)
+#define G_K40_INA226_AUTO_DOWN_RAW         1200  // HI 스케일에서 |션트|가 이 값 미만이면 LO 후보 (60mA = LO 25200)
+#define G_K40_INA226_AUTO_DOWN_COUNT       16    // LO로 내리기 전 연속 낮은 샘플 수 (채터링 방지)
+#define G_K40_INA226_AUTO_BLANK            2     // FET 전환 후 블랭킹 샘플 수 (전환 시 진행 중이던 평균 변환 결과 포함)
+#define G_K40_INA226_AUTO_MAX_SWITCHES     256   // 캡처당 최대 전환 수 (전환마다 범위 패킷 헤더 3워드)
+#define G_K40_INA226_AUTO_LO_PER_HI        21    // HI 1 LSB = LO 21 LSB (1.05Ω / 0.05Ω)
+
+// 스트리밍 블록 링 정의
+// 각 블록은 헤더 3워드 + (shunt, bus) 샘플 쌍으로 구성됩니다.
+#define G_K40_INA226_STREAM_NUM_BLOCKS     16    // 링의 블록 수
+#define G_K40_INA226_STREAM_BLOCK_SAMPLES  500   // 블록당 최대 샘플 쌍 수
+#define G_K40_INA226_STREAM_HDR_WORDS      3     // 블록 헤더 워드 수
+#define G_K40_INA226_STREAM_BLOCK_WORDS    (G_K40_INA226_STREAM_HDR_WORDS + 2 * G_K40_INA226_STREAM_BLOCK_SAMPLES)
 
 // K40_INA226_CONFIG_t 구조체 정의
 // 이 구조체는 측정을 위한 설정 값을 저장하는데 사용됩니다.
@@ -97,23 +245,136 @@ typedef struct {
 
     #define G_K40_INA226_NUM_CFG 4  // 설정 배열의 크기 (4개의 설정이 존재함)
 
+// 설정 엔진 정의
+// 샘플 주기 = 데이터시트 변환 시간 x (1 + 여유), 10us 단위로 올림, 샘플당 I2C 읽기 시간 이상
+#define G_K40_INA226_CONV_MARGIN_PCT      25    // 변환 시간 여유 (내부 발진기 오차, 변환 완료 경고 지연)
+#define G_K40_INA226_I2C_MARGIN_US        50    // 샘플당 I2C 읽기 시간에 더하는 여유 (태스크 깨움, 페이싱)
+#define G_K40_INA226_I2C_CAL_SAMPLES      32    // 시작 시 I2C 읽기 시간 측정 횟수
+
+// K40_INA226_CFG_INFO_t 구조체 정의
+// 평균 횟수와 변환 시간으로 만든 설정과 계산된 주기입니다. cv_config 명령에 MSG_CFG_INFO 프레임으로 응답합니다.
+// 모든 필드는 int32이며 첫 워드가 메시지 ID입니다.
+typedef struct {
+    int32_t msg;           // G_K40_INA226_MSG_CFG_INFO
+    int32_t valid;         // 1 : 평균 횟수와 변환 시간이 데이터시트 값 중 하나
+    int32_t avg;           // 평균 횟수 (1, 4, 16, 64, 128, 256, 512, 1024)
+    int32_t busUs;         // 버스 변환 시간 (us, 션트 전용이면 0)
+    int32_t shuntUs;       // 션트 변환 시간 (us)
+    int32_t cfg;           // 설정 레지스터 값 (모드 비트 제외)
+    int32_t convUs;        // 데이터시트 변환 시간 = 평균 x (션트 + 버스)
+    int32_t periodUs;      // 샘플 주기
+    int32_t i2cUs;         // 측정된 샘플당 I2C 읽기 시간
+    int32_t i2cLimited;    // 1 : I2C 읽기 시간이 주기를 결정함 (변환 결과 일부를 읽지 못함)
+    int32_t oversample;    // 펌웨어 오버샘플링 (출력 샘플당 변환 결과 읽기 수, 자동 선택만 1보다 큼)
+    int32_t outPeriodUs;   // 출력 샘플 주기 = periodUs x oversample
+    int32_t noiseNa;       // 예상 전류 노이즈 (nA RMS, 자동 선택만, 그 외 0)
+    int32_t met;           // 1 : 요청한 목표(속도, 노이즈)를 만족 (자동 선택만, 그 외 1)
+} K40_INA226_CFG_INFO_t;
+
+// K40_INA226_TX_END_t 구조체 정의
+// 캡처 종료 프레임(MSG_TX_COMPLETE)으로 전송되는 캡처 요약입니다.
+// 모든 필드는 int32이며 첫 워드가 메시지 ID입니다. (Int16 뷰에서도 view[0] == 3333)
+typedef struct {
+    int32_t msg;          // G_K40_INA226_MSG_TX_COMPLETE
+    int32_t nSamples;     // 캡처된 샘플 수
+    int32_t periodUs;     // 공칭 샘플 주기 (us)
+    int32_t overruns;     // 데드라인을 한 주기 이상 놓친 샘플 수
+    int32_t maxLateUs;    // 데드라인 대비 최대 지연 (us)
+    int32_t avgLateUs;    // 데드라인 대비 평균 지연 (us)
+    int32_t dropped;      // 스트리밍 링이 가득 차서 버려진 샘플 수
+    int32_t triggerIndex; // 트리거 샘플의 위치 (프리트리거 캡처, 그 외 -1)
+    int32_t i2cErrors;    // 캡처 중 재시도 후에도 실패한 I2C 전송 + 변환 완료 타임아웃 수 (0이 아니면 일부 샘플이 잘못됨)
+    int32_t pMinUw;       // 샘플별 전력 (같은 샘플의 전류 x 전압) 최소/평균/최대 (uW, 버스 전압이 없는 캡처는 0)
+    int32_t pAvgUw;
+    int32_t pMaxUw;
+    int32_t iStdNa;       // 전류 표준편차 / RMS / 근사 중앙값 / 근사 99번째 백분위 (nA, 자동 범위 블랭킹 샘플 제외)
+    int32_t iRmsNa;
+    int32_t iP50Na;
+    int32_t iP99Na;
+    int32_t vStdUv;       // 버스 전압 표준편차 (uV, 버스 전압이 없는 캡처는 0)
+    int32_t status;       // 종료 상태 (G_K40_INA226_STATUS_xxx, 취소/시간 초과도 그때까지의 결과를 보고)
+    int32_t segments;     // 기록한 게이트 창 수 (분할 게이트 캡처, 그 외 0)
+    int32_t gateUs;       // 게이트 에지 ISR로 측정한 창 길이 (us, 게이트 캡처만, 분할 캡처는 창 합계)
+    int32_t openLeadUs;   // 첫 샘플 시각 - 게이트 열림 시각 (us, 음수 = 변환 구간 일부가 열림 전)
+    int32_t closeLagUs;   // 게이트 닫힘 시각 - 마지막 샘플 시각 (us, 음수 = 닫힌 뒤의 샘플)
+    int32_t wFirstPpm;    // 첫 / 마지막 샘플의 가중치 (ppm, 샘플 슬롯 중 게이트 안의 비율)
+    int32_t wLastPpm;
+    int32_t iGateNa;      // 에지 가중 평균 전류 (nA, 창 전하 = iGateNa x gateUs)
+} K40_INA226_TX_END_t;
+
+// K40_INA226_TRIGGER_t 구조체 정의
+// 프리트리거 캡처의 트리거 조건입니다. 레벨과 히스테리시스는 레지스터 원시값(LSB)입니다.
+typedef struct {
+    int     source;         // G_K40_INA226_TRIG_SRC_xxx
+    int     slope;          // G_K40_INA226_TRIG_xxx
+    int16_t level;          // 트리거 레벨
+    int16_t hyst;           // 히스테리시스 (재무장에 필요한 레벨 반대편 거리, 노이즈로 인한 반복 트리거 방지)
+    bool    hardware;       // INA226 경고 한계 레지스터로 트리거 (트리거 전 I2C 읽기 없음, 상승/하강만 지원)
+    int     preSamples;     // 트리거 이전 샘플 수 (N, 하드웨어 트리거는 0)
+    int     postSamples;    // 트리거 샘플을 포함한 이후 샘플 수 (M)
+} K40_INA226_TRIGGER_t;
+
+// K40_INA226_AUTORANGE_t 구조체 정의
+// 버퍼 캡처 중 자동 범위 전환 상태입니다.
+typedef struct {
+    bool enabled;     // 자동 범위 전환 사용
+    int  scale;       // 현재 스케일 (HI 또는 LO)
+    int  blank;       // 남은 블랭킹 샘플 수
+    int  lowCount;    // HI 스케일에서 연속으로 낮은 샘플 수
+    int  switches;    // 전환 횟수
+} K40_INA226_AUTORANGE_t;
+
+// K40_INA226_POWER_STATS_t 구조체 정의
+// 샘플별 전력 통계입니다. 값은 전류 원시값 x 버스 원시값 (자동 범위는 LO LSB 단위 전류)
+typedef struct {
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+    int32_t n;
+} K40_INA226_POWER_STATS_t;
+
+// K40_INA226_EDGE_t 구조체 정의
+// 게이트 창의 에지 가중 평균 상태입니다. 샘플마다 전류와 샘플 시각(변환 구간 중앙, esp_timer 기준)을 누적하고,
+// 창이 끝나면 첫/마지막 샘플을 게이트 에지로 잘라 가중치를 정합니다. (중간 샘플의 가중치는 1)
+typedef struct {
+    int64_t openUs;        // 게이트 열림 시각 (에지 ISR)
+    int64_t sum;           // 유효 샘플 전류 합계 (자동 범위는 LO LSB 단위)
+    int32_t n;             // 유효 샘플 수
+    int32_t firstValue;    // 첫 / 마지막 유효 샘플 전류
+    int32_t lastValue;
+    int64_t firstUs;       // 첫 / 마지막 유효 샘플 시각
+    int64_t lastUs;
+} K40_INA226_EDGE_t;
+
 // 외부 변수 선언
 //extern const K40_INA226_CONFIG_t g_K40_INA226_Config[];               // 측정을 위한 설정 값 배열
 int              g_K40_MaxSamples;               // 최대 샘플 수
-//extern volatile bool  g_K40_INA226_GateOpenFlag;           // 게이트가 열렸는지 여부를 나타내는 플래그
-// volatile bool  g_K40_INA226_DataReadyFlag;               // 데이터가 준비되었는지 여부를 나타내는 플래그
-extern volatile int      g_K40_INA226_TxSamples;               // 전송할 샘플의 수
-//extern volatile bool  g_K40_INA226_EndCaptureFlag;      // 캡처가 종료되었는지 여부를 나타내는 플래그
-//extern volatile bool  g_K40_INA226_MeterReadyFlag;      // 미터가 준비되었는지 여부를 나타내는 플래그
 
 // 함수 선언
 void     K40_INA226_write_reg(uint8_t regAddr, uint16_t data);                                                           // 레지스터에 값을 쓰는 함수
 uint16_t K40_INA226_read_reg(uint8_t regAddr);                                                                           // 레지스터에서 값을 읽는 함수
+void     K40_INA226_read_shunt_bus_raw(uint16_t& shunt, uint16_t& bus);                                                  // 보정 전 원시값을 읽는 함수
+void     K40_INA226_read_shunt_bus(uint16_t& shunt, uint16_t& bus);                                                      // 션트와 버스 레지스터를 읽는 함수
+void     K40_INA226_read_oversampled(int n, uint16_t& shunt, uint16_t& bus);                                            // 변환 결과 n개의 평균을 읽는 함수
 void     K40_INA226_reset();                                                                                           // INA226을 리셋하는 함수
 bool     K40_INA226_capture_oneshot(volatile MEASURE_t& measure, volatile int16_t* buffer, bool manualScale);           // 원샷 캡처 함수
 bool     K40_INA226_capture_averaged_sample(volatile MEASURE_t& measure, volatile int16_t* buffer, bool manualScale);  // 평균 샘플 캡처 함수
 void     K40_INA226_capture_buffer_triggered(volatile MEASURE_t& measure, volatile int16_t* buffer);                   // 트리거된 버퍼 캡처 함수
 void     K40_INA226_capture_buffer_gated(volatile MEASURE_t& measure, volatile int16_t* buffer);                       // 게이트된 버퍼 캡처 함수
+void     K40_INA226_capture_stream(volatile MEASURE_t& measure, volatile int16_t* buffer);                             // 스트리밍 캡처 함수
+void     K40_INA226_capture_pretrig(volatile MEASURE_t& measure, volatile int16_t* buffer);                            // 프리트리거 캡처 함수
+void     K40_INA226_capture_buffer_shunt(volatile MEASURE_t& measure, volatile int16_t* buffer);                       // 션트 전용 버퍼 캡처 함수
+void     K40_INA226_capture_calib(volatile MEASURE_t& measure, volatile int16_t* buffer);                              // 보정 점 측정 함수
+uint32_t K40_INA226_shunt_only_period(uint16_t cfg);                                                                    // 션트 전용 모드의 샘플 주기 계산
+bool     K40_INA226_config_build(int avg, int busUs, int shuntUs, bool shuntOnly, K40_INA226_CFG_INFO_t& info);           // 평균 횟수와 변환 시간으로 설정 및 주기 계산
+uint32_t K40_INA226_conversion_us(uint16_t cfg, bool shuntOnly);                                                        // 데이터시트 변환 시간 계산
+void     K40_INA226_measure_i2c();                                                                                       // 샘플당 I2C 읽기 시간 측정
+int16_t  K40_INA226_period_word(uint32_t periodUs);                                                                     // 시작 프레임의 주기 워드
+int16_t  K40_INA226_to_raw(int source, int scale, float value);                                                          // 물리 단위(mA, V)를 레지스터 원시값으로 변환
+bool     K40_INA226_wait_alert_limit(uint16_t function, int16_t limit, uint32_t t0Ms, uint32_t timeoutMs);               // 경고 한계 도달 대기 함수 (취소, 시간 초과 시 false)
+void     K40_INA226_reset_tx_end();                                                                                      // 캡처 종료 프레임 초기화 함수
+void     K40_INA226_fill_tx_end(int numSamples);                                                                         // 캡처 종료 프레임 작성 함수
+void     K40_INA226_push_block(uint32_t offset, int words, uint16_t flags);                                             // 전송 패킷 디스크립터 추가 함수
 void     K50_INA226_test_capture();                                                                                       // 테스트 캡처 함수
 
 
@@ -126,13 +387,20 @@ void     K50_INA226_test_capture();
 //static const char* G_K40_TAG = "ina226";
 
 
-// 전역 플래그 변수 초기화
-volatile bool             g_K40_INA226_DataReadyFlag    = false;  // 데이터 준비 완료 플래그
-volatile bool             g_K40_INA226_MeterReadyFlag    = false;  // 미터 준비 완료 플래그
-volatile bool             g_K40_INA226_GateOpenFlag    = false;  // 게이트 열림 플래그
-
+// 전역 변수 초기화
 extern volatile bool     g_K40_INA226_CVCaptureFlag;                 // CV 캡처 플래그
-volatile bool             g_K40_INA226_EndCaptureFlag    = false;     // 캡처 종료 플래그
+K43_BLOCK_QUEUE_t         g_K40_INA226_TxQueue;                       // 전송할 패킷 디스크립터 큐 (캡처 태스크 → 전송 태스크)
+volatile uint32_t         g_K40_INA226_TxQueueStalls    = 0;         // 큐가 가득 차서 캡처 태스크가 기다린 횟수
+K40_INA226_TX_END_t       g_K40_INA226_TxEnd;                         // 캡처 종료 프레임 (요약)
+K40_INA226_TRIGGER_t      g_K40_INA226_Trigger;                       // 프리트리거 캡처 조건 (웹소켓 명령으로 설정)
+static uint32_t           g_K40_INA226_ErrorBase        = 0;         // 캡처 시작 시점의 누적 I2C 오류 수
+uint32_t                  g_K40_INA226_I2cPairUs        = 0;         // 측정된 샘플당 (shunt, bus) I2C 읽기 시간 (us)
+volatile bool             g_K40_INA226_AbortFlag        = false;     // 캡처 취소 요청 (웹소켓 명령, 연결 해제)
+volatile int              g_K40_INA226_CaptureState     = G_K40_INA226_STATE_IDLE;    // 캡처 상태 (G_K40_INA226_STATE_xxx)
+
+// 데이터시트 평균 횟수 및 변환 시간 표 (설정 레지스터 AVG, VBUSCT, VSHCT 코드 순서)
+static const uint16_t     g_K40_INA226_AvgTable[8]      = {1, 4, 16, 64, 128, 256, 512, 1024};
+static const uint16_t     g_K40_INA226_ConvTable[8]     = {140, 204, 332, 588, 1100, 2116, 4156, 8244};    // us
 //extern volatile bool         LastPacketAckFlag = false;     // 마지막 패킷 확인 플래그
 
 // g_K40_INA226_Config 배열 초기화
@@ -154,31 +422,358 @@ static void K50_INA226_switch_scale(int scale) {
     // SCALE_LO인 경우 반대로 설정됩니다.
     digitalWrite(g_K00_PIN_FET_1Ohm, scale == G_K40_INA226_SCALE_HI ? LOW : HIGH);
     digitalWrite(g_K00_PIN_FET_05hm, scale == G_K40_INA226_SCALE_HI ? HIGH : LOW);
+    K47_INA226_calib_select(scale);    // 션트 범위별 보정
+}
+
+// 자동 범위 전환 초기화 함수
+// 자동 스케일이면 HI에서 시작합니다. (첫 샘플부터 큰 전류가 흘러도 포화되지 않음)
+// 캡처 중 범위를 전환하는 (자동 스케일을 지원하는) 캡처인지 확인
+// 버퍼 캡처(미터, 시간 지정, 게이트), 분할 게이트 캡처, 적분만 전환하며, 나머지는 자동이면 전체 범위(HI)로 측정합니다.
+static inline bool K40_INA226_capture_autoranges(int capture) {
+    return (capture == G_K40_INA226_CAPTURE_BUFFER) || (capture == G_K40_INA226_CAPTURE_SEGMENTED) || (capture == G_K40_INA226_CAPTURE_INTEGRATE);
+}
+
+static void K40_INA226_autorange_begin(K40_INA226_AUTORANGE_t& ar, int scale) {
+    ar.enabled  = (scale == G_K40_INA226_SCALE_AUTO);
+    ar.scale    = ar.enabled ? G_K40_INA226_SCALE_HI : scale;
+    ar.blank    = 0;
+    ar.lowCount = 0;
+    ar.switches = 0;
+}
+
+// 자동 범위 전환 검사 함수
+// 샘플의 블랭킹 여부를 반환하고, 범위를 바꿔야 하면 FET를 전환한 뒤 switched를 true로 설정합니다.
+// 블랭킹 구간의 샘플은 전환 검사와 통계에서 제외합니다.
+static bool K40_INA226_autorange_sample(K40_INA226_AUTORANGE_t& ar, int16_t shunt, bool& switched) {
+    switched = false;
+    if (!ar.enabled) {
+        return false;
+    }
+    if (ar.blank > 0) {
+        ar.blank--;
+        return true;
+    }
+    int32_t mag = shunt < 0 ? -(int32_t)shunt : (int32_t)shunt;
+    int     next = ar.scale;
+    if (ar.scale == G_K40_INA226_SCALE_LO) {
+        if (mag >= G_K40_INA226_AUTO_UP_RAW) {
+            next = G_K40_INA226_SCALE_HI;
+        }
+    } else {
+        ar.lowCount = (mag < G_K40_INA226_AUTO_DOWN_RAW) ? ar.lowCount + 1 : 0;
+        if (ar.lowCount >= G_K40_INA226_AUTO_DOWN_COUNT) {
+            next = G_K40_INA226_SCALE_LO;
+        }
+    }
+    if ((next != ar.scale) && (ar.switches < G_K40_INA226_AUTO_MAX_SWITCHES)) {
+        ar.scale    = next;
+        ar.blank    = G_K40_INA226_AUTO_BLANK;
+        ar.lowCount = 0;
+        ar.switches++;
+        K50_INA226_switch_scale(next);
+        switched = true;
+    }
+    return false;
+}
+
+// 범위 전환 패킷 시작 함수
+// 다음 샘플 위치(next)에 범위 패킷 헤더 [MSG_TX_RANGE, scale, blank]를 기록하고 헤더 워드 수만큼 offset을 늘립니다.
+// 방금 시작한 빈 MSG_TX 패킷이 있으면 그 마커를 헤더로 바꾸고, 아니면 현재 패킷을 전송 큐에 넣습니다.
+static void K40_INA226_autorange_packet(volatile int16_t* buffer, const K40_INA226_AUTORANGE_t& ar, int next, int& offset, int& packetStart) {
+    if ((packetStart > 0) && (packetStart == next - 1)) {
+        next = packetStart;    // 빈 MSG_TX 패킷 재사용
+        offset += 2;
+    } else {
+        K40_INA226_push_block(packetStart, next - packetStart, packetStart == 0 ? G_K43_BLOCK_START : 0);
+        packetStart = next;
+        offset += 3;
+    }
+    buffer[next]     = G_K40_INA226_MSG_TX_RANGE;
+    buffer[next + 1] = (int16_t)ar.scale;
+    buffer[next + 2] = (int16_t)ar.blank;
+}
+
+// 전력 통계 초기화 함수
+static void K40_INA226_power_begin(K40_INA226_POWER_STATS_t& ps) {
+    ps.sum = 0;
+    ps.min = INT64_MAX;
+    ps.max = INT64_MIN;
+    ps.n   = 0;
+}
+
+// 전력 통계 누적 함수
+// 같은 샘플의 전류와 버스 전압을 곱하므로 최대 전력은 서로 다른 시점의 전류 최대와 전압 최대의 곱이 아닙니다.
+static inline void K40_INA226_power_add(K40_INA226_POWER_STATS_t& ps, int32_t current, int16_t bus) {
+    int64_t p = (int64_t)current * bus;
+    ps.sum += p;
+    ps.min = p < ps.min ? p : ps.min;
+    ps.max = p > ps.max ? p : ps.max;
+    ps.n++;
+}
+
+// 전력 채널 워드 (고정소수점, 현재 스케일의 전류 원시값 기준)
+static inline int16_t K40_INA226_power_word(int16_t shunt, int16_t bus) {
+    return (int16_t)(((int32_t)shunt * bus) / G_K40_INA226_POWER_DIV);
+}
+
+// 마커 워드 함수
+// 마커 입력 n개를 GPIO 입력 레지스터 한 번으로 읽어 비트필드로 반환합니다. (같은 순간의 레벨)
+static inline int16_t K40_INA226_marker_word(int n) {
+    static const uint8_t pins[G_K00_NUM_MARKERS] = {g_K00_PIN_MARKER_0, g_K00_PIN_MARKER_1, g_K00_PIN_MARKER_2, g_K00_PIN_MARKER_3};
+    uint32_t in   = REG_READ(GPIO_IN_REG);
+    int16_t  word = 0;
+    for (int k = 0; k < n; k++) {
+        word |= ((in >> pins[k]) & 1) << k;
+    }
+    return word;
+}
+
+// 전력 통계 결과 함수
+// 측정 요약(mW)과 종료 프레임(uW)에 기록합니다. 캡처 함수가 종료 디스크립터를 넣기 전에 호출합니다.
+static void K40_INA226_power_end(volatile MEASURE_t& measure, const K40_INA226_POWER_STATS_t& ps) {
+    float lsbMw = ((measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? G_K40_INA226_LSB_HI_MA : G_K40_INA226_LSB_LO_MA) * G_K40_INA226_LSB_BUS_V;    // mA x V
+    if (ps.n == 0) {
+        measure.m.cv_meas.pavgmw = measure.m.cv_meas.pmaxmw = measure.m.cv_meas.pminmw = 0.0f;
+    } else {
+        measure.m.cv_meas.pavgmw = (float)(ps.sum / ps.n) * lsbMw;
+        measure.m.cv_meas.pmaxmw = (float)ps.max * lsbMw;
+        measure.m.cv_meas.pminmw = (float)ps.min * lsbMw;
+    }
+    g_K40_INA226_TxEnd.pMinUw = (int32_t)(measure.m.cv_meas.pminmw * 1000.0f);
+    g_K40_INA226_TxEnd.pAvgUw = (int32_t)(measure.m.cv_meas.pavgmw * 1000.0f);
+    g_K40_INA226_TxEnd.pMaxUw = (int32_t)(measure.m.cv_meas.pmaxmw * 1000.0f);
+}
+
+// 캡처 취소 확인 함수
+// 취소 요청이 있으면 종료 상태를 기록하고 true를 반환합니다. 캡처 함수가 패킷(블록) 경계와 대기 중에 호출합니다.
+static bool K40_INA226_abort_check() {
+    if (!g_K40_INA226_AbortFlag) {
+        return false;
+    }
+    if (g_K40_INA226_TxEnd.status == G_K40_INA226_STATUS_COMPLETE) {
+        g_K40_INA226_TxEnd.status = G_K40_INA226_STATUS_CANCELLED;
+    }
+    return true;
+}
+
+// 대기 시간 초과 확인 함수 (timeoutMs가 0이면 초과하지 않음)
+static bool K40_INA226_wait_expired(uint32_t t0Ms, uint32_t timeoutMs) {
+    if ((timeoutMs == 0) || ((millis() - t0Ms) < timeoutMs)) {
+        return false;
+    }
+    g_K40_INA226_TxEnd.status = G_K40_INA226_STATUS_TIMEOUT;
+    return true;
+}
+
+// 게이트 대기 함수
+// 게이트 신호가 LOW가 될 때까지 바쁜 대기하며 (게이트 에지 지연 최소화), 취소나 시간 초과 시 false를 반환합니다.
+// openUs는 게이트 에지 ISR(K41_INA226_gate_begin 이후)이 기록한 열림 시각입니다.
+static bool K40_INA226_wait_gate(uint32_t timeoutMs, int64_t& openUs) {
+    g_K40_INA226_CaptureState = G_K40_INA226_STATE_WAITING;
+    uint32_t opens = g_K41_GateOpens;
+    uint32_t t0    = millis();
+    while (digitalRead(g_K00_PIN_GATE) == HIGH) {
+        if (K40_INA226_abort_check() || K40_INA226_wait_expired(t0, timeoutMs)) {
+            return false;
+        }
+    }
+    openUs                    = K41_INA226_gate_edge_us(true, opens);
+    g_K40_INA226_CaptureState = G_K40_INA226_STATE_RUNNING;
+    return true;
+}
+
+// 게이트 닫힘 시각 함수
+// 샘플링 루프가 게이트 닫힘으로 끝났으면 closes 이후의 닫힘 에지 시각, 취소나 버퍼 부족으로 끝났으면 현재 시각입니다.
+static int64_t K40_INA226_gate_close_us(uint32_t closes) {
+    if (digitalRead(g_K00_PIN_GATE) == LOW) {
+        return esp_timer_get_time();
+    }
+    return K41_INA226_gate_edge_us(false, closes);
+}
+
+// 에지 가중 평균 초기화 함수
+static void K40_INA226_edge_begin(K40_INA226_EDGE_t& e, int64_t openUs) {
+    memset(&e, 0, sizeof(e));
+    e.openUs = openUs;
+}
+
+// 에지 가중 평균 누적 함수 (블랭킹 샘플 제외)
+static inline void K40_INA226_edge_add(K40_INA226_EDGE_t& e, int32_t value, int64_t sampleUs) {
+    if (e.n == 0) {
+        e.firstValue = value;
+        e.firstUs    = sampleUs;
+    }
+    e.lastValue = value;
+    e.lastUs    = sampleUs;
+    e.sum += value;
+    e.n++;
+}
+
+// 샘플 가중치 함수
+// 샘플 시각을 중앙으로 하는 한 주기 슬롯 중 게이트 [openUs, closeUs] 안에 있는 비율 (0 ~ 1)
+static float K40_INA226_edge_weight(int64_t sampleUs, int64_t openUs, int64_t closeUs, uint32_t periodUs) {
+    int64_t lo = sampleUs - periodUs / 2;
+    int64_t hi = lo + periodUs;
+    lo         = lo < openUs ? openUs : lo;
+    hi         = hi > closeUs ? closeUs : hi;
+    return (hi <= lo) ? 0.0f : (float)(hi - lo) / (float)periodUs;
+}
+
+// 에지 가중 평균 결과 함수
+// 첫/마지막 샘플을 게이트 에지로 잘라 가중한 평균 전류(원시값 단위)를 반환합니다.
+// 게이트 안의 샘플 구간이 없으면 (가중치 합 0) 단순 평균입니다.
+static float K40_INA226_edge_result(const K40_INA226_EDGE_t& e, int64_t closeUs, uint32_t periodUs, float& wFirst, float& wLast) {
+    wFirst = wLast = 1.0f;
+    if (e.n == 0) {
+        return 0.0f;
+    }
+    wFirst      = K40_INA226_edge_weight(e.firstUs, e.openUs, closeUs, periodUs);
+    wLast       = K40_INA226_edge_weight(e.lastUs, e.openUs, closeUs, periodUs);
+    double wsum = (double)e.sum;
+    double wn   = (double)e.n;
+    if (e.n == 1) {
+        wLast = wFirst;
+        wsum  = (double)wFirst * e.firstValue;
+        wn    = wFirst;
+    } else {
+        wsum -= (1.0 - wFirst) * e.firstValue + (1.0 - wLast) * e.lastValue;
+        wn -= (1.0 - wFirst) + (1.0 - wLast);
+    }
+    return (wn > 0.0) ? (float)(wsum / wn) : (float)((double)e.sum / e.n);
+}
+
+// 에지 가중 평균 결과를 종료 프레임에 기록하는 함수 (게이트 캡처)
+static void K40_INA226_edge_end(volatile MEASURE_t& measure, const K40_INA226_EDGE_t& e, int64_t closeUs) {
+    float lsbMa = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? G_K40_INA226_LSB_HI_MA : G_K40_INA226_LSB_LO_MA;
+    float wFirst, wLast;
+    float avg = K40_INA226_edge_result(e, closeUs, measure.m.cv_meas.periodUs, wFirst, wLast);
+    g_K40_INA226_TxEnd.gateUs     = (int32_t)(closeUs - e.openUs);
+    g_K40_INA226_TxEnd.openLeadUs = (e.n > 0) ? (int32_t)(e.firstUs - e.openUs) : 0;
+    g_K40_INA226_TxEnd.closeLagUs = (e.n > 0) ? (int32_t)(closeUs - e.lastUs) : 0;
+    g_K40_INA226_TxEnd.wFirstPpm  = (int32_t)(wFirst * 1000000.0f);
+    g_K40_INA226_TxEnd.wLastPpm   = (int32_t)(wLast * 1000000.0f);
+    g_K40_INA226_TxEnd.iGateNa    = (int32_t)(avg * lsbMa * 1000000.0f);
+}
+
+// 캡처 통계 결과 함수
+// 전류(K48, 자동 범위는 LO LSB 단위)와 버스 전압 통계를 측정 요약과 종료 프레임에 기록합니다.
+// bus가 NULL이면 버스 전압 결과는 0입니다. 캡처 함수가 종료 디스크립터를 넣기 전에 호출합니다.
+static void K40_INA226_stats_end(volatile MEASURE_t& measure, const K48_STATS_t& current, const K48_STATS_t* bus) {
+    float        lsbMa = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? G_K40_INA226_LSB_HI_MA : G_K40_INA226_LSB_LO_MA;
+    K48_RESULT_t res;
+    K48_INA226_stats_result(current, res);
+    measure.m.cv_meas.iavgma = res.mean * lsbMa;
+    measure.m.cv_meas.imaxma = res.max * lsbMa;
+    measure.m.cv_meas.iminma = res.min * lsbMa;
+    measure.m.cv_meas.istdma = res.std * lsbMa;
+    measure.m.cv_meas.irmsma = res.rms * lsbMa;
+    measure.m.cv_meas.ip50ma = res.p50 * lsbMa;
+    measure.m.cv_meas.ip99ma = res.p99 * lsbMa;
+    g_K40_INA226_TxEnd.iStdNa = (int32_t)(measure.m.cv_meas.istdma * 1000000.0f);
+    g_K40_INA226_TxEnd.iRmsNa = (int32_t)(measure.m.cv_meas.irmsma * 1000000.0f);
+    g_K40_INA226_TxEnd.iP50Na = (int32_t)(measure.m.cv_meas.ip50ma * 1000000.0f);
+    g_K40_INA226_TxEnd.iP99Na = (int32_t)(measure.m.cv_meas.ip99ma * 1000000.0f);
+
+    if (bus == NULL) {
+        measure.m.cv_meas.vavg = measure.m.cv_meas.vmax = measure.m.cv_meas.vmin = measure.m.cv_meas.vstd = 0.0f;
+    } else {
+        K48_INA226_stats_result(*bus, res);
+        measure.m.cv_meas.vavg = res.mean * G_K40_INA226_LSB_BUS_V;
+        measure.m.cv_meas.vmax = res.max * G_K40_INA226_LSB_BUS_V;
+        measure.m.cv_meas.vmin = res.min * G_K40_INA226_LSB_BUS_V;
+        measure.m.cv_meas.vstd = res.std * G_K40_INA226_LSB_BUS_V;
+    }
+    g_K40_INA226_TxEnd.vStdUv = (int32_t)(measure.m.cv_meas.vstd * 1000000.0f);
+}
+
+// 초당 샘플 수 (패킷 분할 간격)
+// 주기가 1초 이상이면 1이며, 샘플마다 패킷을 전송합니다.
+static inline int K40_INA226_samples_per_second(uint32_t periodUs) {
+    int samplesPerSecond = 1000000 / (int)periodUs;
+    return (samplesPerSecond < 1) ? 1 : samplesPerSecond;
+}
+
+// 패킷 분할 함수
+// marker 위치에 MSG_TX 마커를 쓰고, packetStart부터 마커 앞까지를 전송 큐에 넣은 뒤 마커에서 다음 패킷을 시작합니다.
+// 첫 패킷(packetStart == 0)은 시작 패킷입니다. abortable이면 취소를 확인하여 취소 요청이 있을 때 true를 반환합니다.
+static bool K40_INA226_packet_split(volatile int16_t* buffer, int marker, int& packetStart, bool abortable) {
+    buffer[marker] = G_K40_INA226_MSG_TX;
+    K40_INA226_push_block(packetStart, marker - packetStart, packetStart == 0 ? G_K43_BLOCK_START : 0);
+    packetStart = marker;
+    return abortable && K40_INA226_abort_check();
+}
+
+// 남은 패킷 전송 함수
+// packetStart부터 end 앞까지를 전송 큐에 넣습니다. 첫 패킷은 샘플이 없어도 헤더를 보내고, 샘플 없는 MSG_TX 패킷은 보내지 않습니다.
+static void K40_INA226_packet_tail(int end, int packetStart) {
+    int tailWords = end - packetStart;
+    if ((packetStart == 0) || (tailWords > 1)) {
+        K40_INA226_push_block(packetStart, tailWords, packetStart == 0 ? G_K43_BLOCK_START : 0);
+    }
+}
+
+// 캡처 종료 함수
+// 전력, 전류, 버스 전압 통계와 페이싱 통계를 측정 요약과 종료 프레임에 기록하고 종료 디스크립터를 추가합니다.
+// ps가 NULL이면 전력 결과는 0, bus가 NULL이면 버스 전압 결과는 0입니다. 캡처별 종료 프레임 필드는 호출 전에 기록합니다.
+static void K40_INA226_capture_finish(volatile MEASURE_t& measure, int numSamples, const K40_INA226_POWER_STATS_t* ps, const K48_STATS_t& current,
+                                      const K48_STATS_t* bus) {
+    if (ps == NULL) {
+        measure.m.cv_meas.pavgmw = measure.m.cv_meas.pmaxmw = measure.m.cv_meas.pminmw = 0.0f;
+    } else {
+        K40_INA226_power_end(measure, *ps);
+    }
+    K40_INA226_stats_end(measure, current, bus);
+    K40_INA226_fill_tx_end(numSamples);
+    K40_INA226_push_block(0, 0, G_K43_BLOCK_END);
 }
 
 // INA226 레지스터 쓰기 함수
 // 지정된 레지스터 주소에 16비트 데이터를 쓰는 함수입니다.
 void K40_INA226_write_reg(uint8_t regAddr, uint16_t data) {
-    Wire.beginTransmission(G_K40_INA226_I2C_ADDR);
-    Wire.write(regAddr);                          // 레지스터 주소 전송
-    Wire.write((uint8_t)((data >> 8) & 0x00FF));  // 상위 바이트 전송
-    Wire.write((uint8_t)(data & 0x00FF));          // 하위 바이트 전송
-    Wire.endTransmission();                          // 전송 완료
+    K42_INA226_write_reg(G_K40_INA226_I2C_ADDR, regAddr, data);
 }
 
 // INA226 레지스터 읽기 함수
 // 지정된 레지스터 주소에서 16비트 데이터를 읽어 반환하는 함수입니다.
+// 포인터 캐싱은 K42 전송 계층이 처리합니다.
 uint16_t K40_INA226_read_reg(uint8_t regAddr) {
-    Wire.beginTransmission(G_K40_INA226_I2C_ADDR);
-    Wire.write(regAddr);                   // 읽고자 하는 레지스터 주소 전송
-    Wire.endTransmission(false);           // I2C 통신 재시작
-    Wire.requestFrom(G_K40_INA226_I2C_ADDR, 2);  // 2바이트 요청
-    uint8_t buf[2];
-    buf[0] = Wire.read();  // 상위 바이트 읽기
-    buf[1] = Wire.read();  // 하위 바이트 읽기
-    // 상위 바이트와 하위 바이트 결합
-    uint16_t res = ((uint16_t)buf[1]) | (((uint16_t)buf[0]) << 8);
-    return res;
+    return K42_INA226_read_reg(G_K40_INA226_I2C_ADDR, regAddr);
+}
+
+// 션트 및 버스 레지스터 읽기 함수 (보정 전 원시값)
+// 샘플마다 두 레지스터를 읽으며, IDF 백엔드에서는 하나의 I2C 명령 리스트로 실행됩니다.
+void K40_INA226_read_shunt_bus_raw(uint16_t& shunt, uint16_t& bus) {
+    K42_INA226_read_pair(G_K40_INA226_I2C_ADDR, G_K40_INA226_REG_SHUNT, G_K40_INA226_REG_VBUS, shunt, bus);
+}
+
+// 션트 및 버스 레지스터 읽기 함수
+// 현재 션트 범위와 버스 전압의 보정(K47)을 적용한 공칭 LSB 기준 값을 반환합니다.
+void K40_INA226_read_shunt_bus(uint16_t& shunt, uint16_t& bus) {
+    K40_INA226_read_shunt_bus_raw(shunt, bus);
+    shunt = K47_INA226_cal_shunt(shunt);
+    bus   = K47_INA226_cal_bus(bus);
+}
+
+// 오버샘플링 읽기 함수
+// 변환 결과 n개를 읽어 평균(반올림)을 반환합니다. 첫 변환 완료 대기는 호출한 쪽에서 합니다.
+// n이 1 이하이면 K40_INA226_read_shunt_bus()와 같습니다.
+void K40_INA226_read_oversampled(int n, uint16_t& shunt, uint16_t& bus) {
+    if (n <= 1) {
+        K40_INA226_read_shunt_bus(shunt, bus);
+        return;
+    }
+    // 원시값을 평균한 뒤 한 번만 보정
+    K40_INA226_read_shunt_bus_raw(shunt, bus);
+    int32_t ssum = (int16_t)shunt;
+    int32_t bsum = (int16_t)bus;
+    for (int inx = 1; inx < n; inx++) {
+        K41_INA226_wait_drdy();
+        K40_INA226_read_shunt_bus_raw(shunt, bus);
+        ssum += (int16_t)shunt;
+        bsum += (int16_t)bus;
+    }
+    shunt = K47_INA226_cal_shunt((uint16_t)(int16_t)((ssum + (ssum < 0 ? -n / 2 : n / 2)) / n));
+    bus   = K47_INA226_cal_bus((uint16_t)(int16_t)((bsum + (bsum < 0 ? -n / 2 : n / 2)) / n));
 }
 
 // INA226 시스템 리셋 함수
@@ -187,6 +782,175 @@ void K40_INA226_reset() {
     ESP_LOGI(G_K40_TAG, "INA226 시스템 리셋");
     K40_INA226_write_reg(G_K40_INA226_REG_CFG, 0x8000);    // 리셋 명령 전송
     delay(50);                            // 리셋 완료 대기
+    K42_INA226_invalidate_pointer(G_K40_INA226_I2C_ADDR);    // 리셋 후 포인터 상태를 알 수 없음
+}
+
+// 전송 패킷 디스크립터 추가 함수
+// 버퍼의 offset 워드부터 words 워드를 전송하도록 전송 태스크에 알립니다.
+// 큐가 가득 차면 패킷을 버리거나 합치지 않고 자리가 날 때까지 기다립니다. (지연은 페이싱 오버런으로 보고됨)
+// 기다리는 중에 취소 요청이 있으면 패킷을 버리고 돌아갑니다. (전송이 멈춰도 cv_cancel로 캡처 태스크를 풀 수 있음)
+void K40_INA226_push_block(uint32_t offset, int words, uint16_t flags) {
+    K43_BLOCK_DESC_t desc;
+    desc.offset = offset;
+    desc.words  = (uint16_t)words;
+    desc.flags  = flags;
+    K53_MEM_touch(offset + words);    // 캡처별 블록 사용량
+    while (K43_queue_push(g_K40_INA226_TxQueue, desc) == false) {
+        if (K40_INA226_abort_check()) {
+            return;
+        }
+        g_K40_INA226_TxQueueStalls++;
+        vTaskDelay(1);
+    }
+}
+
+// 캡처 종료 프레임 초기화 함수
+// 버퍼 캡처 시작 시 호출합니다. 캡처 중에 기록되는 필드(dropped 등)를 초기화합니다.
+void K40_INA226_reset_tx_end() {
+    memset(&g_K40_INA226_TxEnd, 0, sizeof(g_K40_INA226_TxEnd));
+    g_K40_INA226_TxEnd.msg          = G_K40_INA226_MSG_TX_COMPLETE;
+    g_K40_INA226_TxEnd.triggerIndex = -1;
+    g_K40_INA226_TxEnd.status       = G_K40_INA226_STATUS_COMPLETE;
+    g_K40_INA226_ErrorBase          = K42_INA226_total_failures() + g_K41_DrdyTimeouts;
+}
+
+// 캡처 종료 프레임 작성 함수
+// 마지막 캡처의 샘플 수와 페이싱 통계(지터, 오버런)를 종료 프레임에 기록합니다.
+// 캡처 함수가 종료 디스크립터(G_K43_BLOCK_END)를 넣기 직전에 호출합니다.
+void K40_INA226_fill_tx_end(int numSamples) {
+    g_K40_INA226_TxEnd.nSamples  = numSamples;
+    g_K40_INA226_TxEnd.periodUs  = (int32_t)g_K41_PaceStats.periodUs;
+    g_K40_INA226_TxEnd.overruns  = (int32_t)g_K41_PaceStats.overruns;
+    g_K40_INA226_TxEnd.maxLateUs = (int32_t)g_K41_PaceStats.maxLateUs;
+    g_K40_INA226_TxEnd.avgLateUs = g_K41_PaceStats.samples ? (int32_t)(g_K41_PaceStats.sumLateUs / g_K41_PaceStats.samples) : 0;
+    g_K40_INA226_TxEnd.i2cErrors = (int32_t)(K42_INA226_total_failures() + g_K41_DrdyTimeouts - g_K40_INA226_ErrorBase);
+}
+
+// 물리 단위를 레지스터 원시값으로 변환하는 함수
+// 션트는 mA (스케일별 LSB), 버스는 V 단위이며 int16 범위로 제한합니다.
+int16_t K40_INA226_to_raw(int source, int scale, float value) {
+    float lsb = (source == G_K40_INA226_TRIG_SRC_BUS) ? G_K40_INA226_LSB_BUS_V : ((scale == G_K40_INA226_SCALE_HI) ? G_K40_INA226_LSB_HI_MA : G_K40_INA226_LSB_LO_MA);
+    float raw = value / lsb;
+    if (raw > 32767.0f) {
+        return 32767;
+    }
+    if (raw < -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)(raw < 0 ? raw - 0.5f : raw + 0.5f);
+}
+
+// 션트 전용 모드의 샘플 주기 계산 함수
+// 설정 레지스터의 평균 횟수와 션트 변환 시간으로 변환 주기를 구하고,
+// 기존 설정 표와 같은 비율(G_K40_INA226_CONV_MARGIN_PCT)의 여유를 더해 10us 단위로 올림합니다. (션트 읽기 시간 이상)
+uint32_t K40_INA226_shunt_only_period(uint16_t cfg) {
+    uint32_t convUs = K40_INA226_conversion_us(cfg, true);
+    uint32_t period = convUs + (convUs * G_K40_INA226_CONV_MARGIN_PCT) / 100;
+    uint32_t i2cUs  = g_K40_INA226_I2cPairUs / 2 + G_K40_INA226_I2C_MARGIN_US;    // 션트 레지스터 하나
+    if (period < i2cUs) {
+        period = i2cUs;
+    }
+    return ((period + 9) / 10) * 10;
+}
+
+// 데이터시트 변환 시간 계산 함수
+// 연속 변환 모드에서 한 결과가 나오는 시간 = 평균 횟수 x (션트 변환 시간 + 버스 변환 시간)
+uint32_t K40_INA226_conversion_us(uint16_t cfg, bool shuntOnly) {
+    uint32_t convUs = g_K40_INA226_ConvTable[(cfg >> 3) & 0x7];
+    if (!shuntOnly) {
+        convUs += g_K40_INA226_ConvTable[(cfg >> 6) & 0x7];
+    }
+    return (uint32_t)g_K40_INA226_AvgTable[(cfg >> 9) & 0x7] * convUs;
+}
+
+// 표에서 값의 코드 찾기 (없으면 -1)
+static int K40_INA226_table_code(const uint16_t* table, int value) {
+    for (int code = 0; code < 8; code++) {
+        if (table[code] == value) {
+            return code;
+        }
+    }
+    return -1;
+}
+
+// 설정 계산 함수
+// 평균 횟수와 변환 시간(데이터시트 값, 션트/버스 비대칭 허용)으로 설정 레지스터 값과 샘플 주기를 계산합니다.
+// 주기는 변환 시간에 여유를 더한 값이며, 시작 시 측정한 샘플당 I2C 읽기 시간보다 짧으면 I2C 시간으로 늘립니다.
+// 표에 없는 값이면 false를 반환합니다. (info.valid = 0)
+bool K40_INA226_config_build(int avg, int busUs, int shuntUs, bool shuntOnly, K40_INA226_CFG_INFO_t& info) {
+    memset(&info, 0, sizeof(info));
+    info.msg     = G_K40_INA226_MSG_CFG_INFO;
+    info.avg     = avg;
+    info.busUs   = shuntOnly ? 0 : busUs;
+    info.shuntUs = shuntUs;
+    int avgCode   = K40_INA226_table_code(g_K40_INA226_AvgTable, avg);
+    int busCode   = shuntOnly ? 0 : K40_INA226_table_code(g_K40_INA226_ConvTable, busUs);
+    int shuntCode = K40_INA226_table_code(g_K40_INA226_ConvTable, shuntUs);
+    if ((avgCode < 0) || (busCode < 0) || (shuntCode < 0)) {
+        return false;
+    }
+    uint16_t cfg = 0x4000 | (avgCode << 9) | (busCode << 6) | (shuntCode << 3);
+    uint32_t convUs = K40_INA226_conversion_us(cfg, shuntOnly);
+    uint32_t period = convUs + (convUs * G_K40_INA226_CONV_MARGIN_PCT) / 100;
+    uint32_t i2cUs  = shuntOnly ? g_K40_INA226_I2cPairUs / 2 : g_K40_INA226_I2cPairUs;    // 션트 전용은 레지스터 하나
+    if (i2cUs + G_K40_INA226_I2C_MARGIN_US > period) {
+        period          = i2cUs + G_K40_INA226_I2C_MARGIN_US;
+        info.i2cLimited = 1;
+    }
+    info.valid       = 1;
+    info.cfg         = cfg;
+    info.convUs      = (int32_t)convUs;
+    info.periodUs    = (int32_t)(((period + 9) / 10) * 10);
+    info.i2cUs       = (int32_t)i2cUs;
+    info.oversample  = 1;
+    info.outPeriodUs = info.periodUs;
+    info.met         = 1;
+    return true;
+}
+
+// 샘플당 I2C 읽기 시간 측정 함수
+// 변환 완료를 기다리지 않고 션트와 버스 레지스터 읽기를 반복하여 평균 시간을 구합니다. (시작 시 한 번)
+void K40_INA226_measure_i2c() {
+    uint16_t shunt, bus;
+    K40_INA226_read_shunt_bus(shunt, bus);    // 포인터 상태를 캡처와 같게 맞춤
+    int64_t t0 = esp_timer_get_time();
+    for (int inx = 0; inx < G_K40_INA226_I2C_CAL_SAMPLES; inx++) {
+        K40_INA226_read_shunt_bus(shunt, bus);
+    }
+    g_K40_INA226_I2cPairUs = (uint32_t)((esp_timer_get_time() - t0) / G_K40_INA226_I2C_CAL_SAMPLES);
+    ESP_LOGI(G_K40_TAG, "I2C shunt + bus read = %uus", g_K40_INA226_I2cPairUs);
+}
+
+// 시작 프레임의 주기 워드
+// 32767us 이하는 us 단위, 그보다 길면 음수 ms 단위로 기록합니다. (평균 1024 같은 긴 주기가 int16을 넘지 않도록)
+int16_t K40_INA226_period_word(uint32_t periodUs) {
+    if (periodUs <= 32767) {
+        return (int16_t)periodUs;
+    }
+    uint32_t ms = (periodUs + 500) / 1000;
+    return (int16_t)(ms > 32767 ? -32767 : -(int32_t)ms);
+}
+
+// 경고 한계 도달 대기 함수
+// 경고 한계 레지스터와 경고 기능(SOL/SUL/BOL/BUL)을 래치 모드로 설정하고 ALERT 핀이 LOW가 될 때까지 블록합니다.
+// 비교는 INA226이 변환마다 수행하므로 기다리는 동안 I2C 통신이 없습니다.
+// 반환 시 래치는 해제되어 있고 경고 기능은 꺼져 있습니다.
+bool K40_INA226_wait_alert_limit(uint16_t function, int16_t limit, uint32_t t0Ms, uint32_t timeoutMs) {
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, 0);                  // 경고 기능 끄기
+    K40_INA226_read_reg(G_K40_INA226_REG_MASK);                      // 남아 있는 래치 해제
+    K40_INA226_write_reg(G_K40_INA226_REG_ALERT, (uint16_t)limit);   // 한계값 (비교 레지스터와 같은 형식)
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, function | G_K40_INA226_MASK_LEN);
+    // ALERT 핀이 LOW가 될 때까지 블록 (드문 이벤트, 취소 확인 주기마다 깨어남)
+    bool reached = true;
+    while (!K41_INA226_wait_alert(G_K40_INA226_ABORT_POLL_MS)) {
+        if (K40_INA226_abort_check() || K40_INA226_wait_expired(t0Ms, timeoutMs)) {
+            reached = false;
+            break;
+        }
+    }
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, 0);
+    K40_INA226_read_reg(G_K40_INA226_REG_MASK);                      // 래치 해제
+    return reached;
 }
 
 // int K40_Calc_MaxSamples(){
@@ -202,6 +966,7 @@ bool K40_INA226_capture_oneshot(volatile MEASURE_t& measure, volatile int16_t* b
 
     // 현재 설정된 측정 스케일에 따라 션트 저항을 전환합니다.
     K50_INA226_switch_scale(measure.m.cv_meas.scale);
+    K41_INA226_drdy_begin();    // ALERT 핀 인터럽트 연결 (변환 완료 시 태스크 깨움)
 
     // 경고 핀(알림 핀)이 준비되면 LOW로 전환됨
     // G_K40_INA226_REG_MASK 레지스터에 0x0400을 쓰면 변환 완료 시 알림 핀이 LOW로 설정됨.
@@ -213,19 +978,18 @@ bool K40_INA226_capture_oneshot(volatile MEASURE_t& measure, volatile int16_t* b
     K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0003);    // 원샷 변환 시작 (션트 및 버스)
 
     // 첫 번째 샘플 무시
-    while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);     // 알림 핀이 LOW가 될 때까지 대기
-    reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);     // 션트 전압 읽기
-    reg_bus      = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);     // 버스 전압 읽기
+    K41_INA226_wait_drdy();     // 알림 핀이 LOW가 될 때까지 대기
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);     // 션트 및 버스 전압 읽기
 
     // 두 번째 샘플을 측정
     uint32_t tstart = micros();                                    // 측정 시작 시간 기록
     K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0003);    // 변환 시작
-    while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);                        // 알림 핀이 LOW가 될 때까지 대기
+    K41_INA226_wait_drdy();                        // 알림 핀이 LOW가 될 때까지 대기
     uint32_t tend = micros();                                    // 측정 완료 시간 기록
 
     // 샘플을 읽고 버퍼에 저장
-    reg_shunt          = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);     // 션트 전압 읽기
-    reg_bus              = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);     // 버스 전압 읽기
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);     // 션트 및 버스 전압 읽기
+    K41_INA226_drdy_end();                                        // ALERT 핀 인터럽트 해제
     int16_t shunt_i16 = (int16_t)reg_shunt;             // 션트 값 저장
 
     // 션트 값이 오프스케일인지(최대 값에 도달했는지) 확인
@@ -235,12 +999,15 @@ bool K40_INA226_capture_oneshot(volatile MEASURE_t& measure, volatile int16_t* b
     buffer[4]      = offScale ? 1 : 0;  // 오프스케일 상태 저장
 
     // 측정된 전류 및 전압 값을 계산
-    measure.m.cv_meas.iavgma     = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? shunt_i16 * 0.05f : shunt_i16 * 0.002381f;
+    measure.m.cv_meas.iavgma     = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? shunt_i16 * G_K40_INA226_LSB_HI_MA : shunt_i16 * G_K40_INA226_LSB_LO_MA;
     measure.m.cv_meas.iminma     = measure.m.cv_meas.iavgma;
     measure.m.cv_meas.imaxma     = measure.m.cv_meas.iavgma;
-    measure.m.cv_meas.vavg         = reg_bus * 0.00125f;
+    measure.m.cv_meas.vavg         = reg_bus * G_K40_INA226_LSB_BUS_V;
     measure.m.cv_meas.vmax         = measure.m.cv_meas.vavg;
     measure.m.cv_meas.vmin         = measure.m.cv_meas.vavg;
+    measure.m.cv_meas.pavgmw     = measure.m.cv_meas.iavgma * measure.m.cv_meas.vavg;
+    measure.m.cv_meas.pmaxmw     = measure.m.cv_meas.pavgmw;
+    measure.m.cv_meas.pminmw     = measure.m.cv_meas.pavgmw;
     measure.m.cv_meas.sampleRate = 1000000.0f / (float)(tend - tstart);     // 샘플링 속도 계산
 
     // 측정 결과 로그 출력
@@ -248,12 +1015,9 @@ bool K40_INA226_capture_oneshot(volatile MEASURE_t& measure, volatile int16_t* b
              measure.m.cv_meas.cfg, measure.m.cv_meas.scale, (tend - tstart),
              (int)(measure.m.cv_meas.sampleRate + 0.5f), measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
 
-    // 매뉴얼 스케일인 경우 미터 준비 완료 상태로 설정
-    if (manualScale == true) {
-        g_K40_INA226_MeterReadyFlag = true;
-    } else {
-        // 오프스케일이 아닌 경우에만 미터 준비 완료 플래그를 설정
-        g_K40_INA226_MeterReadyFlag = !offScale;
+    // 매뉴얼 스케일이거나 오프스케일이 아닌 경우에만 미터 결과 전송
+    if ((manualScale == true) || (offScale == false)) {
+        K40_INA226_push_block(0, 5, G_K43_BLOCK_METER);
     }
 
     return !offScale;  // 오프스케일 상태면 false 반환
@@ -269,6 +1033,7 @@ bool K40_INA226_capture_averaged_sample(volatile MEASURE_t& measure, volatile in
     buffer[0] = G_K40_INA226_MSG_TX_CV_METER;            // 미터 메시지
     buffer[1] = measure.m.cv_meas.scale;    // 현재 스케일 저장
     K50_INA226_switch_scale(measure.m.cv_meas.scale);    // 스케일 전환
+    K41_INA226_drdy_begin();    // ALERT 핀 인터럽트 연결 (변환 완료 시 태스크 깨움)
 
     // 변환 준비가 완료되면 알림 핀이 LOW로 설정됨
     K40_INA226_write_reg(G_K40_INA226_REG_MASK, 0x0400);
@@ -277,9 +1042,8 @@ bool K40_INA226_capture_averaged_sample(volatile MEASURE_t& measure, volatile in
     K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
 
     // 첫 번째 샘플 무시
-    while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);     // 알림 핀이 LOW가 될 때까지 대기
-    reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);     // 션트 전압 읽기
-    reg_bus      = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);     // 버스 전압 읽기
+    K41_INA226_wait_drdy();     // 알림 핀이 LOW가 될 때까지 대기
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);     // 션트 및 버스 전압 읽기
 
     // 평균을 내기 위한 여러 샘플 수집 시작
     uint32_t tstart = micros();
@@ -287,13 +1051,15 @@ bool K40_INA226_capture_averaged_sample(volatile MEASURE_t& measure, volatile in
     savg = bavg        = 0;
     int     numSamples = 400000 / (int)measure.m.cv_meas.periodUs;     // 주어진 주기 동안의 샘플 수 계산
     bool offScale    = false;
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
 
     // 주어진 주기 동안 샘플을 수집
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);    // 절대 데드라인 페이싱 시작
     while (inx < numSamples) {
-        uint32_t t1 = micros();
-        while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);     // 알림 핀이 LOW가 될 때까지 대기
-        reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);     // 션트 전압 읽기
-        reg_bus      = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);     // 버스 전압 읽기
+        K41_INA226_pace_wait(inx);    // 샘플링 데드라인 (t0 + inx * periodUs) 대기
+        K41_INA226_wait_drdy();     // 알림 핀이 LOW가 될 때까지 대기
+        K40_INA226_read_shunt_bus(reg_shunt, reg_bus);     // 션트 및 버스 전압 읽기
 
         data_i16 = (int16_t)reg_shunt;
         if ((data_i16 == 32767) || (data_i16 == -32768)) {
@@ -303,19 +1069,22 @@ bool K40_INA226_capture_averaged_sample(volatile MEASURE_t& measure, volatile in
 
         data_i16 = (int16_t)reg_bus;
         bavg += (int32_t)data_i16;    // 버스 값 누적
+        K40_INA226_power_add(ps, (int16_t)reg_shunt, data_i16);    // 샘플별 전력 (평균 전류 x 평균 전압이 아님)
 
-        while ((micros() - t1) < measure.m.cv_meas.periodUs);  // 샘플링 주기 대기
         inx++;
     }
+    K41_INA226_pace_end(numSamples);    // 마지막 샘플 주기 종료까지 대기
 
     uint32_t us                     = micros() - tstart;                              // 전체 측정 시간 계산
+    K41_INA226_drdy_end();                                                            // ALERT 핀 인터럽트 해제
     measure.m.cv_meas.sampleRate = (1000000.0f * (float)numSamples) / (float)us;  // 샘플링 속도 계산
 
     // 션트와 버스 평균값 계산
     savg                     = savg / numSamples;
-    measure.m.cv_meas.iavgma = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? savg * 0.05f : savg * 0.002381f;
+    measure.m.cv_meas.iavgma = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? savg * G_K40_INA226_LSB_HI_MA : savg * G_K40_INA226_LSB_LO_MA;
     bavg                     = bavg / numSamples;
-    measure.m.cv_meas.vavg     = bavg * 0.00125f;
+    measure.m.cv_meas.vavg     = bavg * G_K40_INA226_LSB_BUS_V;
+    K40_INA226_power_end(measure, ps);
 
     buffer[2] = (int16_t)savg;       // 평균 션트 값 버퍼에 저장
     buffer[3] = (int16_t)bavg;       // 평균 버스 값 버퍼에 저장
@@ -324,11 +1093,9 @@ bool K40_INA226_capture_averaged_sample(volatile MEASURE_t& measure, volatile in
     // 결과 로그 출력
     ESP_LOGI(G_K40_TAG, "CV Meter sample : %s %.1fV %.3fmA\n", measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI", measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
 
-    // 매뉴얼 스케일 설정
-    if (manualScale == true) {
-        g_K40_INA226_MeterReadyFlag = true;
-    } else {
-        g_K40_INA226_MeterReadyFlag = !offScale;     // 오프스케일이 아니면 준비 완료
+    // 매뉴얼 스케일이거나 오프스케일이 아니면 미터 결과 전송
+    if ((manualScale == true) || (offScale == false)) {
+        K40_INA226_push_block(0, 5, G_K43_BLOCK_METER);
     }
 
     return !offScale;  // 오프스케일이면 false 반환
@@ -338,14 +1105,36 @@ bool K40_INA226_capture_averaged_sample(volatile MEASURE_t& measure, volatile in
 // 이 함수는 지정된 수의 샘플을 버퍼에 저장하며, 전환이 완료되면 데이터가 전송됩니다.
 // 트리거는 일정한 주기 동안 반복해서 데이터를 캡처하고, 버퍼가 가득 차면 이를 전송하는 방식입니다.
 void K40_INA226_capture_buffer_triggered(volatile MEASURE_t& measure, volatile int16_t* buffer) {
-    int16_t     smax, smin, bmax, bmin, data_i16;                           // 션트 및 버스 전압 최소/최대 값
-    int32_t     savg, bavg;                                               // 션트 및 버스 값 누적을 위한 평균 계산 변수
+    int16_t     data_i16;
     uint16_t reg_bus, reg_shunt;                                       // 션트 및 버스 레지스터 값
-    smax = bmax = -32768;                                               // 초기 최소값 설정
-    smin = bmin = 32767;                                               // 초기 최대값 설정
-    savg = bavg             = 0;                                           // 션트 및 버스 평균 값 누적 초기화
-    int samplesPerSecond = 1000000 / (int)measure.m.cv_meas.periodUs;  // 초당 샘플 수 계산
-    K50_INA226_switch_scale(measure.m.cv_meas.scale);                               // 스케일 전환
+    K48_STATS_t cs, bs;                                                 // 전류 (자동 범위는 LO LSB 단위) 및 버스 전압 통계
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    K48_INA226_stats_begin(bs, NULL);
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);    // 초당 샘플 수 계산
+    K40_INA226_AUTORANGE_t ar;
+    K40_INA226_autorange_begin(ar, measure.m.cv_meas.scale);
+    int oversample = measure.m.cv_meas.oversample > 1 ? measure.m.cv_meas.oversample : 1;    // 출력 샘플당 읽기 수 (periodUs는 출력 주기)
+    bool power   = (measure.m.cv_meas.channels & G_K40_INA226_CH_POWER) != 0;    // 전력 채널 추가 (샘플당 1워드, 채널 헤더)
+    int  markers = (measure.m.cv_meas.channels & G_K40_INA226_CH_MARKER) ? measure.m.cv_meas.markers : 0;    // 마커 비트필드 채널 (샘플당 1워드)
+    if ((markers < 0) || (markers > G_K00_NUM_MARKERS)) {
+        markers = G_K00_NUM_MARKERS;
+    }
+    int  stride  = 2 + (power ? 1 : 0) + (markers ? 1 : 0);             // 샘플당 워드 수
+    int  mkIndex = power ? 3 : 2;                                       // 샘플 안의 마커 워드 위치
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
+    // 헤더 + 샘플 + 1초마다 마커 1워드가 버퍼에 들어가도록 제한 (사용자 설정 주기는 클라이언트 한도를 벗어날 수 있음)
+    int maxWords   = g_K40_MaxSamples * 2 - 5;                          // 자동 범위는 범위 패킷 헤더 공간을 남김
+    if (ar.enabled) {
+        maxWords -= 3 * G_K40_INA226_AUTO_MAX_SWITCHES;
+    }
+    int maxSamples = (int)(((int64_t)maxWords * samplesPerSecond) / (stride * samplesPerSecond + 1));
+    if (measure.m.cv_meas.nSamples > maxSamples) {
+        ESP_LOGW(G_K40_TAG, "Capture limited to %d samples", maxSamples);
+        measure.m.cv_meas.nSamples = maxSamples;
+    }
+    K50_INA226_switch_scale(ar.scale);                               // 스케일 전환 (자동이면 HI에서 시작)
+    K41_INA226_drdy_begin();    // ALERT 핀 인터럽트 연결 (변환 완료 시 태스크 깨움)
 
     // 전환 준비가 완료되면 알림 핀이 LOW로 설정됨
     K40_INA226_write_reg(G_K40_INA226_REG_MASK, 0x0400);
@@ -353,84 +1142,89 @@ void K40_INA226_capture_buffer_triggered(volatile MEASURE_t& measure, volatile i
     K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
 
     // 첫 번째 샘플 무시
-    while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);     // 알림 핀이 LOW가 될 때까지 대기
-    reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);     // 션트 전압 읽기
-    reg_bus      = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);     // 버스 전압 읽기
+    K41_INA226_wait_drdy();     // 알림 핀이 LOW가 될 때까지 대기
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);     // 션트 및 버스 전압 읽기
 
     uint32_t tstart = micros();     // 측정 시작 시간 기록
     // 버퍼의 헤더에 전송 시작 메시지와 샘플 주기 및 스케일 정보 저장
-    buffer[0]       = G_K40_INA226_MSG_TX_START;
-    buffer[1]       = (int16_t)measure.m.cv_meas.periodUs;
-    buffer[2]       = measure.m.cv_meas.scale;
-    int offset       = 3;         // 버퍼 시작 오프셋
-    g_K40_INA226_EndCaptureFlag = false;     // 캡처 종료 플래그 초기화
+    bool chHeader   = power || (markers > 0);    // 추가 채널이 있으면 채널 헤더
+    buffer[0]       = chHeader ? G_K40_INA226_MSG_TX_START_CH : G_K40_INA226_MSG_TX_START;
+    buffer[1]       = K40_INA226_period_word(measure.m.cv_meas.periodUs);
+    buffer[2]       = ar.scale;
+    buffer[3]       = G_K40_INA226_CH_SHUNT | G_K40_INA226_CH_BUS | (power ? G_K40_INA226_CH_POWER : 0) |
+                      (markers ? (G_K40_INA226_CH_MARKER | (markers << G_K40_INA226_CH_MARKERS_SHIFT)) : 0);
+    int offset       = chHeader ? 4 : 3;    // 버퍼 시작 오프셋
+    int packetStart  = 0;         // 현재 패킷의 시작 워드 (첫 패킷 = 헤더, 이후 = MSG_TX 마커)
+    K40_INA226_reset_tx_end();               // 종료 프레임 초기화
     int inx           = 0;         // 샘플 인덱스 초기화
+    bool aborted      = false;     // 취소 요청 (패킷 경계에서 확인)
 
     // 측정할 샘플 수만큼 반복
-    while (inx < measure.m.cv_meas.nSamples) {
-        uint32_t t1          = micros();
-        int         bufIndex = offset + 2 * inx;    // 버퍼 인덱스 계산
-        while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);    // 알림 핀이 LOW가 될 때까지 대기
-        // 션트 및 버스 전압 읽기
-        reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);
-        reg_bus      = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);    // 절대 데드라인 페이싱 시작
+    while ((inx < measure.m.cv_meas.nSamples) && !aborted) {
+        K41_INA226_pace_wait(inx);                    // 샘플링 데드라인 (t0 + inx * periodUs) 대기
+        int         bufIndex = offset + stride * inx;    // 버퍼 인덱스 계산
+        K41_INA226_wait_drdy();    // 알림 핀이 LOW가 될 때까지 대기
+        if (markers) {
+            buffer[bufIndex + mkIndex] = K40_INA226_marker_word(markers);    // 변환 완료 시점의 마커 레벨
+        }
+        // 션트 및 버스 전압 읽기 (오버샘플링이면 변환 결과 여러 개의 평균)
+        K40_INA226_read_oversampled(oversample, reg_shunt, reg_bus);
 
         // 션트 전압 저장 및 최소/최대 값 갱신
         data_i16         = (int16_t)reg_shunt;
         buffer[bufIndex] = data_i16;
-        savg += (int32_t)data_i16;
-        if (data_i16 > smax)
-            smax = data_i16;
-        if (data_i16 < smin)
-            smin = data_i16;
+        int  sampleScale = ar.scale;    // 이 샘플을 측정한 스케일 (검사 후 전환될 수 있음)
+        bool switched;
+        int32_t value = 0;
+        bool    valid = !K40_INA226_autorange_sample(ar, data_i16, switched);
+        if (valid) {
+            value = (ar.enabled && (sampleScale == G_K40_INA226_SCALE_HI)) ? (int32_t)data_i16 * G_K40_INA226_AUTO_LO_PER_HI : data_i16;
+            K48_INA226_stats_add(cs, value);
+        }
 
         // 버스 전압 저장 및 최소/최대 값 갱신
         data_i16             = (int16_t)reg_bus;
         buffer[bufIndex + 1] = data_i16;
-        bavg += (int32_t)data_i16;
-        if (data_i16 > bmax)
-            bmax = data_i16;
-        if (data_i16 < bmin)
-            bmin = data_i16;
+        K48_INA226_stats_add(bs, data_i16);
+        // 같은 샘플의 전류 x 전압 (블랭킹 샘플 제외)
+        if (valid) {
+            K40_INA226_power_add(ps, value, data_i16);
+        }
+        if (power) {
+            buffer[bufIndex + 2] = K40_INA226_power_word((int16_t)reg_shunt, data_i16);
+        }
 
         // 일정 시간마다 패킷을 분할하여 전송
         if (((inx + 1) % samplesPerSecond) == 0) {
-            // 패킷 메시지 추가 및 전송 샘플 수 설정
-            buffer[bufIndex + 2] = G_K40_INA226_MSG_TX;
+            // 패킷 메시지 추가 및 완성된 패킷을 전송 큐에 추가
             offset++;
-            g_K40_INA226_TxSamples       = samplesPerSecond;
-            g_K40_INA226_EndCaptureFlag = (inx == (measure.m.cv_meas.nSamples - 1)) ? true : false;    // 마지막 샘플인지 확인
-            g_K40_INA226_DataReadyFlag  = true;                                                        // 데이터 준비 완료 플래그 설정
+            aborted = K40_INA226_packet_split(buffer, bufIndex + stride, packetStart, true);
+        }
+        // 범위가 바뀌면 다음 샘플부터 새 범위 패킷
+        if (switched) {
+            K40_INA226_autorange_packet(buffer, ar, offset + stride * (inx + 1), offset, packetStart);
         }
-        // 주기 내에서 다음 샘플링 시간까지 대기
-        while ((micros() - t1) < measure.m.cv_meas.periodUs);
         inx++;
     }
+    K41_INA226_pace_end(inx);    // 마지막 샘플 주기 종료까지 대기
+
+    // 남은 샘플 전송 후 종료 디스크립터 추가
+    K40_INA226_packet_tail(offset + stride * inx, packetStart);
+    K40_INA226_capture_finish(measure, inx, &ps, cs, &bs);
 
     // 전체 측정 시간이 종료된 후 처리
     uint32_t us                     = micros() - tstart;
+    K41_INA226_drdy_end();    // ALERT 핀 인터럽트 해제
+    measure.m.cv_meas.nSamples   = inx;    // 취소되면 그때까지의 샘플 수
     measure.m.cv_meas.sampleRate = (1000000.0f * (float)measure.m.cv_meas.nSamples) / (float)us;
-    // 션트 전압 평균 값 계산
-    savg = savg / measure.m.cv_meas.nSamples;
-    if (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) {
-        measure.m.cv_meas.iavgma = savg * 0.05f;
-        measure.m.cv_meas.imaxma = smax * 0.05f;
-        measure.m.cv_meas.iminma = smin * 0.05f;
-    } else {
-        measure.m.cv_meas.iavgma = savg * 0.002381f;
-        measure.m.cv_meas.imaxma = smax * 0.002381f;
-        measure.m.cv_meas.iminma = smin * 0.002381f;
-    }
-
-    // 버스 전압 평균 값 계산
-    bavg                   = bavg / measure.m.cv_meas.nSamples;
-    measure.m.cv_meas.vavg = bavg * 0.00125f;
-    measure.m.cv_meas.vmax = bmax * 0.00125f;
-    measure.m.cv_meas.vmin = bmin * 0.00125f;
 
     // 최종 로그 출력
+    if (ar.enabled) {
+        ESP_LOGI(G_K40_TAG, "Auto range : %d switches, ended %s", ar.switches, ar.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI");
+    }
     ESP_LOGI(G_K40_TAG, "CV Buffer Triggered : 0x%04X %s %.1fHz %.1fV %.3fmA\n",
-             measure.m.cv_meas.cfg, measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI",
+             measure.m.cv_meas.cfg, ar.enabled ? "AUTO" : (measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI"),
              measure.m.cv_meas.sampleRate, measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
 }
 
@@ -438,104 +1232,598 @@ void K40_INA226_capture_buffer_triggered(volatile MEASURE_t& measure, volatile i
 // 게이트 신호가 들어오면 데이터를 캡처하고, 게이트가 닫히면 캡처를 중지합니다.
 // 주로 외부에서 특정 신호(게이트)가 들어올 때만 측정하고 싶을 때 사용됩니다.
 void K40_INA226_capture_buffer_gated(volatile MEASURE_t& measure, volatile int16_t* buffer) {
-    int16_t     smax, smin, bmax, bmin, data_i16;                           // 션트 및 버스 전압 최소/최대 값
-    int32_t     savg, bavg;                                               // 션트 및 버스 값 누적을 위한 평균 계산 변수
+    int16_t     data_i16;
     uint16_t reg_bus, reg_shunt;                                       // 션트 및 버스 레지스터 값
-    smax = bmax = -32768;                                               // 최소값 초기화
-    smin = bmin = 32767;                                               // 최대값 초기화
-    savg = bavg             = 0;                                           // 누적 값 초기화
-    int samplesPerSecond = 1000000 / (int)measure.m.cv_meas.periodUs;  // 초당 샘플 수 계산
-    K50_INA226_switch_scale(measure.m.cv_meas.scale);                               // 스케일 전환
+    K48_STATS_t cs, bs;                                                 // 전류 (자동 범위는 LO LSB 단위) 및 버스 전압 통계
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    K48_INA226_stats_begin(bs, NULL);
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);    // 초당 샘플 수 계산
+    K40_INA226_AUTORANGE_t ar;
+    K40_INA226_autorange_begin(ar, measure.m.cv_meas.scale);
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
+    // 헤더 + 샘플 + 1초마다 마커 1워드가 버퍼에 들어가도록 제한 (트리거 캡처와 같음)
+    int maxWords   = g_K40_MaxSamples * 2 - 5;                          // 자동 범위는 범위 패킷 헤더 공간을 남김
+    if (ar.enabled) {
+        maxWords -= 3 * G_K40_INA226_AUTO_MAX_SWITCHES;
+    }
+    int maxSamples = (int)(((int64_t)maxWords * samplesPerSecond) / (2 * samplesPerSecond + 1));
+    bool        packed = measure.m.cv_meas.packed != 0;    // 압축 블록으로 저장 (버퍼 공간은 K52_INA226_pack_room으로 확인)
+    K52_PACK_t& pk     = g_K52_Pack;
+    K50_INA226_switch_scale(ar.scale);                               // 스케일 전환 (자동이면 HI에서 시작)
+    K41_INA226_drdy_begin();    // ALERT 핀 인터럽트 연결 (변환 완료 시 태스크 깨움)
+    K41_INA226_gate_begin();    // 게이트 에지 시각 기록
+    K40_INA226_EDGE_t edge;     // 게이트 에지로 자른 첫/마지막 샘플 가중 평균
+    int64_t halfConvUs = K40_INA226_conversion_us(measure.m.cv_meas.cfg, false) / 2;    // 변환 완료 시각 → 변환 구간 중앙
 
     // 전환 준비가 완료되면 알림 핀이 LOW로 설정됨
     K40_INA226_write_reg(G_K40_INA226_REG_MASK, 0x0400);
     // 션트 및 버스 전압을 연속 변환 모드로 설정
     K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
     // 첫 번째 샘플 무시
-    while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);     // 알림 핀이 LOW가 될 때까지 대기
-    reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);     // 션트 전압 읽기
-    reg_bus      = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);     // 버스 전압 읽기
+    K41_INA226_wait_drdy();     // 알림 핀이 LOW가 될 때까지 대기
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);     // 션트 및 버스 전압 읽기
 
     // 게이트 신호가 활성화되면 데이터 캡처 시작
     buffer[0]       = G_K40_INA226_MSG_TX_START;                           // 버퍼의 시작 위치에 시작 메시지 기록
-    buffer[1]       = (int16_t)measure.m.cv_meas.periodUs;  // 샘플 주기 저장
-    buffer[2]       = measure.m.cv_meas.scale;               // 현재 스케일 저장
+    buffer[1]       = K40_INA226_period_word(measure.m.cv_meas.periodUs);  // 샘플 주기 저장
+    buffer[2]       = ar.scale;                              // 현재 스케일 저장 (자동이면 시작 스케일)
     int offset       = 3;                                       // 버퍼 시작 위치 설정
     int numSamples = 0;                                       // 캡처된 샘플 수 초기화
-    g_K40_INA226_EndCaptureFlag = false;                                   // 캡처 종료 플래그 초기화
+    int packetStart = 0;                                      // 현재 패킷의 시작 워드 (첫 패킷 = 헤더, 이후 = MSG_TX 마커)
+    int packetSamples = 0;                                    // 전송한 패킷의 샘플 수 (압축 블록)
+    if (packed) {
+        buffer[0] = G_K40_INA226_MSG_TX_START_PACKED;
+        buffer[3] = G_K52_BLOCK_SAMPLES;
+        offset    = 4;
+        K52_INA226_pack_begin(pk, buffer, offset, 2 * g_K40_MaxSamples);    // 블록 인덱스는 버퍼 끝에서 아래로
+    }
+    K40_INA226_reset_tx_end();                                             // 종료 프레임 초기화
     // 게이트 신호가 LOW인 경우에만 샘플링 수행
-    while (digitalRead(g_K00_PIN_GATE) == HIGH);  // 게이트 신호가 활성화될 때까지 대기
-    g_K40_INA226_GateOpenFlag    = true;                   // 게이트가 열렸음을 알림
+    // 게이트가 열리기 전에 취소되거나 대기 시간을 넘기면 샘플 없이 종료 프레임만 보냄
+    int64_t openUs = 0;
+    bool aborted = !K40_INA226_wait_gate(measure.m.cv_meas.timeoutMs, openUs);
+    bool opened  = !aborted;
+    if (opened) {
+        K40_INA226_push_block(0, 0, G_K43_BLOCK_GATE_OPEN);    // 게이트가 열렸음을 알림
+    }
     uint32_t tstart = micros();               // 캡처 시작 시간 기록
+    uint32_t closes = g_K41_GateCloses;       // 이후의 닫힘 에지가 창의 끝
+    K40_INA226_edge_begin(edge, openUs);
 
     // 게이트가 활성화된 동안 샘플을 수집
-    while ((digitalRead(g_K00_PIN_GATE) == LOW) && (numSamples < g_K40_MaxSamples)) {
-        uint32_t t1          = micros();
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);    // 절대 데드라인 페이싱 시작
+    while (!aborted && (digitalRead(g_K00_PIN_GATE) == LOW) && (packed ? K52_INA226_pack_room(pk) : (numSamples < maxSamples))) {
+        K41_INA226_pace_wait(numSamples);                    // 샘플링 데드라인 (t0 + n * periodUs) 대기
         int         bufIndex = offset + 2 * numSamples;  // 버퍼 인덱스 계산
-        while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH);          // 알림 핀이 LOW가 될 때까지 대기
+        K41_INA226_wait_drdy();          // 알림 핀이 LOW가 될 때까지 대기
+        int64_t sampleUs = g_K41_DrdyUs - halfConvUs;    // 샘플 시각 (변환 구간 중앙)
         // 션트 및 버스 전압 읽기
-        reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);
-        reg_bus      = K40_INA226_read_reg(G_K40_INA226_REG_VBUS);
+        K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
 
         // 션트 전압 저장 및 최소/최대 값 갱신
         data_i16         = (int16_t)reg_shunt;
-        buffer[bufIndex] = data_i16;
-        savg += (int32_t)data_i16;
-        if (data_i16 > smax)
-            smax = data_i16;
-        if (data_i16 < smin)
-            smin = data_i16;
+        if (!packed) {
+            buffer[bufIndex] = data_i16;
+        }
+        int  sampleScale = ar.scale;    // 이 샘플을 측정한 스케일 (검사 후 전환될 수 있음)
+        bool switched;
+        int32_t value = 0;
+        bool    valid = !K40_INA226_autorange_sample(ar, data_i16, switched);
+        if (valid) {
+            value = (ar.enabled && (sampleScale == G_K40_INA226_SCALE_HI)) ? (int32_t)data_i16 * G_K40_INA226_AUTO_LO_PER_HI : data_i16;
+            K48_INA226_stats_add(cs, value);
+            K40_INA226_edge_add(edge, value, sampleUs);
+        }
 
         // 버스 전압 저장 및 최소/최대 값 갱신
         data_i16             = (int16_t)reg_bus;
+        K48_INA226_stats_add(bs, data_i16);
+        if (valid) {
+            K40_INA226_power_add(ps, value, data_i16);    // 같은 샘플의 전류 x 전압
+        }
+
+        if (packed) {
+            // 압축 블록 : 범위가 바뀌면 블록을 끝내고 범위 레코드, 약 1초 분량의 블록마다 패킷 전송
+            bool blockDone = K52_INA226_pack_add(pk, (int16_t)reg_shunt, data_i16);
+            if (switched) {
+                K52_INA226_pack_flush(pk);
+                buffer[pk.w]     = G_K40_INA226_MSG_TX_RANGE;
+                buffer[pk.w + 1] = (int16_t)ar.scale;
+                buffer[pk.w + 2] = (int16_t)ar.blank;
+                pk.w += 3;
+                blockDone = true;
+            }
+            if (blockDone && ((pk.nSamples - packetSamples) >= samplesPerSecond)) {
+                K40_INA226_push_block(packetStart, pk.w - packetStart, packetStart == 0 ? G_K43_BLOCK_START : 0);
+                packetStart   = pk.w;
+                packetSamples = pk.nSamples;
+                aborted       = K40_INA226_abort_check();
+            }
+            numSamples++;
+            continue;
+        }
         buffer[bufIndex + 1] = data_i16;
-        bavg += (int32_t)data_i16;
-        if (data_i16 > bmax)
-            bmax = data_i16;
-        if (data_i16 < bmin)
-            bmin = data_i16;
 
         // 일정 시간마다 패킷을 분할하여 전송
         if (((numSamples + 1) % samplesPerSecond) == 0) {
-            buffer[bufIndex + 2] = G_K40_INA226_MSG_TX;    // 패킷 메시지 추가
             offset++;
-            g_K40_INA226_TxSamples      = samplesPerSecond;
-            g_K40_INA226_DataReadyFlag = true;  // 데이터 준비 완료 플래그 설정
+            aborted = K40_INA226_packet_split(buffer, bufIndex + 2, packetStart, true);    // 패킷 메시지 추가
+        }
+        // 범위가 바뀌면 다음 샘플부터 새 범위 패킷
+        if (switched) {
+            K40_INA226_autorange_packet(buffer, ar, offset + 2 * (numSamples + 1), offset, packetStart);
         }
 
-        while ((micros() - t1) < measure.m.cv_meas.periodUs);  // 샘플링 주기 대기
         numSamples++;
     }
+    int64_t closeUs = opened ? K40_INA226_gate_close_us(closes) : 0;    // 게이트 닫힘 에지 시각
+    K41_INA226_pace_end(numSamples);    // 마지막 샘플 주기 종료까지 대기
+
+    // 남은 샘플 전송 후 종료 디스크립터 추가
+    if (packed) {
+        K52_INA226_pack_flush(pk);
+        if ((packetStart == 0) || (pk.w > packetStart)) {
+            K40_INA226_push_block(packetStart, pk.w - packetStart, packetStart == 0 ? G_K43_BLOCK_START : 0);
+        }
+    } else {
+        K40_INA226_packet_tail(offset + 2 * numSamples, packetStart);
+    }
+    if (opened) {
+        K40_INA226_edge_end(measure, edge, closeUs);    // 게이트 길이와 에지 가중 평균 전류
+    }
+    K40_INA226_capture_finish(measure, numSamples, &ps, cs, &bs);
 
     uint32_t us                     = micros() - tstart;                              // 캡처 종료 시간 기록
-    g_K40_INA226_TxSamples                     = numSamples % samplesPerSecond;                  // 남은 샘플 수 계산
-    g_K40_INA226_EndCaptureFlag                 = true;                                          // 캡처 종료 플래그 설정
-    g_K40_INA226_DataReadyFlag                 = true;                                          // 데이터 준비 완료 플래그 설정
+    K41_INA226_drdy_end();                                                            // ALERT 핀 인터럽트 해제
+    K41_INA226_gate_end();                                                            // 게이트 핀 인터럽트 해제
     measure.m.cv_meas.nSamples     = numSamples;                                      // 총 샘플 수 저장
     measure.m.cv_meas.sampleRate = (1000000.0f * (float)numSamples) / (float)us;  // 샘플 속도 계산
 
-    // 션트 전압 평균 값 계산
-    savg = savg / numSamples;
-    if (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) {
-        measure.m.cv_meas.iavgma = savg * 0.05f;
-        measure.m.cv_meas.imaxma = smax * 0.05f;
-        measure.m.cv_meas.iminma = smin * 0.05f;
-    } else {
-        measure.m.cv_meas.iavgma = savg * 0.002381f;
-        measure.m.cv_meas.imaxma = smax * 0.002381f;
-        measure.m.cv_meas.iminma = smin * 0.002381f;
+    // 최종 로그 출력
+    if (ar.enabled) {
+        ESP_LOGI(G_K40_TAG, "Auto range : %d switches, ended %s", ar.switches, ar.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI");
+    }
+    if (packed && (numSamples > 0)) {
+        ESP_LOGI(G_K40_TAG, "Packed : %d samples in %d blocks, %d words (%.2f bits/sample pair)", numSamples, pk.nBlocks, pk.w - offset,
+                 (16.0f * (pk.w - offset)) / numSamples);
     }
+    if (opened) {
+        ESP_LOGI(G_K40_TAG, "Gate : %dus, first sample %dus weight %.3f, last sample %dus weight %.3f, edge weighted %.3fmA",
+                 g_K40_INA226_TxEnd.gateUs, g_K40_INA226_TxEnd.openLeadUs, (float)g_K40_INA226_TxEnd.wFirstPpm / 1000000.0f,
+                 -g_K40_INA226_TxEnd.closeLagUs, (float)g_K40_INA226_TxEnd.wLastPpm / 1000000.0f, (float)g_K40_INA226_TxEnd.iGateNa / 1000000.0f);
+    }
+    ESP_LOGI(G_K40_TAG, "CV g_K10_Buffer Gated : %.3fsecs 0x%04X %s %.1fHz %.1fV %.3fmA\n",
+             (float)us / 1000000.0f, measure.m.cv_meas.cfg, ar.enabled ? "AUTO" : (measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI"),
+             measure.m.cv_meas.sampleRate, measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
+}
 
-    // 버스 전압 평균 값 계산
-    bavg                   = bavg / numSamples;
-    measure.m.cv_meas.vavg = bavg * 0.00125f;
-    measure.m.cv_meas.vmax = bmax * 0.00125f;
-    measure.m.cv_meas.vmin = bmin * 0.00125f;
+// K40_INA226_capture_stream: 스트리밍 캡처 함수
+// 버퍼를 고정 크기 블록의 링으로 사용하여 전송 태스크가 블록을 비우는 동안 계속 캡처합니다.
+// 블록 헤더 (3워드):
+//   첫 블록        : [MSG_TX_START, periodUs, scale] + 샘플 (헤더부터 전송)
+//   일반 블록      : [-, -, MSG_TX] + 샘플 (세 번째 워드부터 전송)
+//   버림 이후 블록 : [MSG_TX_GAP, 버린 샘플 수 하위 16비트, 상위 16비트] + 샘플 (헤더부터 전송)
+// 링이 가득 차면 기존 블록을 덮어쓰지 않고 새 샘플을 버립니다.
+void K40_INA226_capture_stream(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    int16_t     data_i16;
+    uint16_t reg_bus, reg_shunt;                                       // 션트 및 버스 레지스터 값
+    K48_STATS_t cs, bs;                                                 // 전류 및 버스 전압 통계 (64비트 누적, 장시간 캡처 가능)
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    K48_INA226_stats_begin(bs, NULL);
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
+
+    // 링 크기가 샘플 버퍼보다 크면 캡처 불가
+    int ringBytes = G_K40_INA226_STREAM_NUM_BLOCKS * G_K40_INA226_STREAM_BLOCK_WORDS * (int)sizeof(int16_t);
+    if (ringBytes > g_K40_MaxSamples * 4) {
+        ESP_LOGE(G_K40_TAG, "Stream ring needs %d bytes, sample buffer too small", ringBytes);
+        K40_INA226_reset_tx_end();
+        K40_INA226_push_block(0, 0, G_K43_BLOCK_END);
+        return;
+    }
 
-    // 최종 로그 출력
-    ESP_LOGI(G_K40_TAG, "CV g_K10_Buffer Gated : %.3fsecs 0x%04X %s %.1fHz %.1fV %.3fmA\n",
+    // 블록당 샘플 수 : 최대 1초 분량 (기존 패킷 주기와 동일)
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);
+    int blockSamples     = samplesPerSecond < G_K40_INA226_STREAM_BLOCK_SAMPLES ? samplesPerSecond : G_K40_INA226_STREAM_BLOCK_SAMPLES;
+
+    K50_INA226_switch_scale(measure.m.cv_meas.scale);    // 스케일 전환
+    K41_INA226_drdy_begin();                             // ALERT 핀 인터럽트 연결
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, 0x0400);
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
+
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+    // 링 초기화
+    // 전송 큐에 남은 디스크립터 수 = 전송 태스크가 아직 반환하지 않은 블록 수
+    K40_INA226_reset_tx_end();
+
+    uint32_t          blocks     = 0;       // 완성된 블록 수 (다음 블록의 링 위치)
+    uint32_t          blockOffset = 0;      // 현재 블록의 전송 시작 워드
+    volatile int16_t* block      = NULL;    // 현재 채우는 블록 (NULL = 새 블록 필요)
+    int               fill       = 0;       // 현재 블록의 샘플 수
+    uint32_t          pendingGap = 0;       // 다음 블록 앞에 버려진 샘플 수
+    int               inx        = 0;
+    bool              aborted    = false;   // 취소 요청 (블록 경계에서 확인)
+
+    uint32_t tstart = micros();
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);
+    while ((inx < measure.m.cv_meas.nSamples) && !aborted) {
+        K41_INA226_pace_wait(inx);
+        K41_INA226_wait_drdy();
+        K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+        // 새 블록 시작 : 링이 가득 차 있으면 샘플을 버림
+        if (block == NULL) {
+            if (K43_queue_count(g_K40_INA226_TxQueue) >= G_K40_INA226_STREAM_NUM_BLOCKS) {
+                pendingGap++;
+                g_K40_INA226_TxEnd.dropped++;
+                inx++;
+                aborted = K40_INA226_abort_check();    // 전송이 멈춰 블록이 반환되지 않아도 취소 가능
+                continue;
+            }
+            int slot    = blocks % G_K40_INA226_STREAM_NUM_BLOCKS;
+            blockOffset = slot * G_K40_INA226_STREAM_BLOCK_WORDS;
+            block       = buffer + blockOffset;
+            fill        = 0;
+            if (blocks == 0) {
+                block[0] = G_K40_INA226_MSG_TX_START;
+                block[1] = K40_INA226_period_word(measure.m.cv_meas.periodUs);
+                block[2] = measure.m.cv_meas.scale;
+            } else if (pendingGap > 0) {
+                block[0]   = G_K40_INA226_MSG_TX_GAP;
+                block[1]   = (int16_t)(pendingGap & 0xFFFF);
+                block[2]   = (int16_t)(pendingGap >> 16);
+                pendingGap = 0;
+            } else {
+                block[2] = G_K40_INA226_MSG_TX;
+                blockOffset += 2;    // MSG_TX 마커부터 전송
+            }
+        }
+
+        int bufIndex = G_K40_INA226_STREAM_HDR_WORDS + 2 * fill;
+        data_i16        = (int16_t)reg_shunt;
+        block[bufIndex] = data_i16;
+        K48_INA226_stats_add(cs, data_i16);
+
+        data_i16            = (int16_t)reg_bus;
+        block[bufIndex + 1] = data_i16;
+        K48_INA226_stats_add(bs, data_i16);
+        K40_INA226_power_add(ps, (int16_t)reg_shunt, data_i16);
+        fill++;
+
+        // 블록이 가득 찼거나 마지막 샘플이면 전송 태스크에 넘김
+        if ((fill == blockSamples) || (inx == measure.m.cv_meas.nSamples - 1)) {
+            int words = (int)((block - buffer) + G_K40_INA226_STREAM_HDR_WORDS + 2 * fill - blockOffset);
+            K40_INA226_push_block(blockOffset, words, blocks == 0 ? G_K43_BLOCK_START : 0);
+            blocks++;
+            block   = NULL;
+            aborted = K40_INA226_abort_check();
+        }
+        inx++;
+    }
+    K41_INA226_pace_end(inx);
+
+    uint32_t us = micros() - tstart;
+    K41_INA226_drdy_end();
+    K40_INA226_capture_finish(measure, inx, &ps, cs, &bs);
+
+    measure.m.cv_meas.sampleRate = (1000000.0f * (float)inx) / (float)us;
+
+    ESP_LOGI(G_K40_TAG, "CV Stream : %.3fsecs 0x%04X %s %.1fHz %d dropped %.1fV %.3fmA\n",
              (float)us / 1000000.0f, measure.m.cv_meas.cfg, measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI",
-             measure.m.cv_meas.sampleRate, measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
+             measure.m.cv_meas.sampleRate, g_K40_INA226_TxEnd.dropped, measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
+}
+
+// K40_INA226_capture_pretrig: 프리트리거 캡처 함수
+// 트리거를 기다리는 동안 최근 N개 샘플을 버퍼 끝의 원형 버퍼에 기록합니다.
+// 원형 버퍼가 채워진 뒤부터 트리거 조건을 검사하므로 트리거 이전 구간은 항상 N개 샘플입니다.
+// 트리거가 발생하면 원형 버퍼를 오래된 순서로 선형 출력 영역에 복사하고, 이어서 M개 샘플을 기록합니다.
+// 하드웨어 트리거는 경고 한계 기능을 두 단계로 사용합니다. (상승 : SUL로 레벨 - 히스테리시스 아래를 확인한 뒤 SOL로 레벨 초과 대기)
+// 트리거한 변환 결과가 레지스터에 남아 있으므로 이를 트리거 샘플로 읽습니다.
+// 출력 영역은 트리거 캡처와 같은 형식([MSG_TX_START, periodUs, scale] + 샘플, 1초마다 MSG_TX 마커)이며,
+// 트리거 샘플의 위치(N)는 종료 프레임의 triggerIndex로 보고됩니다.
+void K40_INA226_capture_pretrig(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    int16_t     data_i16;
+    uint16_t reg_bus, reg_shunt;                                       // 션트 및 버스 레지스터 값
+    K48_STATS_t cs, bs;                                                 // 전류 및 버스 전압 통계 (출력 샘플만)
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    K48_INA226_stats_begin(bs, NULL);
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
+
+    K40_INA226_TRIGGER_t trig = g_K40_INA226_Trigger;
+    if (trig.hardware && (trig.slope == G_K40_INA226_TRIG_BOTH)) {
+        ESP_LOGW(G_K40_TAG, "Hardware trigger supports one slope, using software trigger");
+        trig.hardware = false;
+    }
+    if (trig.hardware) {
+        trig.postSamples += trig.preSamples;    // 트리거 전에는 샘플을 읽지 않음
+        trig.preSamples = 0;
+    }
+    int preSamples  = trig.preSamples > 0 ? trig.preSamples : 0;
+    int postSamples = trig.postSamples > 0 ? trig.postSamples : 1;
+    int numSamples  = preSamples + postSamples;
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);
+
+    // 출력 영역 (헤더 + 샘플 + 마커) 뒤에 원형 버퍼를 둘 수 있는지 확인
+    int outWords  = 3 + 2 * numSamples + numSamples / samplesPerSecond + 1;
+    int ringWords = 2 * preSamples;
+    K40_INA226_reset_tx_end();
+    if (outWords + ringWords > g_K40_MaxSamples * 2) {
+        ESP_LOGE(G_K40_TAG, "Pretrigger capture needs %d words, sample buffer too small", outWords + ringWords);
+        K40_INA226_push_block(0, 0, G_K43_BLOCK_END);
+        return;
+    }
+    volatile int16_t* ring = buffer + g_K40_MaxSamples * 2 - ringWords;    // 버퍼 끝의 원형 버퍼
+
+    K50_INA226_switch_scale(measure.m.cv_meas.scale);    // 스케일 전환
+    K41_INA226_drdy_begin();                             // ALERT 핀 인터럽트 연결
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, 0x0400);
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
+
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+    // 트리거 대기 : 원형 버퍼에 기록하면서 레벨 교차 검사
+    bool     armedRise = false;     // 레벨 - 히스테리시스 아래로 내려갔음 (상승 에지 무장)
+    bool     armedFall = false;     // 레벨 + 히스테리시스 위로 올라갔음 (하강 에지 무장)
+    uint32_t n         = 0;         // 페이싱 샘플 인덱스 (트리거 대기 + 이후 샘플)
+    int      ringHead  = 0;         // 다음에 기록할 원형 버퍼 위치 (= 가장 오래된 샘플)
+    int      waited    = 0;         // 원형 버퍼에 기록된 샘플 수 (preSamples에서 포화)
+    uint16_t trigShunt = 0;         // 트리거 샘플
+    uint16_t trigBus   = 0;
+    bool     fired     = true;      // 트리거 발생 (취소 또는 대기 시간 초과이면 false)
+    uint32_t t0Ms      = millis();  // 트리거 대기 시작 (cv_meas.timeoutMs 기준)
+    g_K40_INA226_CaptureState = G_K40_INA226_STATE_WAITING;
+
+    if (trig.hardware) {
+        // 무장 단계 (레벨 반대편 히스테리시스 지점 통과) 후 트리거 단계
+        bool     bus   = (trig.source == G_K40_INA226_TRIG_SRC_BUS);
+        bool     rise  = (trig.slope == G_K40_INA226_TRIG_RISE);
+        uint16_t over  = bus ? G_K40_INA226_MASK_BOL : G_K40_INA226_MASK_SOL;
+        uint16_t under = bus ? G_K40_INA226_MASK_BUL : G_K40_INA226_MASK_SUL;
+        int32_t  arm   = rise ? (int32_t)trig.level - trig.hyst : (int32_t)trig.level + trig.hyst;
+        arm            = arm > 32767 ? 32767 : (arm < -32768 ? -32768 : arm);
+        // 칩은 보정 전 원시값으로 비교하므로 한계값을 역변환
+        const K47_CAL_RANGE_t* cal = bus ? &g_K47_Cal[G_K47_RANGE_BUS] : g_K47_ShuntCal;
+        fired = K40_INA226_wait_alert_limit(rise ? under : over, K47_INA226_uncal(cal, (int16_t)arm), t0Ms, measure.m.cv_meas.timeoutMs) &&
+                K40_INA226_wait_alert_limit(rise ? over : under, K47_INA226_uncal(cal, trig.level), t0Ms, measure.m.cv_meas.timeoutMs);
+        K40_INA226_read_shunt_bus(trigShunt, trigBus);    // 트리거한 변환 결과
+        K40_INA226_write_reg(G_K40_INA226_REG_MASK, G_K40_INA226_MASK_CNVR);    // 이후 샘플은 변환 완료 경고 사용
+        K41_INA226_pace_begin(measure.m.cv_meas.periodUs);
+        n = 1;
+    } else {
+        K41_INA226_pace_begin(measure.m.cv_meas.periodUs);
+    }
+    while (!trig.hardware) {
+        K41_INA226_pace_wait(n);
+        K41_INA226_wait_drdy();
+        K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+        n++;
+
+        // 1초 분량 샘플마다 취소 및 대기 시간 확인
+        if (((n % samplesPerSecond) == 0) && (K40_INA226_abort_check() || K40_INA226_wait_expired(t0Ms, measure.m.cv_meas.timeoutMs))) {
+            fired = false;
+            break;
+        }
+
+        // 원형 버퍼가 채워진 뒤에만 트리거 검사
+        if (waited >= preSamples) {
+            int16_t value = (int16_t)(trig.source == G_K40_INA226_TRIG_SRC_BUS ? reg_bus : reg_shunt);
+            fired = ((trig.slope != G_K40_INA226_TRIG_FALL) && armedRise && (value >= trig.level)) ||
+                    ((trig.slope != G_K40_INA226_TRIG_RISE) && armedFall && (value <= trig.level));
+            if (fired) {
+                trigShunt = reg_shunt;    // 트리거 샘플은 이후 구간의 첫 샘플
+                trigBus   = reg_bus;
+                break;
+            }
+            if ((int32_t)value <= (int32_t)trig.level - trig.hyst) {
+                armedRise = true;
+            }
+            if ((int32_t)value >= (int32_t)trig.level + trig.hyst) {
+                armedFall = true;
+            }
+        }
+
+        if (preSamples > 0) {
+            ring[2 * ringHead]     = (int16_t)reg_shunt;
+            ring[2 * ringHead + 1] = (int16_t)reg_bus;
+            ringHead = (ringHead + 1 == preSamples) ? 0 : ringHead + 1;
+            if (waited < preSamples) {
+                waited++;
+            }
+        }
+    }
+    g_K40_INA226_CaptureState = G_K40_INA226_STATE_RUNNING;
+    int ringStart = ringHead;    // 원형 버퍼의 가장 오래된 샘플 위치
+    if (fired) {
+        K40_INA226_push_block(0, 0, G_K43_BLOCK_GATE_OPEN);    // 트리거 발생 알림
+    } else {
+        // 트리거 없이 종료 : 원형 버퍼에 남은 샘플만 전송 (트리거 위치 없음)
+        ringStart   = (waited < preSamples) ? 0 : ringHead;
+        numSamples  = waited;
+        postSamples = 0;
+    }
+    uint32_t tstart = micros();
+
+    // 버퍼의 헤더에 전송 시작 메시지와 샘플 주기 및 스케일 정보 저장
+    buffer[0]       = G_K40_INA226_MSG_TX_START;
+    buffer[1]       = K40_INA226_period_word(measure.m.cv_meas.periodUs);
+    buffer[2]       = measure.m.cv_meas.scale;
+    int offset      = 3;    // 버퍼 시작 오프셋
+    int packetStart = 0;    // 현재 패킷의 시작 워드
+    int inx         = 0;    // 출력 샘플 인덱스
+    bool aborted    = false;    // 트리거 이후 취소 요청 (패킷 경계에서 확인)
+
+    // 트리거 이전 N개 샘플을 오래된 순서로 복사한 뒤, 트리거 샘플부터 M개 샘플을 기록
+    while ((inx < numSamples) && !aborted) {
+        if (inx < preSamples) {
+            int src   = ringStart + inx;
+            src       = (src >= preSamples) ? src - preSamples : src;
+            reg_shunt = (uint16_t)ring[2 * src];
+            reg_bus   = (uint16_t)ring[2 * src + 1];
+        } else if (inx == preSamples) {
+            reg_shunt = trigShunt;
+            reg_bus   = trigBus;
+        } else {
+            K41_INA226_pace_wait(n);
+            K41_INA226_wait_drdy();
+            K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+            n++;
+        }
+        int bufIndex = offset + 2 * inx;
+
+        data_i16         = (int16_t)reg_shunt;
+        buffer[bufIndex] = data_i16;
+        K48_INA226_stats_add(cs, data_i16);
+
+        data_i16             = (int16_t)reg_bus;
+        buffer[bufIndex + 1] = data_i16;
+        K48_INA226_stats_add(bs, data_i16);
+        K40_INA226_power_add(ps, (int16_t)reg_shunt, data_i16);
+
+        // 일정 시간마다 패킷을 분할하여 전송
+        if (((inx + 1) % samplesPerSecond) == 0) {
+            offset++;
+            aborted = K40_INA226_packet_split(buffer, bufIndex + 2, packetStart, inx >= preSamples);    // 트리거 이전 구간 복사는 중단하지 않음
+        }
+        inx++;
+    }
+    K41_INA226_pace_end(n);
+    numSamples  = inx;    // 취소되면 그때까지의 샘플 수
+    postSamples = (inx > preSamples) ? inx - preSamples : 0;
+
+    // 남은 샘플 전송 후 종료 디스크립터 추가
+    K40_INA226_packet_tail(offset + 2 * inx, packetStart);
+    g_K40_INA226_TxEnd.triggerIndex = fired ? preSamples : -1;
+    K40_INA226_capture_finish(measure, numSamples, &ps, cs, &bs);
+
+    uint32_t us = micros() - tstart;
+    K41_INA226_drdy_end();
+    measure.m.cv_meas.nSamples   = numSamples;
+    measure.m.cv_meas.sampleRate = (1000000.0f * (float)postSamples) / (float)us;
+
+    ESP_LOGI(G_K40_TAG, "CV Pretrigger : %d pre %d post, waited %u samples 0x%04X %s %.1fV %.3fmA\n",
+             preSamples, postSamples, n - (uint32_t)postSamples, measure.m.cv_meas.cfg,
+             measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI",
+             measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
+}
+
+// K40_INA226_capture_buffer_shunt: 션트 전용 버퍼 캡처 함수
+// INA226을 션트 전용 연속 변환 모드(0x5)로 설정하고 샘플마다 션트 레지스터만 읽습니다.
+// 버퍼 형식 : [MSG_TX_START_CH, periodUs, scale, G_K40_INA226_CH_SHUNT] + 샘플당 1워드, 1초마다 MSG_TX 마커
+// 샘플당 1워드이므로 버퍼에는 g_K40_MaxSamples의 약 두 배까지 기록할 수 있습니다.
+void K40_INA226_capture_buffer_shunt(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    int16_t     data_i16;
+    uint16_t reg_shunt;
+    K48_STATS_t cs;                                                     // 전류 통계
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);
+
+    // 헤더 4워드 + 샘플 + 1초마다 마커 1워드가 버퍼에 들어가도록 제한
+    int maxSamples = ((g_K40_MaxSamples * 2 - 5) * samplesPerSecond) / (samplesPerSecond + 1);
+    if (measure.m.cv_meas.nSamples > maxSamples) {
+        ESP_LOGW(G_K40_TAG, "Shunt capture limited to %d samples", maxSamples);
+        measure.m.cv_meas.nSamples = maxSamples;
+    }
+    K50_INA226_switch_scale(measure.m.cv_meas.scale);    // 스케일 전환
+    K41_INA226_drdy_begin();                             // ALERT 핀 인터럽트 연결
+
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, G_K40_INA226_MASK_CNVR);
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, (measure.m.cv_meas.cfg & 0xFFF8) | 0x0005);    // 션트 전용 연속 변환
+
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    reg_shunt = K40_INA226_read_reg(G_K40_INA226_REG_SHUNT);
+
+    uint32_t tstart = micros();
+    buffer[0]       = G_K40_INA226_MSG_TX_START_CH;
+    buffer[1]       = K40_INA226_period_word(measure.m.cv_meas.periodUs);
+    buffer[2]       = measure.m.cv_meas.scale;
+    buffer[3]       = G_K40_INA226_CH_SHUNT;
+    int offset      = 4;    // 버퍼 시작 오프셋
+    int packetStart = 0;    // 현재 패킷의 시작 워드
+    K40_INA226_reset_tx_end();
+    int inx         = 0;
+    bool aborted    = false;    // 취소 요청 (패킷 경계에서 확인)
+
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);
+    while ((inx < measure.m.cv_meas.nSamples) && !aborted) {
+        K41_INA226_pace_wait(inx);
+        int bufIndex = offset + inx;
+        K41_INA226_wait_drdy();
+        reg_shunt = K47_INA226_cal_shunt(K40_INA226_read_reg(G_K40_INA226_REG_SHUNT));
+
+        data_i16         = (int16_t)reg_shunt;
+        buffer[bufIndex] = data_i16;
+        K48_INA226_stats_add(cs, data_i16);
+
+        // 일정 시간마다 패킷을 분할하여 전송
+        if (((inx + 1) % samplesPerSecond) == 0) {
+            offset++;
+            aborted = K40_INA226_packet_split(buffer, bufIndex + 1, packetStart, true);
+        }
+        inx++;
+    }
+    K41_INA226_pace_end(inx);
+
+    // 남은 샘플 전송 후 종료 디스크립터 추가
+    K40_INA226_packet_tail(offset + inx, packetStart);
+    K40_INA226_capture_finish(measure, inx, NULL, cs, NULL);    // 전력과 버스 전압은 측정하지 않음
+
+    uint32_t us = micros() - tstart;
+    K41_INA226_drdy_end();
+    measure.m.cv_meas.nSamples   = inx;
+    measure.m.cv_meas.sampleRate = (1000000.0f * (float)inx) / (float)us;
+
+    ESP_LOGI(G_K40_TAG, "CV Buffer Shunt : 0x%04X %s %.1fHz %.3fmA\n",
+             measure.m.cv_meas.cfg, measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI",
+             measure.m.cv_meas.sampleRate, measure.m.cv_meas.iavgma);
+}
+
+// K40_INA226_capture_calib: 보정 점 측정 함수
+// g_K47_Request의 범위에서 보정 전 원시값 G_K47_CAL_SAMPLES개를 평균하여 보정 점으로 기록하고,
+// 새 보정 표를 응답 프레임(MSG_CALIB)으로 전송합니다. (미터 측정과 같이 ACK 대기)
+// 버스 전압 보정은 HI 션트(0.05Ω)로 측정하여 션트 전압 강하를 줄입니다.
+void K40_INA226_capture_calib(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    K47_CALIB_REQUEST_t req = g_K47_Request;
+    uint16_t reg_shunt, reg_bus;
+    bool     bus      = (req.range == G_K47_RANGE_BUS);
+    int64_t  sum      = 0;
+    bool     offScale = false;
+
+    K50_INA226_switch_scale(req.range == G_K47_RANGE_LO ? G_K40_INA226_SCALE_LO : G_K40_INA226_SCALE_HI);
+    K41_INA226_drdy_begin();
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, G_K40_INA226_MASK_CNVR);
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
+
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    K40_INA226_read_shunt_bus_raw(reg_shunt, reg_bus);
+
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);
+    for (int inx = 0; inx < G_K47_CAL_SAMPLES; inx++) {
+        K41_INA226_pace_wait(inx);
+        K41_INA226_wait_drdy();
+        K40_INA226_read_shunt_bus_raw(reg_shunt, reg_bus);
+        int16_t value = (int16_t)(bus ? reg_bus : reg_shunt);
+        offScale      = offScale || (value == 32767) || (value == -32768);
+        sum += value;
+    }
+    K41_INA226_pace_end(G_K47_CAL_SAMPLES);
+    K41_INA226_drdy_end();
+
+    int32_t rawQ4  = (int32_t)((sum * 16 + (sum < 0 ? -G_K47_CAL_SAMPLES / 2 : G_K47_CAL_SAMPLES / 2)) / G_K47_CAL_SAMPLES);
+    int     status = offScale ? G_K47_STATUS_OFFSCALE : K47_INA226_calib_point(req.range, req.point, rawQ4, req.refQ4);
+    K47_CALIB_INFO_t info;
+    K47_INA226_calib_info(info, status, req.range, rawQ4);
+    memcpy((void*)buffer, &info, sizeof(info));
+    K40_INA226_push_block(0, sizeof(info) / sizeof(int16_t), G_K43_BLOCK_METER);
+    ESP_LOGI(G_K40_TAG, "Calibration range %d point %d : raw %.2f status %d", req.range, req.point, rawQ4 / 16.0f, status);
 }
 
 // K50_INA226_test_capture: 테스트용 원샷 샘플 캡처 함수
@@ -0,0 +1,249 @@
+/*
+ * INA226 캡처 스케줄러
+ *
+ * 캡처 태스크가 INA226 변환 완료(ALERT 핀)를 바쁜 대기(busy-polling)로 기다리지 않도록
+ * GPIO 하강 에지 인터럽트와 FreeRTOS 태스크 직접 알림(direct-to-task notification)을 사용합니다.
+ * 변환과 변환 사이에는 캡처 태스크가 블록되므로 코어 1의 주파수 태스크와 idle 태스크가 실행될 수 있습니다.
+ *
+ * 주요 기능:
+ * 1. K41_INA226_drdy_begin()
+ *    - 호출한 태스크를 알림 대상으로 등록하고 ALERT 핀 하강 에지 인터럽트를 연결합니다.
+ *
+ * 2. K41_INA226_drdy_end()
+ *    - ALERT 핀 인터럽트를 해제합니다. (캡처가 끝나면 연속 변환 중에도 ISR이 불리지 않음)
+ *
+ * 3. K41_INA226_wait_drdy() / K41_INA226_wait_alert(uint32_t timeoutMs)
+ *    - ALERT 핀이 LOW가 될 때까지 태스크를 블록합니다.
+ *    - 핀 레벨을 먼저 확인하므로 기존 폴링 루프(while (digitalRead(ALERT) == HIGH);)와 동일한 시점에 반환됩니다.
+ *    - 변환 완료 대기는 G_K41_DRDY_TIMEOUT_MS 후 포기하고 false를 반환합니다. (I2C 오류나 INA226 리셋으로 ALERT가 오지 않아도 코어 1이 멈추지 않음)
+ *
+ * 4. K41_INA226_pace_begin(uint32_t periodUs) / K41_INA226_pace_end(uint32_t n)
+ *    - 하드웨어 타이머를 periodUs 주기로 자동 리로드하여 샘플 데드라인 틱을 발생시킵니다.
+ *    - pace_end()는 마지막 샘플 슬롯이 끝나는 n 번째 데드라인까지 기다린 뒤 타이머를 멈춥니다.
+ *    - 데드라인은 항상 절대 시각(t0 + n * periodUs)이므로 샘플마다 지터가 누적되지 않습니다.
+ *
+ * 5. K41_INA226_pace_wait(uint32_t n)
+ *    - n 번째 데드라인까지 태스크를 블록하고, 늦게 깨어난 시간(지연)과 오버런(한 주기 이상 지연)을 집계합니다.
+ *    - 이미 지난 데드라인이면 즉시 반환하여 다음 샘플에서 타임라인을 따라잡습니다.
+ *
+ * 6. K41_INA226_gate_begin() / K41_INA226_gate_end() / K41_INA226_gate_edge_us(bool open, uint32_t countBefore)
+ *    - 게이트 핀(g_K00_PIN_GATE)의 양쪽 에지 인터럽트에서 esp_timer 시각을 기록합니다. (게이트 캡처, 샘플 주기보다 정확한 창 경계)
+ *    - gate_edge_us()는 countBefore 이후의 열림(하강) 또는 닫힘(상승) 에지 시각을 반환하며, 에지가 없으면 (캡처 시작 전부터 열려 있던 게이트 등) 현재 시각입니다.
+ *
+ * 변환 완료 시각:
+ *    - ALERT ISR은 하강 에지 시각을 g_K41_DrdyUs에 기록합니다. wait_drdy() 직후 읽으면 방금 읽을 변환 결과가 끝난 시각입니다.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "K00_config_002.h"
+
+#define         G_K41_TAG    "K41_sched"
+
+// 알림을 놓쳤을 때를 대비한 최대 블록 시간 (이 시간이 지나면 핀 레벨을 다시 확인)
+#define G_K41_DRDY_RECHECK_MS      10
+
+// 변환 완료 대기 타임아웃 (가장 긴 설정의 변환 주기 1.06초보다 길게)
+#define G_K41_DRDY_TIMEOUT_MS      2000
+
+// 샘플 페이싱용 하드웨어 타이머 (80MHz APB / 80 = 1us 분해능)
+#define G_K41_PACE_TIMER_NUM       0
+#define G_K41_PACE_TIMER_DIVIDER   80
+
+// 게이트 에지 ISR 대기 (바쁜 대기가 핀 변화를 ISR보다 먼저 보았을 때 ISR이 시각을 기록할 때까지 기다리는 최대 시간)
+#define G_K41_GATE_EDGE_WAIT_US    100
+
+// 샘플 페이싱 통계 (캡처마다 초기화)
+typedef struct {
+    uint32_t periodUs;      // 샘플 주기
+    uint32_t samples;       // 페이싱된 샘플 수
+    uint32_t overruns;      // 데드라인을 한 주기 이상 놓친 샘플 수
+    uint32_t maxLateUs;     // 데드라인 대비 최대 지연 (us)
+    uint64_t sumLateUs;     // 데드라인 대비 지연 누적 (평균 계산용)
+} K41_PACE_STATS_t;
+
+// 전역 변수
+static TaskHandle_t     g_K41_CaptureTaskHandle = NULL;    // ALERT ISR이 깨울 캡처 태스크
+volatile uint32_t       g_K41_DrdyIsrCount      = 0;       // ALERT 하강 에지 인터럽트 횟수
+volatile uint32_t       g_K41_DrdyBlockCount    = 0;       // 태스크가 실제로 블록된 횟수
+volatile uint32_t       g_K41_DrdyTimeouts      = 0;       // 변환 완료 대기 타임아웃 횟수 (누적)
+volatile int64_t        g_K41_DrdyUs            = 0;       // 마지막 ALERT 하강 에지 (변환 완료) 시각 (esp_timer 기준)
+
+volatile uint32_t       g_K41_GateOpens         = 0;       // 게이트 열림(하강) 에지 수
+volatile uint32_t       g_K41_GateCloses        = 0;       // 게이트 닫힘(상승) 에지 수
+volatile int64_t        g_K41_GateOpenUs        = 0;       // 마지막 게이트 열림 시각 (esp_timer 기준)
+volatile int64_t        g_K41_GateCloseUs       = 0;       // 마지막 게이트 닫힘 시각
+
+static hw_timer_t*      g_K41_PaceTimer         = NULL;    // 샘플 데드라인 타이머
+volatile uint32_t       g_K41_PaceTickCount     = 0;       // t0 이후 지난 데드라인 수
+static int64_t          g_K41_PaceT0Us          = 0;       // 첫 데드라인 시각 (esp_timer 기준)
+K41_PACE_STATS_t        g_K41_PaceStats;                   // 마지막 캡처의 페이싱 통계
+
+// 함수 선언
+void K41_INA226_drdy_begin();
+void K41_INA226_drdy_end();
+bool K41_INA226_wait_drdy();
+bool K41_INA226_wait_alert(uint32_t timeoutMs);
+void K41_INA226_pace_begin(uint32_t periodUs);
+void K41_INA226_pace_end(uint32_t n);
+void K41_INA226_pace_wait(uint32_t n);
+void K41_INA226_gate_begin();
+void K41_INA226_gate_end();
+int64_t K41_INA226_gate_edge_us(bool open, uint32_t countBefore);
+
+// ALERT 핀 하강 에지 ISR
+// 변환 완료 시 캡처 태스크에 직접 알림을 보냅니다.
+static void IRAM_ATTR K41_INA226_alert_isr() {
+    BaseType_t woken = pdFALSE;
+    g_K41_DrdyUs     = esp_timer_get_time();
+    g_K41_DrdyIsrCount++;
+    if (g_K41_CaptureTaskHandle != NULL) {
+        vTaskNotifyGiveFromISR(g_K41_CaptureTaskHandle, &woken);
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();    // 캡처 태스크로 즉시 전환
+    }
+}
+
+// 캡처 시작 시 호출: 현재 태스크를 알림 대상으로 등록하고 인터럽트 연결
+void K41_INA226_drdy_begin() {
+    g_K41_CaptureTaskHandle = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);    // 이전 캡처에서 남은 알림 제거
+    attachInterrupt(digitalPinToInterrupt(g_K00_PIN_INA226_ALERT), K41_INA226_alert_isr, FALLING);
+}
+
+// 캡처 종료 시 호출: 인터럽트 해제
+void K41_INA226_drdy_end() {
+    detachInterrupt(digitalPinToInterrupt(g_K00_PIN_INA226_ALERT));
+    g_K41_CaptureTaskHandle = NULL;
+}
+
+// ALERT 핀 대기
+// 핀이 이미 LOW이면 즉시 반환하고, HIGH이면 ISR 알림이 올 때까지 블록합니다.
+// 레벨 확인 후 블록 전에 에지가 발생해도 알림이 남아 있으므로 바로 깨어납니다.
+// timeoutMs가 0이면 무한 대기, 아니면 timeoutMs 후 false를 반환합니다.
+bool K41_INA226_wait_alert(uint32_t timeoutMs) {
+    uint32_t t0 = millis();
+    while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH) {
+        if ((timeoutMs != 0) && ((millis() - t0) >= timeoutMs)) {
+            return false;
+        }
+        g_K41_DrdyBlockCount++;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(G_K41_DRDY_RECHECK_MS));
+    }
+    return true;
+}
+
+// 변환 완료 대기 (타임아웃 시 false, 호출한 캡처는 계속 진행)
+bool K41_INA226_wait_drdy() {
+    if (K41_INA226_wait_alert(G_K41_DRDY_TIMEOUT_MS)) {
+        return true;
+    }
+    g_K41_DrdyTimeouts++;
+    ESP_LOGW(G_K41_TAG, "Conversion ready timeout (%u)", g_K41_DrdyTimeouts);
+    return false;
+}
+
+// 페이싱 타이머 ISR
+// 데드라인 틱을 세고 캡처 태스크를 깨웁니다.
+static void IRAM_ATTR K41_INA226_pace_isr() {
+    BaseType_t woken = pdFALSE;
+    g_K41_PaceTickCount++;
+    if (g_K41_CaptureTaskHandle != NULL) {
+        vTaskNotifyGiveFromISR(g_K41_CaptureTaskHandle, &woken);
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// 페이싱 시작: 지금을 t0로 하고 periodUs 주기의 데드라인 틱 발생
+void K41_INA226_pace_begin(uint32_t periodUs) {
+    if (g_K41_PaceTimer == NULL) {
+        g_K41_PaceTimer = timerBegin(G_K41_PACE_TIMER_NUM, G_K41_PACE_TIMER_DIVIDER, true);
+        timerAttachInterrupt(g_K41_PaceTimer, K41_INA226_pace_isr, true);
+    }
+    memset(&g_K41_PaceStats, 0, sizeof(g_K41_PaceStats));
+    g_K41_PaceStats.periodUs = periodUs;
+
+    timerAlarmDisable(g_K41_PaceTimer);
+    g_K41_PaceTickCount = 0;
+    timerWrite(g_K41_PaceTimer, 0);
+    timerAlarmWrite(g_K41_PaceTimer, periodUs, true);    // 자동 리로드 : 데드라인이 t0 기준으로 고정됨
+    g_K41_PaceT0Us = esp_timer_get_time();
+    timerAlarmEnable(g_K41_PaceTimer);
+}
+
+// 데드라인 틱이 n 이상이 될 때까지 블록
+static void K41_INA226_pace_sleep_until(uint32_t n) {
+    while (g_K41_PaceTickCount < n) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(G_K41_DRDY_RECHECK_MS + g_K41_PaceStats.periodUs / 1000));
+    }
+}
+
+// 페이싱 종료: 마지막 샘플 슬롯(n 번째 데드라인)이 끝날 때까지 기다린 뒤 타이머 정지
+void K41_INA226_pace_end(uint32_t n) {
+    K41_INA226_pace_sleep_until(n);
+    if (g_K41_PaceTimer != NULL) {
+        timerAlarmDisable(g_K41_PaceTimer);
+    }
+    ESP_LOGD(G_K41_TAG, "Pacing : %u samples, %u overruns, max late %uus, avg late %uus",
+             g_K41_PaceStats.samples, g_K41_PaceStats.overruns, g_K41_PaceStats.maxLateUs,
+             g_K41_PaceStats.samples ? (uint32_t)(g_K41_PaceStats.sumLateUs / g_K41_PaceStats.samples) : 0);
+}
+
+// n 번째 데드라인 (t0 + n * periodUs) 까지 대기
+void K41_INA226_pace_wait(uint32_t n) {
+    K41_INA226_pace_sleep_until(n);
+
+    // 데드라인 대비 지연 집계
+    int64_t  deadlineUs = g_K41_PaceT0Us + (int64_t)n * g_K41_PaceStats.periodUs;
+    int64_t  lateUs     = esp_timer_get_time() - deadlineUs;
+    uint32_t late       = lateUs > 0 ? (uint32_t)lateUs : 0;
+    g_K41_PaceStats.samples++;
+    g_K41_PaceStats.sumLateUs += late;
+    if (late > g_K41_PaceStats.maxLateUs) {
+        g_K41_PaceStats.maxLateUs = late;
+    }
+    if (late >= g_K41_PaceStats.periodUs) {
+        g_K41_PaceStats.overruns++;    // 다음 데드라인까지 지나버림
+    }
+}
+
+// 게이트 핀 에지 ISR
+// 에지 직후의 핀 레벨로 열림(LOW)과 닫힘(HIGH)을 구분하여 시각을 기록합니다.
+static void IRAM_ATTR K41_INA226_gate_isr() {
+    int64_t t = esp_timer_get_time();
+    if (digitalRead(g_K00_PIN_GATE) == LOW) {
+        g_K41_GateOpenUs = t;
+        g_K41_GateOpens++;
+    } else {
+        g_K41_GateCloseUs = t;
+        g_K41_GateCloses++;
+    }
+}
+
+// 게이트 캡처 시작 시 호출: 게이트 핀 양쪽 에지 인터럽트 연결
+void K41_INA226_gate_begin() {
+    attachInterrupt(digitalPinToInterrupt(g_K00_PIN_GATE), K41_INA226_gate_isr, CHANGE);
+}
+
+// 게이트 캡처 종료 시 호출: 인터럽트 해제
+void K41_INA226_gate_end() {
+    detachInterrupt(digitalPinToInterrupt(g_K00_PIN_GATE));
+}
+
+// 게이트 에지 시각
+// countBefore(g_K41_GateOpens 또는 g_K41_GateCloses) 이후 에지가 있으면 그 ISR 시각, 없으면 현재 시각을 반환합니다.
+// 핀 변화를 ISR보다 먼저 본 경우를 위해 최대 G_K41_GATE_EDGE_WAIT_US 동안 ISR을 기다립니다.
+int64_t K41_INA226_gate_edge_us(bool open, uint32_t countBefore) {
+    int64_t now = esp_timer_get_time();
+    while ((open ? g_K41_GateOpens : g_K41_GateCloses) == countBefore) {
+        if ((esp_timer_get_time() - now) >= G_K41_GATE_EDGE_WAIT_US) {
+            return now;
+        }
+    }
+    return open ? g_K41_GateOpenUs : g_K41_GateCloseUs;
+}
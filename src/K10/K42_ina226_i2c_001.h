@@ -0,0 +1,534 @@
+/*
+ * INA226 I2C 전송 계층
+ *
+ * INA226 레지스터 읽기/쓰기를 담당하며 장치의 레지스터 포인터를 추적합니다.
+ * INA226은 마지막으로 쓴 레지스터 주소(포인터)를 기억하므로, 포인터가 이미 읽을 레지스터를 가리키면
+ * 주소 쓰기 없이 바로 읽습니다. (션트 전용 캡처처럼 같은 레지스터를 반복해서 읽을 때 전송 바이트가 줄어듦)
+ *
+ * 모든 전송은 결과를 확인합니다. NACK나 타임아웃이 발생하면 포인터 상태를 버리고 재시도하며,
+ * 타임아웃(버스 고착)이거나 재시도도 실패하면 SCL을 토글하여 버스를 복구한 뒤 드라이버를 다시 초기화합니다.
+ * 모든 재시도가 실패한 읽기는 0을 반환하고 실패 횟수에 집계됩니다. (캡처 태스크가 멈추지 않음)
+ *
+ * ESP32의 두 I2C 컨트롤러(버스 0, 1)를 지원합니다. 버스마다 포인터 캐시, 통계, 오류 카운터를 따로 두므로
+ * 서로 다른 태스크가 두 버스를 동시에 사용할 수 있습니다. (같은 버스는 한 태스크만 사용)
+ * bus 인자를 생략하면 버스 0입니다.
+ *
+ * 주요 기능:
+ * 1. K42_INA226_write_reg(uint8_t addr, uint8_t regAddr, uint16_t data, int bus)
+ *    - 레지스터에 16비트 데이터를 씁니다. 쓰기 후 포인터는 해당 레지스터를 가리킵니다.
+ *
+ * 2. K42_INA226_read_reg(uint8_t addr, uint8_t regAddr, int bus)
+ *    - 포인터가 다른 레지스터를 가리키면 주소를 쓰고 재시작 후 읽고, 같으면 바로 읽습니다.
+ *
+ * 3. K42_INA226_read_pair(uint8_t addr, uint8_t regA, uint8_t regB, uint16_t& a, uint16_t& b, int bus)
+ *    - 두 레지스터(션트, 버스)를 연속으로 읽습니다. IDF 백엔드는 두 읽기를 하나의 명령 리스트로 실행합니다.
+ *
+ * 4. K42_INA226_invalidate_pointer(uint8_t addr, int bus)
+ *    - 포인터 상태를 알 수 없게 되었을 때 (리셋 등) 호출합니다. 다음 읽기는 항상 주소를 씁니다.
+ *
+ * 5. K42_INA226_stats_reset() / K42_INA226_stats_log(const char* label)
+ *    - 전송 종류별(쓰기, 주소 쓰기 + 읽기, 바로 읽기) 횟수와 소요 시간(합계, 최대), 지연 히스토그램을 집계하고 출력합니다.
+ *    - 400kHz와 1MHz 클럭에서 포인터 캐싱의 효과를 비교하는 데 사용합니다.
+ *
+ * 6. K42_INA226_i2c_begin(int sda, int scl, int bus) / K42_INA226_bench(uint8_t addr, uint8_t regA, uint8_t regB, int n)
+ *    - 선택된 백엔드로 I2C를 초기화하고, 두 레지스터 읽기를 n번 반복해 샘플 쌍당 소요 시간(us)을 출력합니다.
+ *
+ * 7. K42_INA226_get_errors(int bus) / K42_INA226_total_failures()
+ *    - 부팅 이후 누적된 오류 카운터(NACK, 타임아웃, 재시도, 버스 복구, 최종 실패)를 반환합니다.
+ *
+ * 8. K42_INA226_probe(uint8_t addr, int bus)
+ *    - 재시도와 오류 집계 없이 장치가 응답하는지 확인합니다. (장치 검색용)
+ *
+ * 빌드 플래그:
+ * - G_K42_I2C_CLOCK_HZ : I2C 클럭 (기본 400kHz, 1MHz = Fast-mode Plus, 외부 풀업 저항 필요)
+ * - G_K42_I2C_BACKEND  : G_K42_BACKEND_WIRE (Arduino Wire, 기본) 또는 G_K42_BACKEND_IDF (ESP-IDF I2C 명령 리스트)
+ * - G_K42_I2C_BENCH    : 정의하면 시작 시 K42_INA226_bench() 결과를 출력 (platformio.ini의 i2c_bench_xxx 환경)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define         G_K42_TAG    "K42_i2c"
+
+// I2C 클럭 (빌드 플래그로 변경 가능, 예: -DG_K42_I2C_CLOCK_HZ=1000000)
+#ifndef G_K42_I2C_CLOCK_HZ
+#define G_K42_I2C_CLOCK_HZ          400000
+#endif
+
+// I2C 백엔드 (빌드 플래그로 선택, 예: -DG_K42_I2C_BACKEND=G_K42_BACKEND_IDF)
+#define G_K42_BACKEND_WIRE          0    // Arduino Wire (beginTransmission / requestFrom)
+#define G_K42_BACKEND_IDF           1    // ESP-IDF I2C 드라이버 명령 리스트 (i2c_cmd_link)
+#ifndef G_K42_I2C_BACKEND
+#define G_K42_I2C_BACKEND           G_K42_BACKEND_WIRE
+#endif
+
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+#include <driver/i2c.h>
+#define G_K42_IDF_LINK_BYTES        I2C_LINK_RECOMMENDED_SIZE(8)    // 두 레지스터 읽기 (시작/주소/재시작/읽기 x2 + 정지)
+#endif
+
+// I2C 버스 (ESP32 I2C 컨트롤러) 수
+#define G_K42_NUM_BUSES             2
+
+// 오류 처리
+#define G_K42_TIMEOUT_MS            10   // 전송 타임아웃
+#define G_K42_RETRIES               2    // 실패 시 재시도 횟수
+#define G_K42_RECOVERY_CLOCKS       9    // 버스 복구 시 SCL 펄스 수 (슬레이브가 SDA를 놓을 때까지)
+
+// 전송 결과
+#define G_K42_OK                    0
+#define G_K42_ERR_NACK              1    // 주소 또는 데이터 NACK
+#define G_K42_ERR_TIMEOUT           2    // 타임아웃 (SCL 스트레칭, 버스 고착)
+#define G_K42_ERR_BUS               3    // 기타 버스 오류 (중재 실패 등)
+
+// 지연 히스토그램 : 구간 i = [2^(i+4), 2^(i+5)) us, 첫 구간은 32us 미만, 마지막 구간은 2048us 이상
+#define G_K42_HIST_BUCKETS          8
+
+// 포인터를 추적할 수 있는 장치 수 (INA226 주소 0x40 ~ 0x4F)
+#define G_K42_NUM_DEVICES           16
+#define G_K42_POINTER_UNKNOWN       0xFFFF
+
+// 전송 종류별 통계
+typedef struct {
+    uint32_t count;     // 전송 횟수
+    uint32_t bytes;     // 버스에 실린 바이트 수 (장치 주소 포함)
+    uint64_t sumUs;     // 소요 시간 합계 (us)
+    uint32_t maxUs;     // 최대 소요 시간 (us)
+} K42_I2C_XFER_STATS_t;
+
+typedef struct {
+    K42_I2C_XFER_STATS_t write;       // 레지스터 쓰기
+    K42_I2C_XFER_STATS_t readPtr;     // 주소 쓰기 + 재시작 + 읽기
+    K42_I2C_XFER_STATS_t readBare;    // 포인터 캐시 적중, 바로 읽기
+    K42_I2C_XFER_STATS_t readPair;    // 두 레지스터 읽기를 하나의 명령 리스트로 실행 (IDF 백엔드)
+    uint32_t             latencyHist[G_K42_HIST_BUCKETS];    // 전송 지연 히스토그램 (재시도 포함)
+} K42_I2C_STATS_t;
+
+// 오류 카운터 (부팅 이후 누적, K42_INA226_stats_reset()으로 초기화되지 않음)
+typedef struct {
+    uint32_t nacks;         // NACK 발생 횟수
+    uint32_t timeouts;      // 타임아웃 발생 횟수
+    uint32_t busErrors;     // 기타 버스 오류 횟수
+    uint32_t retries;       // 재시도 횟수
+    uint32_t recoveries;    // SCL 토글 버스 복구 횟수
+    uint32_t failures;      // 재시도 후에도 실패한 전송 수
+} K42_I2C_ERRORS_t;
+
+// 버스별 상태
+typedef struct {
+    bool             begun;                             // K42_INA226_i2c_begin() 호출 여부
+    int              sda;                               // 핀 번호
+    int              scl;
+    uint16_t         pointer[G_K42_NUM_DEVICES];        // 장치별 현재 포인터 레지스터
+    K42_I2C_STATS_t  stats;                             // 전송 통계 (K42_INA226_stats_reset()으로 초기화)
+    K42_I2C_ERRORS_t errors;                            // 오류 카운터 (누적)
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+    uint8_t          linkBuf[G_K42_IDF_LINK_BYTES];     // 명령 리스트 버퍼 (전송마다 malloc하지 않음)
+#endif
+} K42_I2C_BUS_t;
+
+// 전역 변수
+K42_I2C_BUS_t    g_K42_Bus[G_K42_NUM_BUSES];
+
+// 함수 선언
+void     K42_INA226_i2c_begin(int sda, int scl, int bus = 0);
+void     K42_INA226_write_reg(uint8_t addr, uint8_t regAddr, uint16_t data, int bus = 0);
+uint16_t K42_INA226_read_reg(uint8_t addr, uint8_t regAddr, int bus = 0);
+void     K42_INA226_read_pair(uint8_t addr, uint8_t regA, uint8_t regB, uint16_t& a, uint16_t& b, int bus = 0);
+bool     K42_INA226_probe(uint8_t addr, int bus = 0);
+void     K42_INA226_bench(uint8_t addr, uint8_t regA, uint8_t regB, int n);
+void     K42_INA226_invalidate_pointer(uint8_t addr, int bus = 0);
+void     K42_INA226_bus_recover(int bus = 0);
+void     K42_INA226_stats_reset();
+void     K42_INA226_stats_log(const char* label);
+const K42_I2C_ERRORS_t& K42_INA226_get_errors(int bus = 0);
+uint32_t K42_INA226_total_failures();
+
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_WIRE
+// 버스 번호에 해당하는 Wire 인스턴스
+static inline TwoWire& K42_INA226_wire(int bus) {
+    return (bus == 0) ? Wire : Wire1;
+}
+#endif
+
+// 전송 시간 기록
+static inline void K42_INA226_record(K42_I2C_BUS_t& b, K42_I2C_XFER_STATS_t& st, int64_t t0, uint32_t bytes) {
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+    st.count++;
+    st.bytes += bytes;
+    st.sumUs += us;
+    if (us > st.maxUs) {
+        st.maxUs = us;
+    }
+    int bucket = 0;
+    for (uint32_t limit = 32; (us >= limit) && (bucket < G_K42_HIST_BUCKETS - 1); limit <<= 1) {
+        bucket++;
+    }
+    b.stats.latencyHist[bucket]++;
+}
+
+// 드라이버 초기화 (백엔드별)
+static void K42_INA226_driver_init(int bus) {
+    K42_I2C_BUS_t& b = g_K42_Bus[bus];
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+    i2c_config_t conf;
+    memset(&conf, 0, sizeof(conf));
+    conf.mode             = I2C_MODE_MASTER;
+    conf.sda_io_num       = b.sda;
+    conf.scl_io_num       = b.scl;
+    conf.sda_pullup_en    = GPIO_PULLUP_ENABLE;
+    conf.scl_pullup_en    = GPIO_PULLUP_ENABLE;
+    conf.master.clk_speed = G_K42_I2C_CLOCK_HZ;
+    i2c_param_config((i2c_port_t)bus, &conf);
+    esp_err_t err = i2c_driver_install((i2c_port_t)bus, I2C_MODE_MASTER, 0, 0, 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(G_K42_TAG, "i2c_driver_install(%d) failed : %s", bus, esp_err_to_name(err));
+    }
+#else
+    TwoWire& w = K42_INA226_wire(bus);
+    w.begin(b.sda, b.scl);
+    w.setClock(G_K42_I2C_CLOCK_HZ);
+    w.setTimeOut(G_K42_TIMEOUT_MS);
+#endif
+}
+
+// I2C 초기화
+void K42_INA226_i2c_begin(int sda, int scl, int bus) {
+    K42_I2C_BUS_t& b = g_K42_Bus[bus];
+    b.begun          = true;
+    b.sda            = sda;
+    b.scl            = scl;
+    for (int inx = 0; inx < G_K42_NUM_DEVICES; inx++) {
+        b.pointer[inx] = G_K42_POINTER_UNKNOWN;
+    }
+    K42_INA226_driver_init(bus);
+    ESP_LOGI(G_K42_TAG, "I2C%d backend %s @ %dHz", bus, G_K42_I2C_BACKEND == G_K42_BACKEND_IDF ? "IDF" : "Wire", G_K42_I2C_CLOCK_HZ);
+}
+
+// 버스 복구
+// 드라이버를 내리고, 슬레이브가 SDA를 LOW로 잡고 있으면 SCL을 최대 9번 토글하여 진행 중인 바이트를 끝낸 뒤
+// STOP 조건을 만들고 드라이버를 다시 초기화합니다. 버스의 모든 장치의 포인터 상태는 알 수 없게 됩니다.
+void K42_INA226_bus_recover(int bus) {
+    K42_I2C_BUS_t& b = g_K42_Bus[bus];
+    b.errors.recoveries++;
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+    i2c_driver_delete((i2c_port_t)bus);
+#else
+    K42_INA226_wire(bus).end();
+#endif
+    pinMode(b.sda, INPUT_PULLUP);
+    pinMode(b.scl, OUTPUT_OPEN_DRAIN);
+    digitalWrite(b.scl, HIGH);
+    delayMicroseconds(5);
+    for (int inx = 0; (inx < G_K42_RECOVERY_CLOCKS) && (digitalRead(b.sda) == LOW); inx++) {
+        digitalWrite(b.scl, LOW);
+        delayMicroseconds(5);
+        digitalWrite(b.scl, HIGH);
+        delayMicroseconds(5);
+    }
+    // STOP 조건 : SCL HIGH 상태에서 SDA LOW -> HIGH
+    pinMode(b.sda, OUTPUT_OPEN_DRAIN);
+    digitalWrite(b.sda, LOW);
+    delayMicroseconds(5);
+    digitalWrite(b.sda, HIGH);
+    delayMicroseconds(5);
+
+    K42_INA226_driver_init(bus);
+    for (int inx = 0; inx < G_K42_NUM_DEVICES; inx++) {
+        b.pointer[inx] = G_K42_POINTER_UNKNOWN;
+    }
+    ESP_LOGW(G_K42_TAG, "I2C%d bus recovered (%u)", bus, b.errors.recoveries);
+}
+
+// 전송 실패 처리
+// 오류를 집계하고 포인터 상태를 버립니다. 타임아웃/버스 오류이거나 이미 재시도한 전송이면 버스를 복구합니다.
+static void K42_INA226_handle_error(uint8_t addr, int err, int attempt, int bus) {
+    K42_I2C_ERRORS_t& e = g_K42_Bus[bus].errors;
+    if (err == G_K42_ERR_NACK) {
+        e.nacks++;
+    } else if (err == G_K42_ERR_TIMEOUT) {
+        e.timeouts++;
+    } else {
+        e.busErrors++;
+    }
+    K42_INA226_invalidate_pointer(addr, bus);
+    if ((err != G_K42_ERR_NACK) || (attempt > 0)) {
+        K42_INA226_bus_recover(bus);
+    }
+}
+
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+// 명령 리스트에 레지스터 읽기 추가
+// 포인터가 이미 regAddr이면 [시작, 주소+R, 읽기]만, 아니면 [시작, 주소+W, 레지스터]를 앞에 추가합니다.
+// 반환값 : 버스에 실리는 바이트 수
+static uint32_t K42_INA226_link_read(i2c_cmd_handle_t cmd, uint8_t addr, uint8_t regAddr, uint8_t* buf, int bus) {
+    uint16_t& cached = g_K42_Bus[bus].pointer[addr & (G_K42_NUM_DEVICES - 1)];
+    uint32_t  bytes  = 3;
+    if (cached != regAddr) {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (uint8_t)((addr << 1) | I2C_MASTER_WRITE), true);
+        i2c_master_write_byte(cmd, regAddr, true);
+        cached = regAddr;
+        bytes += 2;
+    }
+    i2c_master_start(cmd);    // 재시작
+    i2c_master_write_byte(cmd, (uint8_t)((addr << 1) | I2C_MASTER_READ), true);
+    i2c_master_read(cmd, buf, 2, I2C_MASTER_LAST_NACK);
+    return bytes;
+}
+
+// 명령 리스트 실행
+static int K42_INA226_link_run(i2c_cmd_handle_t cmd, int bus) {
+    i2c_master_stop(cmd);
+    esp_err_t err = i2c_master_cmd_begin((i2c_port_t)bus, cmd, pdMS_TO_TICKS(G_K42_TIMEOUT_MS));
+    i2c_cmd_link_delete_static(cmd);
+    if (err == ESP_OK) {
+        return G_K42_OK;
+    }
+    return (err == ESP_ERR_TIMEOUT) ? G_K42_ERR_TIMEOUT : (err == ESP_FAIL ? G_K42_ERR_NACK : G_K42_ERR_BUS);
+}
+#else
+// Wire endTransmission() 결과 변환 (0 : 성공, 2/3 : 주소/데이터 NACK, 5 : 타임아웃)
+static int K42_INA226_wire_result(uint8_t res) {
+    if (res == 0) {
+        return G_K42_OK;
+    }
+    if ((res == 2) || (res == 3)) {
+        return G_K42_ERR_NACK;
+    }
+    return (res == 5) ? G_K42_ERR_TIMEOUT : G_K42_ERR_BUS;
+}
+#endif
+
+// 레지스터 쓰기 전송 1회 : [주소+W, 레지스터, 상위, 하위]
+static int K42_INA226_xfer_write(uint8_t addr, uint8_t regAddr, uint16_t data, int bus) {
+    K42_I2C_BUS_t& b = g_K42_Bus[bus];
+    b.pointer[addr & (G_K42_NUM_DEVICES - 1)] = regAddr;
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(b.linkBuf, sizeof(b.linkBuf));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (uint8_t)((addr << 1) | I2C_MASTER_WRITE), true);
+    i2c_master_write_byte(cmd, regAddr, true);
+    i2c_master_write_byte(cmd, (uint8_t)((data >> 8) & 0x00FF), true);
+    i2c_master_write_byte(cmd, (uint8_t)(data & 0x00FF), true);
+    return K42_INA226_link_run(cmd, bus);
+#else
+    TwoWire& w = K42_INA226_wire(bus);
+    w.beginTransmission(addr);
+    w.write(regAddr);                          // 레지스터 주소 전송 (포인터 설정)
+    w.write((uint8_t)((data >> 8) & 0x00FF));  // 상위 바이트 전송
+    w.write((uint8_t)(data & 0x00FF));         // 하위 바이트 전송
+    return K42_INA226_wire_result(w.endTransmission());    // 전송 완료
+#endif
+}
+
+// 레지스터 읽기 전송 1회
+static int K42_INA226_xfer_read(uint8_t addr, uint8_t regAddr, uint8_t* buf, int bus) {
+    K42_I2C_BUS_t& b = g_K42_Bus[bus];
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(b.linkBuf, sizeof(b.linkBuf));
+    K42_INA226_link_read(cmd, addr, regAddr, buf, bus);
+    return K42_INA226_link_run(cmd, bus);
+#else
+    TwoWire&  w      = K42_INA226_wire(bus);
+    uint16_t& cached = b.pointer[addr & (G_K42_NUM_DEVICES - 1)];
+    if (cached != regAddr) {
+        w.beginTransmission(addr);
+        w.write(regAddr);              // 읽고자 하는 레지스터 주소 전송
+        int err = K42_INA226_wire_result(w.endTransmission(false));    // I2C 통신 재시작
+        if (err != G_K42_OK) {
+            return err;
+        }
+        cached = regAddr;
+    }
+    uint32_t t0 = millis();
+    if (w.requestFrom(addr, (uint8_t)2) != 2) {    // 2바이트 요청
+        // requestFrom은 원인을 알려주지 않으므로 소요 시간으로 타임아웃 구분
+        return ((millis() - t0) >= G_K42_TIMEOUT_MS) ? G_K42_ERR_TIMEOUT : G_K42_ERR_NACK;
+    }
+    buf[0] = w.read();  // 상위 바이트 읽기
+    buf[1] = w.read();  // 하위 바이트 읽기
+    return G_K42_OK;
+#endif
+}
+
+// 레지스터 쓰기 (실패 시 재시도)
+void K42_INA226_write_reg(uint8_t addr, uint8_t regAddr, uint16_t data, int bus) {
+    K42_I2C_BUS_t& b   = g_K42_Bus[bus];
+    int64_t        t0  = esp_timer_get_time();
+    int            err = G_K42_OK;
+    for (int attempt = 0; attempt <= G_K42_RETRIES; attempt++) {
+        if (attempt > 0) {
+            b.errors.retries++;
+        }
+        err = K42_INA226_xfer_write(addr, regAddr, data, bus);
+        if (err == G_K42_OK) {
+            break;
+        }
+        K42_INA226_handle_error(addr, err, attempt, bus);
+    }
+    if (err != G_K42_OK) {
+        b.errors.failures++;
+        ESP_LOGE(G_K42_TAG, "I2C%d write 0x%02X reg 0x%02X failed (%d)", bus, addr, regAddr, err);
+    }
+    K42_INA226_record(b, b.stats.write, t0, 4);
+}
+
+// 레지스터 읽기 (실패 시 재시도, 최종 실패 시 0 반환)
+// 포인터가 이미 regAddr이면 [주소+R, 상위, 하위]만 전송하고,
+// 아니면 [주소+W, 레지스터] 후 재시작하여 읽습니다.
+uint16_t K42_INA226_read_reg(uint8_t addr, uint8_t regAddr, int bus) {
+    K42_I2C_BUS_t& b    = g_K42_Bus[bus];
+    int64_t        t0   = esp_timer_get_time();
+    bool           bare = (b.pointer[addr & (G_K42_NUM_DEVICES - 1)] == regAddr);
+    uint8_t        buf[2];
+    int            err = G_K42_OK;
+    for (int attempt = 0; attempt <= G_K42_RETRIES; attempt++) {
+        if (attempt > 0) {
+            b.errors.retries++;
+        }
+        err = K42_INA226_xfer_read(addr, regAddr, buf, bus);
+        if (err == G_K42_OK) {
+            break;
+        }
+        K42_INA226_handle_error(addr, err, attempt, bus);
+    }
+    if (bare) {
+        K42_INA226_record(b, b.stats.readBare, t0, 3);
+    } else {
+        K42_INA226_record(b, b.stats.readPtr, t0, 5);
+    }
+    if (err != G_K42_OK) {
+        b.errors.failures++;
+        return 0;
+    }
+    // 상위 바이트와 하위 바이트 결합
+    return ((uint16_t)buf[1]) | (((uint16_t)buf[0]) << 8);
+}
+
+// 두 레지스터 읽기 (션트 + 버스)
+// IDF 백엔드는 두 읽기를 하나의 명령 리스트로 큐에 넣어 한 번에 실행하므로 전송 사이에 태스크 개입이 없습니다.
+void K42_INA226_read_pair(uint8_t addr, uint8_t regA, uint8_t regB, uint16_t& a, uint16_t& b, int bus) {
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+    K42_I2C_BUS_t& bs    = g_K42_Bus[bus];
+    int64_t        t0    = esp_timer_get_time();
+    uint8_t        bufA[2], bufB[2];
+    uint32_t       bytes = 0;
+    int            err   = G_K42_OK;
+    for (int attempt = 0; attempt <= G_K42_RETRIES; attempt++) {
+        if (attempt > 0) {
+            bs.errors.retries++;
+        }
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(bs.linkBuf, sizeof(bs.linkBuf));
+        bytes                = K42_INA226_link_read(cmd, addr, regA, bufA, bus);
+        bytes += K42_INA226_link_read(cmd, addr, regB, bufB, bus);
+        err = K42_INA226_link_run(cmd, bus);
+        if (err == G_K42_OK) {
+            break;
+        }
+        K42_INA226_handle_error(addr, err, attempt, bus);
+    }
+    K42_INA226_record(bs, bs.stats.readPair, t0, bytes);
+    if (err != G_K42_OK) {
+        bs.errors.failures++;
+        a = b = 0;
+        return;
+    }
+    a = ((uint16_t)bufA[1]) | (((uint16_t)bufA[0]) << 8);
+    b = ((uint16_t)bufB[1]) | (((uint16_t)bufB[0]) << 8);
+#else
+    a = K42_INA226_read_reg(addr, regA, bus);
+    b = K42_INA226_read_reg(addr, regB, bus);
+#endif
+}
+
+// 장치 응답 확인 (재시도, 오류 집계, 버스 복구 없음)
+// 응답한 장치의 포인터는 알 수 없는 상태로 둡니다.
+bool K42_INA226_probe(uint8_t addr, int bus) {
+    if (!g_K42_Bus[bus].begun) {
+        return false;    // 초기화되지 않은 버스
+    }
+    K42_INA226_invalidate_pointer(addr, bus);
+#if G_K42_I2C_BACKEND == G_K42_BACKEND_IDF
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(g_K42_Bus[bus].linkBuf, sizeof(g_K42_Bus[bus].linkBuf));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (uint8_t)((addr << 1) | I2C_MASTER_WRITE), true);
+    return K42_INA226_link_run(cmd, bus) == G_K42_OK;
+#else
+    TwoWire& w = K42_INA226_wire(bus);
+    w.beginTransmission(addr);
+    return w.endTransmission() == 0;
+#endif
+}
+
+// 백엔드 벤치마크 : 두 레지스터 읽기 n번의 샘플 쌍당 평균 시간 (버스 0)
+void K42_INA226_bench(uint8_t addr, uint8_t regA, uint8_t regB, int n) {
+    uint16_t a, b;
+    K42_INA226_stats_reset();
+    int64_t t0 = esp_timer_get_time();
+    for (int inx = 0; inx < n; inx++) {
+        K42_INA226_read_pair(addr, regA, regB, a, b);
+    }
+    int64_t us = esp_timer_get_time() - t0;
+    ESP_LOGI(G_K42_TAG, "Bench %s @ %dHz : %d pairs, %.1fus per sample pair",
+             G_K42_I2C_BACKEND == G_K42_BACKEND_IDF ? "IDF" : "Wire", G_K42_I2C_CLOCK_HZ, n, (float)us / (float)n);
+    K42_INA226_stats_log("bench");
+}
+
+// 포인터 상태 무효화 (리셋 후 등)
+void K42_INA226_invalidate_pointer(uint8_t addr, int bus) {
+    g_K42_Bus[bus].pointer[addr & (G_K42_NUM_DEVICES - 1)] = G_K42_POINTER_UNKNOWN;
+}
+
+// 전송 통계 초기화 (오류 카운터는 유지)
+void K42_INA226_stats_reset() {
+    for (int bus = 0; bus < G_K42_NUM_BUSES; bus++) {
+        memset(&g_K42_Bus[bus].stats, 0, sizeof(g_K42_Bus[bus].stats));
+    }
+}
+
+// 누적 오류 카운터
+const K42_I2C_ERRORS_t& K42_INA226_get_errors(int bus) {
+    return g_K42_Bus[bus].errors;
+}
+
+// 모든 버스의 최종 실패 전송 수
+uint32_t K42_INA226_total_failures() {
+    uint32_t failures = 0;
+    for (int bus = 0; bus < G_K42_NUM_BUSES; bus++) {
+        failures += g_K42_Bus[bus].errors.failures;
+    }
+    return failures;
+}
+
+// 전송 통계 출력
+static void K42_INA226_stats_log_one(const char* label, const char* kind, const K42_I2C_XFER_STATS_t& st) {
+    if (st.count == 0) {
+        return;
+    }
+    ESP_LOGI(G_K42_TAG, "%s %-9s : %u xfers, %u bytes, avg %uus, max %uus", label, kind,
+             st.count, st.bytes, (uint32_t)(st.sumUs / st.count), st.maxUs);
+}
+
+// 사용 중인 버스별로 출력
+void K42_INA226_stats_log(const char* label) {
+    for (int bus = 0; bus < G_K42_NUM_BUSES; bus++) {
+        K42_I2C_BUS_t&   b = g_K42_Bus[bus];
+        const uint32_t*  h = b.stats.latencyHist;
+        if (!b.begun) {
+            continue;
+        }
+        ESP_LOGI(G_K42_TAG, "%s I2C%d %s @ %dHz", label, bus, G_K42_I2C_BACKEND == G_K42_BACKEND_IDF ? "IDF" : "Wire", G_K42_I2C_CLOCK_HZ);
+        K42_INA226_stats_log_one(label, "write", b.stats.write);
+        K42_INA226_stats_log_one(label, "read+ptr", b.stats.readPtr);
+        K42_INA226_stats_log_one(label, "read", b.stats.readBare);
+        K42_INA226_stats_log_one(label, "read pair", b.stats.readPair);
+        ESP_LOGI(G_K42_TAG, "%s latency <32/64/128/256/512/1024/2048/more us : %u %u %u %u %u %u %u %u", label,
+                 h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+        ESP_LOGI(G_K42_TAG, "%s errors : %u nack, %u timeout, %u bus, %u retries, %u recoveries, %u failed", label,
+                 b.errors.nacks, b.errors.timeouts, b.errors.busErrors,
+                 b.errors.retries, b.errors.recoveries, b.errors.failures);
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * 블록 디스크립터 큐 (단일 생산자 / 단일 소비자, lock-free)
+ *
+ * 코어 1의 캡처 태스크(생산자)가 샘플 버퍼에 기록한 패킷의 위치를 코어 0의 전송 태스크(소비자)에 넘기는 큐입니다.
+ * 각 항목은 버퍼 오프셋, 워드 수, 플래그로 이루어진 디스크립터이며, 샘플 데이터 자체는 복사하지 않습니다.
+ * 기존의 volatile bool 플래그 방식과 달리 전송되지 않은 패킷 위에 새 패킷이 덮어써지거나 합쳐지지 않습니다.
+ *
+ * 동작 방식:
+ * - head는 생산자만, tail은 소비자만 증가시킵니다. (head - tail = 대기 중인 디스크립터 수)
+ * - 생산자는 디스크립터를 기록한 뒤 release 순서로 head를 공개하고, 소비자는 acquire 순서로 head를 읽습니다.
+ * - head와 tail은 서로 다른 캐시 라인에 두어 두 코어가 같은 라인을 번갈아 쓰지 않도록 합니다.
+ * - 캡처는 버퍼 앞부분부터 다시 쓰므로 캡처 태스크는 큐가 빈 뒤에 다음 캡처를 시작합니다. (K10 측정 루프)
+ *
+ * 주요 함수:
+ * 1. K43_queue_push()  : (생산자) 디스크립터 추가, 가득 차 있으면 false
+ * 2. K43_queue_peek()  : (소비자) 가장 오래된 디스크립터 확인 (제거하지 않음)
+ * 3. K43_queue_pop()   : (소비자) 가장 오래된 디스크립터 제거 (블록 반환)
+ * 4. K43_queue_count() : 대기 중인 디스크립터 수
+ * 5. K43_queue_drain() : (소비자) 대기 중인 디스크립터 모두 폐기 (연결 해제 시)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// 큐 크기 (2의 거듭제곱)
+#define G_K43_QUEUE_SIZE        64
+#define G_K43_QUEUE_MASK        (G_K43_QUEUE_SIZE - 1)
+#define G_K43_CACHE_LINE        32
+
+// 디스크립터 플래그
+#define G_K43_BLOCK_START       0x0001    // 캡처의 첫 패킷 (MSG_TX_START 헤더 포함)
+#define G_K43_BLOCK_END         0x0002    // 캡처 종료 (데이터 없음, 종료 프레임 전송 요청)
+#define G_K43_BLOCK_GATE_OPEN   0x0004    // 게이트 열림 알림 (데이터 없음)
+#define G_K43_BLOCK_METER       0x0008    // CV 미터 측정 결과, 에너지 적분 보고 (단일 프레임, ACK 대기)
+
+// K43_BLOCK_DESC_t 구조체 정의
+// 샘플 버퍼(int16_t 워드 단위) 안의 전송할 패킷 위치를 나타냅니다.
+typedef struct {
+    uint32_t offset;    // 버퍼 시작부터의 워드 오프셋
+    uint16_t words;     // 전송할 워드 수
+    uint16_t flags;     // G_K43_BLOCK_xxx
+} K43_BLOCK_DESC_t;
+
+// K43_BLOCK_QUEUE_t 구조체 정의
+typedef struct {
+    alignas(G_K43_CACHE_LINE) std::atomic<uint32_t> head;    // 생산자 인덱스 (생산자만 씀)
+    alignas(G_K43_CACHE_LINE) std::atomic<uint32_t> tail;    // 소비자 인덱스 (소비자만 씀)
+    alignas(G_K43_CACHE_LINE) K43_BLOCK_DESC_t      desc[G_K43_QUEUE_SIZE];
+} K43_BLOCK_QUEUE_t;
+
+// 함수 선언
+bool     K43_queue_push(K43_BLOCK_QUEUE_t& q, const K43_BLOCK_DESC_t& d);
+bool     K43_queue_peek(K43_BLOCK_QUEUE_t& q, K43_BLOCK_DESC_t& d);
+void     K43_queue_pop(K43_BLOCK_QUEUE_t& q);
+uint32_t K43_queue_count(K43_BLOCK_QUEUE_t& q);
+void     K43_queue_drain(K43_BLOCK_QUEUE_t& q);
+
+// 디스크립터 추가 (생산자 전용)
+bool K43_queue_push(K43_BLOCK_QUEUE_t& q, const K43_BLOCK_DESC_t& d) {
+    uint32_t head = q.head.load(std::memory_order_relaxed);
+    uint32_t tail = q.tail.load(std::memory_order_acquire);
+    if ((head - tail) >= G_K43_QUEUE_SIZE) {
+        return false;    // 가득 참
+    }
+    q.desc[head & G_K43_QUEUE_MASK] = d;
+    q.head.store(head + 1, std::memory_order_release);    // 디스크립터 기록 후 공개
+    return true;
+}
+
+// 가장 오래된 디스크립터 확인 (소비자 전용)
+bool K43_queue_peek(K43_BLOCK_QUEUE_t& q, K43_BLOCK_DESC_t& d) {
+    uint32_t tail = q.tail.load(std::memory_order_relaxed);
+    uint32_t head = q.head.load(std::memory_order_acquire);
+    if (head == tail) {
+        return false;    // 비어 있음
+    }
+    d = q.desc[tail & G_K43_QUEUE_MASK];
+    return true;
+}
+
+// 가장 오래된 디스크립터 제거 (소비자 전용)
+// 제거된 디스크립터가 가리키던 버퍼 영역은 생산자가 다시 사용할 수 있습니다.
+void K43_queue_pop(K43_BLOCK_QUEUE_t& q) {
+    uint32_t tail = q.tail.load(std::memory_order_relaxed);
+    q.tail.store(tail + 1, std::memory_order_release);
+}
+
+// 대기 중인 디스크립터 수
+uint32_t K43_queue_count(K43_BLOCK_QUEUE_t& q) {
+    return q.head.load(std::memory_order_acquire) - q.tail.load(std::memory_order_acquire);
+}
+
+// 대기 중인 디스크립터 모두 폐기 (소비자 전용)
+void K43_queue_drain(K43_BLOCK_QUEUE_t& q) {
+    q.tail.store(q.head.load(std::memory_order_acquire), std::memory_order_release);
+}
@@ -0,0 +1,242 @@
+/*
+ * 다중 INA226 캡처
+ *
+ * 두 I2C 버스(ESP32 I2C 컨트롤러 0, 1)에 버스당 최대 4개의 INA226을 연결하여 여러 전원 레일을 동시에 측정합니다.
+ * 버스 0의 0x40 장치는 기본 보드(FET 스케일 전환, ALERT 핀 연결)이며 항상 채널 0입니다.
+ *
+ * 동작 방식:
+ * - 모든 장치에 같은 설정(변환 시간, 평균)을 연속으로 기록하여 변환을 거의 동시에 시작합니다.
+ * - 하드웨어 타이머 데드라인(K41)마다 코어 1의 캡처 태스크가 버스 0 장치를 읽고,
+ *   동시에 코어 0의 작업 태스크가 버스 1 장치를 읽습니다. (두 버스의 I2C 전송이 겹침)
+ * - 캡처 태스크는 두 버스의 읽기가 모두 끝난 뒤 다음 데드라인으로 넘어가므로 한 프레임의 모든 채널은 같은 데드라인의 값입니다.
+ * - 장치마다 내부 발진기가 다르므로 채널 간 시간 정렬 오차는 한 변환 주기 이내입니다.
+ *
+ * 프레임 형식:
+ * - [MSG_TX_START_MULTI, periodUs, scale, nDev, (id, shunt mΩ) x nDev] + 시간 단계마다 nDev개의 (shunt, bus) 쌍
+ * - id = (bus << 8) | 주소, 1초마다 MSG_TX 마커로 패킷을 나눕니다. (기존 형식과 동일)
+ * - 채널 0의 션트 값은 scale에 따라 0.05Ω / 1.05Ω이며, 다른 채널은 g_K44_Channels[].shuntMilliOhm 입니다.
+ *
+ * 주요 함수:
+ * 1. K44_INA226_scan()                  : 두 버스에서 INA226(ID 0x5449)을 찾아 채널 표를 만듭니다.
+ * 2. K44_INA226_multi_begin()           : 버스 1에 장치가 있으면 코어 0 작업 태스크를 만듭니다.
+ * 3. K44_INA226_set_shunt(int ch, int mOhm) : 추가 채널의 션트 저항 설정 (웹소켓 명령)
+ * 4. K44_INA226_capture_multi(volatile MEASURE_t &measure, volatile int16_t* buffer)
+ *    - 모든 채널을 같은 주기로 캡처합니다. 측정 요약(CV_MEASURE_t)은 채널 0 기준입니다.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "K40_ina226_002.h"
+
+#define         G_K44_TAG    "K44_multi"
+
+#define G_K44_MAX_PER_BUS           4       // 버스당 최대 장치 수
+#define G_K44_MAX_CHANNELS          (G_K44_MAX_PER_BUS * G_K42_NUM_BUSES)
+#define G_K44_ADDR_FIRST            0x40    // INA226 주소 범위 (A0, A1 핀 조합)
+#define G_K44_ADDR_LAST             0x4F
+#define G_K44_DEFAULT_SHUNT_MOHM    100     // 추가 보드의 기본 션트 저항 (mΩ)
+#define G_K44_PAIR_US_400K          250     // 400kHz에서 장치 하나의 (shunt, bus) 읽기 시간 추정 (us, 측정값이 없을 때)
+#define G_K44_WORKER_PRIORITY       (configMAX_PRIORITIES - 2)
+
+// K44_INA226_CHANNEL_t 구조체 정의
+typedef struct {
+    uint8_t  bus;              // I2C 버스 번호
+    uint8_t  addr;             // 7비트 주소
+    uint16_t shuntMilliOhm;    // 션트 저항 (mΩ, 채널 0은 스케일로 결정)
+} K44_INA226_CHANNEL_t;
+
+// 전역 변수
+K44_INA226_CHANNEL_t      g_K44_Channels[G_K44_MAX_CHANNELS];    // 채널 표 (채널 0 = 기본 보드)
+int                       g_K44_NumChannels = 0;                  // 찾은 채널 수
+static TaskHandle_t       g_K44_WorkerTask  = NULL;               // 버스 1 읽기 태스크 (코어 0)
+static SemaphoreHandle_t  g_K44_WorkerDone  = NULL;               // 버스 1 읽기 완료 신호
+static volatile int16_t*  g_K44_WorkerDst   = NULL;               // 현재 시간 단계의 프레임 위치
+
+// 함수 선언
+int  K44_INA226_scan();
+void K44_INA226_multi_begin();
+void K44_INA226_set_shunt(int ch, int mOhm);
+void K44_INA226_capture_multi(volatile MEASURE_t& measure, volatile int16_t* buffer);
+
+// 장치 검색
+// 기본 보드를 채널 0으로 두고, 두 버스의 0x40 ~ 0x4F에서 제조사 ID가 0x5449인 장치를 버스당 4개까지 추가합니다.
+int K44_INA226_scan() {
+    g_K44_NumChannels = 0;
+    for (int bus = 0; bus < G_K42_NUM_BUSES; bus++) {
+        int found = 0;
+        for (int addr = G_K44_ADDR_FIRST; (addr <= G_K44_ADDR_LAST) && (found < G_K44_MAX_PER_BUS); addr++) {
+            if (!K42_INA226_probe((uint8_t)addr, bus)) {
+                continue;
+            }
+            if (K42_INA226_read_reg((uint8_t)addr, G_K40_INA226_REG_ID, bus) != 0x5449) {
+                continue;
+            }
+            K44_INA226_CHANNEL_t& ch = g_K44_Channels[g_K44_NumChannels++];
+            ch.bus                   = (uint8_t)bus;
+            ch.addr                  = (uint8_t)addr;
+            ch.shuntMilliOhm         = G_K44_DEFAULT_SHUNT_MOHM;
+            found++;
+            ESP_LOGI(G_K44_TAG, "INA226 found : I2C%d 0x%02X", bus, addr);
+        }
+    }
+    return g_K44_NumChannels;
+}
+
+// 추가 채널의 션트 저항 설정
+void K44_INA226_set_shunt(int ch, int mOhm) {
+    if ((ch > 0) && (ch < g_K44_NumChannels) && (mOhm > 0) && (mOhm <= 65535)) {
+        g_K44_Channels[ch].shuntMilliOhm = (uint16_t)mOhm;
+    }
+}
+
+// 버스 1 장치의 (shunt, bus) 쌍을 프레임에 기록
+static void K44_INA226_read_bus(int bus, volatile int16_t* dst) {
+    uint16_t shunt, vbus;
+    for (int ch = 0; ch < g_K44_NumChannels; ch++) {
+        if (g_K44_Channels[ch].bus != bus) {
+            continue;
+        }
+        K42_INA226_read_pair(g_K44_Channels[ch].addr, G_K40_INA226_REG_SHUNT, G_K40_INA226_REG_VBUS, shunt, vbus, bus);
+        if (ch == 0) {
+            shunt = K47_INA226_cal_shunt(shunt);    // 기본 보드만 보정 (K47)
+            vbus  = K47_INA226_cal_bus(vbus);
+        }
+        dst[2 * ch]     = (int16_t)shunt;
+        dst[2 * ch + 1] = (int16_t)vbus;
+    }
+}
+
+// 버스 1 읽기 태스크 (코어 0)
+// 캡처 태스크의 알림을 받을 때마다 버스 1 장치를 읽고 완료를 알립니다.
+static void K44_INA226_worker_task(void* pvParameter) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        K44_INA226_read_bus(1, g_K44_WorkerDst);
+        xSemaphoreGive(g_K44_WorkerDone);
+    }
+}
+
+// 다중 캡처 준비
+// 버스 1에 장치가 없으면 작업 태스크를 만들지 않고 캡처 태스크가 모든 장치를 읽습니다.
+void K44_INA226_multi_begin() {
+    bool bus1 = false;
+    for (int ch = 0; ch < g_K44_NumChannels; ch++) {
+        bus1 = bus1 || (g_K44_Channels[ch].bus == 1);
+    }
+    if (!bus1 || (g_K44_WorkerTask != NULL)) {
+        return;
+    }
+    g_K44_WorkerDone = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(&K44_INA226_worker_task, "ina226_bus1", 3072, NULL, G_K44_WORKER_PRIORITY, &g_K44_WorkerTask, g_K10_CPU_CORE_0);
+}
+
+// K44_INA226_capture_multi: 다중 INA226 버퍼 캡처 함수
+void K44_INA226_capture_multi(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    int      nDev   = g_K44_NumChannels;
+    int      stride = 2 * nDev;    // 시간 단계당 워드 수
+    uint16_t reg_shunt, reg_bus;
+    K48_STATS_t cs, bs;    // 채널 0 전류 및 버스 전압 통계
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    K48_INA226_stats_begin(bs, NULL);
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
+
+    // 한 버스의 장치 수만큼 I2C 읽기 시간이 필요 (두 버스는 동시에 읽음)
+    int perBus[G_K42_NUM_BUSES] = {0};
+    for (int ch = 0; ch < nDev; ch++) {
+        perBus[g_K44_Channels[ch].bus]++;
+    }
+    int      busiest = perBus[0] > perBus[1] ? perBus[0] : perBus[1];
+    uint32_t pairUs  = g_K40_INA226_I2cPairUs ? g_K40_INA226_I2cPairUs : G_K44_PAIR_US_400K * (400000 / 1000) / (G_K42_I2C_CLOCK_HZ / 1000);
+    uint32_t minUs   = (uint32_t)busiest * pairUs + G_K40_INA226_I2C_MARGIN_US;
+    if (measure.m.cv_meas.periodUs < minUs) {
+        uint32_t periodUs = ((minUs + 9) / 10) * 10;
+        ESP_LOGW(G_K44_TAG, "Period %uus too short for %d devices per bus, using %uus", measure.m.cv_meas.periodUs, busiest, periodUs);
+        measure.m.cv_meas.nSamples = (int)(((int64_t)measure.m.cv_meas.nSamples * measure.m.cv_meas.periodUs) / periodUs);
+        measure.m.cv_meas.periodUs = periodUs;
+    }
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);
+
+    // 헤더 + 시간 단계 + 1초마다 마커 1워드가 버퍼에 들어가도록 제한
+    int hdrWords = 4 + 2 * nDev;
+    int maxSteps = (int)(((int64_t)(g_K40_MaxSamples * 2 - hdrWords - 1) * samplesPerSecond) / (stride * samplesPerSecond + 1));
+    if (measure.m.cv_meas.nSamples > maxSteps) {
+        ESP_LOGW(G_K44_TAG, "Multi capture limited to %d samples", maxSteps);
+        measure.m.cv_meas.nSamples = maxSteps;
+    }
+
+    K50_INA226_switch_scale(measure.m.cv_meas.scale);    // 기본 보드 스케일 전환
+    K41_INA226_drdy_begin();                             // 기본 보드 ALERT 핀 인터럽트 연결
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, G_K40_INA226_MASK_CNVR);
+    // 모든 장치의 변환을 연속으로 시작 (설정 레지스터 쓰기 시 변환 재시작)
+    for (int ch = 0; ch < nDev; ch++) {
+        K42_INA226_write_reg(g_K44_Channels[ch].addr, G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007, g_K44_Channels[ch].bus);
+    }
+
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+    uint32_t tstart = micros();
+    buffer[0]       = G_K40_INA226_MSG_TX_START_MULTI;
+    buffer[1]       = K40_INA226_period_word(measure.m.cv_meas.periodUs);
+    buffer[2]       = measure.m.cv_meas.scale;
+    buffer[3]       = (int16_t)nDev;
+    for (int ch = 0; ch < nDev; ch++) {
+        uint16_t mOhm = (ch == 0) ? (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI ? 50 : 1050) : g_K44_Channels[ch].shuntMilliOhm;
+        buffer[4 + 2 * ch]     = (int16_t)((g_K44_Channels[ch].bus << 8) | g_K44_Channels[ch].addr);
+        buffer[4 + 2 * ch + 1] = (int16_t)mOhm;
+    }
+    int offset      = hdrWords;    // 버퍼 시작 오프셋
+    int packetStart = 0;           // 현재 패킷의 시작 워드
+    K40_INA226_reset_tx_end();
+    int inx         = 0;
+    bool worker     = (g_K44_WorkerTask != NULL);
+    bool aborted    = false;    // 취소 요청 (패킷 경계에서 확인)
+
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);
+    while ((inx < measure.m.cv_meas.nSamples) && !aborted) {
+        K41_INA226_pace_wait(inx);
+        int bufIndex = offset + stride * inx;
+        K41_INA226_wait_drdy();
+        if (worker) {
+            g_K44_WorkerDst = buffer + bufIndex;
+            xTaskNotifyGive(g_K44_WorkerTask);    // 버스 1 읽기 시작 (코어 0)
+            K44_INA226_read_bus(0, buffer + bufIndex);
+            xSemaphoreTake(g_K44_WorkerDone, portMAX_DELAY);
+        } else {
+            K44_INA226_read_bus(0, buffer + bufIndex);
+            K44_INA226_read_bus(1, buffer + bufIndex);
+        }
+
+        // 측정 요약은 채널 0 (기본 보드) 기준
+        int16_t s = buffer[bufIndex];
+        int16_t v = buffer[bufIndex + 1];
+        K48_INA226_stats_add(cs, s);
+        K48_INA226_stats_add(bs, v);
+        K40_INA226_power_add(ps, s, v);
+
+        // 일정 시간마다 패킷을 분할하여 전송
+        if (((inx + 1) % samplesPerSecond) == 0) {
+            offset++;
+            aborted = K40_INA226_packet_split(buffer, bufIndex + stride, packetStart, true);
+        }
+        inx++;
+    }
+    K41_INA226_pace_end(inx);
+
+    // 남은 샘플 전송 후 종료 디스크립터 추가
+    K40_INA226_packet_tail(offset + stride * inx, packetStart);
+    K40_INA226_capture_finish(measure, inx, &ps, cs, &bs);
+
+    uint32_t us = micros() - tstart;
+    K41_INA226_drdy_end();
+    measure.m.cv_meas.nSamples   = inx;
+    measure.m.cv_meas.sampleRate = (1000000.0f * (float)inx) / (float)us;
+
+    ESP_LOGI(G_K44_TAG, "CV Multi : %d devices 0x%04X %s %.1fHz %.1fV %.3fmA\n", nDev,
+             measure.m.cv_meas.cfg, measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI",
+             measure.m.cv_meas.sampleRate, measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
+}
@@ -0,0 +1,119 @@
+/*
+ * INA226 자동 설정 선택
+ *
+ * 클라이언트가 cfgIndex(0~3)를 고르는 대신 "출력 샘플 속도 X Hz 이상" 또는 "전류 노이즈 Y uA 이하"를 요청하면
+ * 평균 횟수, 변환 시간, 펌웨어 오버샘플링 배수를 골라 줍니다.
+ *
+ * 노이즈 특성 표:
+ * - g_K45_INA226_ShuntNoiseNv[] : 평균 1일 때 변환 시간별 션트 입력 노이즈 (nV RMS)
+ * - 데이터시트의 노이즈 대 변환 시간 곡선을 기준으로 만든 장치 내장 표이며, 보드별 측정값으로 교체할 수 있습니다.
+ * - 평균 n회(하드웨어 평균 x 오버샘플링)의 노이즈는 1/sqrt(n)로 줄고, 출력 레지스터 양자화(1 LSB / sqrt(12)) 아래로는 내려가지 않습니다.
+ * - 전류 노이즈 (nA) = 션트 노이즈 (nV) x 1000 / 션트 저항 (mΩ), 자동 스케일은 HI(0.05Ω, 노이즈가 큰 쪽)로 계산합니다.
+ *
+ * 선택 방식:
+ * - 후보 = 평균 8종 x 변환 시간 8종 (버스 변환 시간 = 션트 변환 시간, 기존 설정 표와 같음) x 오버샘플링 1, 2, 4, 8, 16
+ * - 샘플 주기는 K40_INA226_config_build()로 계산하므로 시작 시 측정한 I2C 읽기 시간이 반영됩니다.
+ * - 노이즈 목표가 있으면 (속도 목표도 만족하는 후보 중) 출력 주기가 가장 짧은 후보를 고릅니다.
+ * - 속도 목표만 있으면 속도를 만족하는 후보 중 노이즈가 가장 작은 후보를 고릅니다.
+ * - 같은 조건이면 오버샘플링이 작은 후보(하드웨어 평균)를 우선합니다. 만족하는 후보가 없으면 가장 가까운 후보를 고르고 met = 0 입니다.
+ *
+ * 주요 함수:
+ * 1. K45_INA226_noise_na(uint16_t cfg, int oversample, int scale)
+ *    - 설정과 오버샘플링 배수의 예상 전류 노이즈 (nA RMS)
+ * 2. K45_INA226_select(float rateHz, float noiseUa, int scale, bool shuntOnly, int maxOversample, K40_INA226_CFG_INFO_t& info)
+ *    - 목표에 맞는 설정을 골라 info에 기록합니다. (cv_config, cv_capture의 rateHz / noiseUa)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "K40_ina226_002.h"
+
+#define         G_K45_TAG    "K45_profile"
+
+#define G_K45_MAX_OVERSAMPLE        16      // 최대 펌웨어 오버샘플링 배수
+#define G_K45_QUANT_NOISE_NV        722     // 출력 양자화 노이즈 (2.5uV / sqrt(12), nV RMS)
+#define G_K45_SHUNT_HI_MOHM         50      // 스케일별 션트 저항 (mΩ)
+#define G_K45_SHUNT_LO_MOHM         1050
+
+// 평균 1일 때 변환 시간별 션트 입력 노이즈 (nV RMS, 설정 레지스터 VSHCT 코드 순서 : 140us ~ 8.244ms)
+static const uint16_t g_K45_INA226_ShuntNoiseNv[8] = {9000, 7500, 5900, 4400, 3200, 2300, 1700, 1200};
+
+// 함수 선언
+uint32_t K45_INA226_noise_na(uint16_t cfg, int oversample, int scale);
+bool     K45_INA226_select(float rateHz, float noiseUa, int scale, bool shuntOnly, int maxOversample, K40_INA226_CFG_INFO_t& info);
+
+// 예상 전류 노이즈 계산 (nA RMS)
+uint32_t K45_INA226_noise_na(uint16_t cfg, int oversample, int scale) {
+    float n     = (float)g_K40_INA226_AvgTable[(cfg >> 9) & 0x7] * (float)(oversample > 1 ? oversample : 1);
+    float nv    = (float)g_K45_INA226_ShuntNoiseNv[(cfg >> 3) & 0x7] / sqrtf(n);
+    if (nv < G_K45_QUANT_NOISE_NV) {
+        nv = G_K45_QUANT_NOISE_NV;
+    }
+    int mOhm = (scale == G_K40_INA226_SCALE_LO) ? G_K45_SHUNT_LO_MOHM : G_K45_SHUNT_HI_MOHM;
+    return (uint32_t)(nv * 1000.0f / (float)mOhm + 0.5f);
+}
+
+// 자동 설정 선택
+// rateHz, noiseUa 중 0 이하인 값은 목표가 아닙니다. 둘 다 없으면 false를 반환합니다. (info.valid = 0)
+// maxOversample은 캡처 방식이 펌웨어 오버샘플링을 지원하지 않으면 1입니다.
+bool K45_INA226_select(float rateHz, float noiseUa, int scale, bool shuntOnly, int maxOversample, K40_INA226_CFG_INFO_t& info) {
+    memset(&info, 0, sizeof(info));
+    info.msg = G_K40_INA226_MSG_CFG_INFO;
+    if ((rateHz <= 0.0f) && (noiseUa <= 0.0f)) {
+        return false;
+    }
+    uint32_t maxPeriodUs = (rateHz > 0.0f) ? (uint32_t)(1000000.0f / rateHz) : 0xFFFFFFFF;
+    uint32_t noiseNa     = (noiseUa > 0.0f) ? (uint32_t)(noiseUa * 1000.0f) : 0;
+    if (maxOversample > G_K45_MAX_OVERSAMPLE) {
+        maxOversample = G_K45_MAX_OVERSAMPLE;
+    }
+
+    K40_INA226_CFG_INFO_t cand;
+    bool     found     = false;    // 목표를 만족하는 후보를 찾음
+    uint32_t bestOutUs = 0, bestNoise = 0;
+    for (int os = 1; os <= maxOversample; os <<= 1) {
+        for (int avgCode = 0; avgCode < 8; avgCode++) {
+            for (int convCode = 0; convCode < 8; convCode++) {
+                int convUs = g_K40_INA226_ConvTable[convCode];
+                K40_INA226_config_build(g_K40_INA226_AvgTable[avgCode], convUs, convUs, shuntOnly, cand);
+                uint32_t outUs = (uint32_t)cand.periodUs * os;
+                uint32_t noise = K45_INA226_noise_na((uint16_t)cand.cfg, os, scale);
+                bool     ok    = (outUs <= maxPeriodUs) && ((noiseNa == 0) || (noise <= noiseNa));
+                bool     better;
+                if (ok != found) {
+                    better = ok;    // 목표를 만족하는 첫 후보 (만족하지 못하는 후보는 만족하는 후보를 대신하지 않음)
+                } else if (!ok) {
+                    // 만족하는 후보가 없으면 가장 가까운 후보 : 노이즈 목표는 속도 안에서 노이즈 최소, 속도 목표만이면 가장 빠른 후보
+                    if (info.valid == 0) {
+                        better = true;
+                    } else if (noiseNa != 0) {
+                        bool inRate   = (outUs <= maxPeriodUs);
+                        bool bestRate = ((uint32_t)info.outPeriodUs <= maxPeriodUs);
+                        better = (inRate != bestRate) ? inRate : ((noise < bestNoise) || ((noise == bestNoise) && (outUs < bestOutUs)));
+                    } else {
+                        better = outUs < bestOutUs;
+                    }
+                } else if (noiseNa != 0) {
+                    better = (outUs < bestOutUs) || ((outUs == bestOutUs) && (noise < bestNoise));    // 가장 빠른 후보
+                } else {
+                    better = (noise < bestNoise) || ((noise == bestNoise) && (outUs < bestOutUs));    // 가장 조용한 후보
+                }
+                if (better) {
+                    found            = ok;
+                    info             = cand;
+                    info.oversample  = os;
+                    info.outPeriodUs = (int32_t)outUs;
+                    info.noiseNa     = (int32_t)noise;
+                    info.met         = ok ? 1 : 0;
+                    bestOutUs        = outUs;
+                    bestNoise        = noise;
+                }
+            }
+        }
+    }
+    ESP_LOGI(G_K45_TAG, "Target %.1fHz %.3fuA : avg %d conv %dus x%d, period %dus, noise %dnA%s", rateHz, noiseUa,
+             info.avg, info.shuntUs, info.oversample, info.outPeriodUs, info.noiseNa, info.met ? "" : " (target not met)");
+    return true;
+}
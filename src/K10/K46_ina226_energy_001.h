@@ -0,0 +1,244 @@
+/*
+ * INA226 에너지/전하 적분
+ *
+ * 배터리 수명 추정을 위해 전하(C, mAh)와 에너지(J, mWh)를 중지할 때까지 누적합니다.
+ * 트리거 버퍼 캡처와 같은 샘플 경로(하드웨어 타이머 페이싱, ALERT 대기, 오버샘플링 읽기, 자동 범위 전환)를 사용하지만
+ * 샘플을 버퍼에 저장하지 않으므로 실행 시간에 제한이 없습니다.
+ *
+ * 누적 방식:
+ * - 스케일(HI, LO)별 64비트 고정소수점 누적기에 원시값으로 누적하고, 물리 단위 변환은 보고할 때만 합니다.
+ *   전하 = Σ shunt x dt (LSB·us), 에너지 = Σ shunt x bus x dt (2^16 LSB·LSB·us, 하위 16비트는 나머지로 보존)
+ * - 보고 구간 동안 샘플 합을 모은 뒤 구간마다 dt를 곱해 누적기에 더합니다. (샘플당 곱셈 없음)
+ * - 자동 범위 블랭킹 샘플은 마지막 유효 샘플 값으로 대신합니다. (적분 구간에 빈틈 없음)
+ * - 누적기는 전역 변수이므로 웹소켓 재연결, 다른 캡처 후에도 유지되며 reset 명령으로만 지웁니다.
+ *   다시 시작하면 이어서 누적합니다.
+ *
+ * 보고:
+ * - reportMs마다 K46_ENERGY_REPORT_t(MSG_ENERGY)를 버퍼 앞쪽의 보고 슬롯에 기록하고 전송 큐에 넣습니다. (미터 측정과 같이 ACK 대기)
+ * - 전송이 밀려 슬롯이 모두 사용 중이면 그 보고는 건너뜁니다. (누적값이므로 다음 보고에 반영됨, 연결이 끊겨도 적분은 계속)
+ *
+ * 주요 함수:
+ * 1. K46_INA226_integrate(volatile MEASURE_t &measure, volatile int16_t* buffer)
+ *    - 중지 명령(g_K46_StopFlag), 캡처 취소(cv_cancel) 또는 새 캡처 요청까지 적분하고 마지막 보고를 보냅니다.
+ * 2. K46_INA226_energy_reset()
+ *    - 누적기를 지웁니다.
+ * 3. K46_INA226_energy_report(K46_ENERGY_REPORT_t& report, bool running)
+ *    - 누적기를 물리 단위로 변환합니다.
+ *
+ * 웹소켓 명령:
+ * - cv_capture (capture = "integrate", reportMs) : 적분 시작 (cfgIndex, 사용자 설정, 자동 선택, scale은 다른 캡처와 같음)
+ * - cv_integrate (op = "stop" / "reset" / "status") : 중지, 누적기 초기화, 현재 누적값 요청 (재연결 후)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "K40_ina226_002.h"
+
+#define         G_K46_TAG    "K46_energy"
+
+#define G_K46_REPORT_SLOTS          4        // 버퍼 앞쪽의 보고 슬롯 수
+#define G_K46_REPORT_MS_MIN         100      // 보고 주기 범위 (ms)
+#define G_K46_REPORT_MS_MAX         60000    // (보고 구간 합이 64비트를 넘지 않도록)
+#define G_K46_ENERGY_FRAC_BITS      16       // 에너지 누적기의 버림 비트 수
+#define G_K46_DRAIN_WAIT_MS         1000     // 종료 시 대기 중인 보고 전송을 기다리는 최대 시간
+#define G_K46_PACE_RESTART          0x40000000    // 페이싱 타임라인을 다시 시작하는 데드라인 번호
+
+// K46_ENERGY_ACC_t 구조체 정의
+// 스케일별 누적기입니다. 인덱스는 G_K40_INA226_SCALE_HI(0), G_K40_INA226_SCALE_LO(1)입니다.
+typedef struct {
+    int64_t  chargeRawUs[2];    // Σ shunt x dt (LSB·us)
+    int64_t  energyRaw[2];      // Σ shunt x bus x dt >> 16 (2^16 LSB·LSB·us)
+    int64_t  energyFrac[2];     // 에너지 누적 나머지 (하위 16비트)
+    int64_t  elapsedUs;         // 적분 시간 (공칭 샘플 주기의 합)
+    int64_t  samples;           // 적분한 샘플 수
+    int32_t  iMin;              // 최소/최대 전류 (LO LSB 단위, HI 샘플은 21배)
+    int32_t  iMax;
+    int32_t  vMin;              // 최소/최대 버스 전압 (원시값)
+    int32_t  vMax;
+} K46_ENERGY_ACC_t;
+
+// K46_ENERGY_REPORT_t 구조체 정의
+// 적분 보고 프레임입니다. 첫 워드가 메시지 ID이며, 64비트 필드는 8바이트 경계에 있습니다.
+typedef struct {
+    int32_t msg;               // G_K40_INA226_MSG_ENERGY
+    int32_t running;           // 1 : 적분 중, 0 : 중지 (마지막 보고)
+    int64_t elapsedUs;         // 적분 시간
+    int64_t samples;           // 적분한 샘플 수
+    int64_t chargeNc[2];       // 스케일별 전하 (nC)
+    int64_t energyNj[2];       // 스케일별 에너지 (nJ)
+    int32_t iMinUa;            // 최소/최대 전류 (uA)
+    int32_t iMaxUa;
+    int32_t vMinMv;            // 최소/최대 버스 전압 (mV)
+    int32_t vMaxMv;
+} K46_ENERGY_REPORT_t;
+
+#define G_K46_REPORT_WORDS          (sizeof(K46_ENERGY_REPORT_t) / sizeof(int16_t))
+
+// 전역 변수
+K46_ENERGY_ACC_t    g_K46_Energy;                 // 누적기 (재연결 후에도 유지)
+volatile bool       g_K46_StopFlag    = false;    // 적분 중지 요청 (웹소켓 명령)
+volatile bool       g_K46_ResetFlag   = false;    // 적분 중 누적기 초기화 요청 (캡처 태스크가 보고 시점에 처리)
+volatile bool       g_K46_Running     = false;    // 적분 중
+volatile uint32_t   g_K46_ReportMs    = 1000;     // 보고 주기 (ms)
+
+// 함수 선언
+void K46_INA226_integrate(volatile MEASURE_t& measure, volatile int16_t* buffer);
+void K46_INA226_energy_reset();
+void K46_INA226_energy_report(K46_ENERGY_REPORT_t& report, bool running);
+
+// 누적기 초기화
+void K46_INA226_energy_reset() {
+    memset(&g_K46_Energy, 0, sizeof(g_K46_Energy));
+    g_K46_Energy.iMin = INT32_MAX;
+    g_K46_Energy.iMax = INT32_MIN;
+    g_K46_Energy.vMin = INT32_MAX;
+    g_K46_Energy.vMax = INT32_MIN;
+}
+
+// 보고 구간의 샘플 합을 누적기에 더함
+static void K46_INA226_fold(const int64_t* shuntSum, const int64_t* powerSum, uint32_t periodUs) {
+    for (int sc = 0; sc < 2; sc++) {
+        g_K46_Energy.chargeRawUs[sc] += shuntSum[sc] * (int64_t)periodUs;
+        int64_t e = powerSum[sc] * (int64_t)periodUs + g_K46_Energy.energyFrac[sc];
+        g_K46_Energy.energyRaw[sc] += e >> G_K46_ENERGY_FRAC_BITS;
+        g_K46_Energy.energyFrac[sc] = e & ((1 << G_K46_ENERGY_FRAC_BITS) - 1);
+    }
+}
+
+// 물리 단위 변환 (보고할 때만, 코어 1에서 초당 수 회)
+void K46_INA226_energy_report(K46_ENERGY_REPORT_t& report, bool running) {
+    memset(&report, 0, sizeof(report));
+    report.msg       = G_K40_INA226_MSG_ENERGY;
+    report.running   = running ? 1 : 0;
+    report.elapsedUs = g_K46_Energy.elapsedUs;
+    report.samples   = g_K46_Energy.samples;
+    for (int sc = 0; sc < 2; sc++) {
+        double lsbMa = (sc == G_K40_INA226_SCALE_HI) ? G_K47_LSB_HI_NA / 1000000.0 : G_K47_LSB_LO_NA / 1000000.0;
+        report.chargeNc[sc] = (int64_t)((double)g_K46_Energy.chargeRawUs[sc] * lsbMa);                                   // mA x us = nC
+        report.energyNj[sc] = (int64_t)((double)g_K46_Energy.energyRaw[sc] * (double)(1 << G_K46_ENERGY_FRAC_BITS) * lsbMa * (G_K47_LSB_BUS_UV / 1000000.0));    // mA x V x us = nJ
+    }
+    if (g_K46_Energy.samples > 0) {
+        report.iMinUa = (int32_t)(g_K46_Energy.iMin * (G_K47_LSB_LO_NA / 1000.0f));
+        report.iMaxUa = (int32_t)(g_K46_Energy.iMax * (G_K47_LSB_LO_NA / 1000.0f));
+        report.vMinMv = (int32_t)(g_K46_Energy.vMin * (G_K47_LSB_BUS_UV / 1000.0f));
+        report.vMaxMv = (int32_t)(g_K46_Energy.vMax * (G_K47_LSB_BUS_UV / 1000.0f));
+    }
+}
+
+// 보고 전송
+// 슬롯이 모두 전송 대기 중이면 건너뜁니다. (적분 중에는 큐에 보고만 들어가므로 대기 수 = 사용 중인 슬롯 수)
+static void K46_INA226_push_report(volatile int16_t* buffer, uint32_t& reportIndex, bool running) {
+    if (K43_queue_count(g_K40_INA226_TxQueue) >= G_K46_REPORT_SLOTS) {
+        return;
+    }
+    K46_ENERGY_REPORT_t report;
+    K46_INA226_energy_report(report, running);
+    uint32_t offset = (reportIndex % G_K46_REPORT_SLOTS) * G_K46_REPORT_WORDS;
+    memcpy((void*)(buffer + offset), &report, sizeof(report));
+    K40_INA226_push_block(offset, G_K46_REPORT_WORDS, G_K43_BLOCK_METER);
+    reportIndex++;
+}
+
+// K46_INA226_integrate: 에너지/전하 적분 함수
+// 트리거 버퍼 캡처와 같은 방식으로 샘플을 읽되 저장하지 않고 누적합니다.
+void K46_INA226_integrate(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    uint16_t reg_shunt, reg_bus;
+    uint32_t periodUs   = measure.m.cv_meas.periodUs;
+    int      oversample = measure.m.cv_meas.oversample > 1 ? measure.m.cv_meas.oversample : 1;
+    uint32_t reportMs   = g_K46_ReportMs;
+    if (reportMs < G_K46_REPORT_MS_MIN) {
+        reportMs = G_K46_REPORT_MS_MIN;
+    } else if (reportMs > G_K46_REPORT_MS_MAX) {
+        reportMs = G_K46_REPORT_MS_MAX;
+    }
+    uint32_t reportSamples = (reportMs * 1000) / periodUs;
+    if (reportSamples < 1) {
+        reportSamples = 1;
+    }
+
+    K40_INA226_AUTORANGE_t ar;
+    K40_INA226_autorange_begin(ar, measure.m.cv_meas.scale);
+    K50_INA226_switch_scale(ar.scale);
+    K41_INA226_drdy_begin();
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, G_K40_INA226_MASK_CNVR);
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
+
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+    int64_t  shuntSum[2] = {0, 0};    // 보고 구간의 스케일별 샘플 합
+    int64_t  powerSum[2] = {0, 0};
+    int16_t  lastShunt   = 0;         // 마지막 유효 션트 값과 스케일 (블랭킹 샘플 대체)
+    int      lastScale   = ar.scale;
+    uint32_t reportIndex = 0;
+    uint32_t inx         = 0;         // 페이싱 데드라인 번호
+    uint32_t sinceReport = 0;         // 마지막 보고 이후 샘플 수
+    if ((g_K46_Energy.samples == 0) || g_K46_ResetFlag) {
+        K46_INA226_energy_reset();    // 처음 시작 (최소/최대 초기값)
+        g_K46_ResetFlag = false;
+    }
+    g_K46_Running = true;
+    ESP_LOGI(G_K46_TAG, "Integrating : cfg 0x%04X period %uus x%d, report %ums", measure.m.cv_meas.cfg, periodUs, oversample, reportMs);
+
+    K41_INA226_pace_begin(periodUs);
+    // 중지 명령, 캡처 취소 또는 새 캡처 요청까지 (캡처 플래그는 지우지 않으므로 캡처 태스크가 바로 새 캡처를 실행)
+    while (!g_K46_StopFlag && !g_K40_INA226_AbortFlag && !g_K40_INA226_CVCaptureFlag) {
+        K41_INA226_pace_wait(inx);
+        K41_INA226_wait_drdy();
+        K40_INA226_read_oversampled(oversample, reg_shunt, reg_bus);
+
+        int16_t shunt       = (int16_t)reg_shunt;
+        int16_t vbus        = (int16_t)reg_bus;
+        int     sampleScale = ar.scale;
+        bool    switched;
+        if (K40_INA226_autorange_sample(ar, shunt, switched)) {
+            shunt       = lastShunt;    // 블랭킹 : 이전 범위의 마지막 값
+            sampleScale = lastScale;
+        } else {
+            lastShunt   = shunt;
+            lastScale   = sampleScale;
+            int32_t i   = (sampleScale == G_K40_INA226_SCALE_HI) ? (int32_t)shunt * G_K40_INA226_AUTO_LO_PER_HI : shunt;
+            g_K46_Energy.iMin = i < g_K46_Energy.iMin ? i : g_K46_Energy.iMin;
+            g_K46_Energy.iMax = i > g_K46_Energy.iMax ? i : g_K46_Energy.iMax;
+        }
+        g_K46_Energy.vMin = vbus < g_K46_Energy.vMin ? vbus : g_K46_Energy.vMin;
+        g_K46_Energy.vMax = vbus > g_K46_Energy.vMax ? vbus : g_K46_Energy.vMax;
+        shuntSum[sampleScale] += shunt;
+        powerSum[sampleScale] += (int32_t)shunt * (int32_t)vbus;
+        g_K46_Energy.elapsedUs += periodUs;
+        g_K46_Energy.samples++;
+        inx++;
+
+        if (++sinceReport >= reportSamples) {
+            sinceReport = 0;
+            K46_INA226_fold(shuntSum, powerSum, periodUs);
+            shuntSum[0] = shuntSum[1] = powerSum[0] = powerSum[1] = 0;
+            if (g_K46_ResetFlag) {
+                K46_INA226_energy_reset();
+                g_K46_ResetFlag = false;
+            }
+            K46_INA226_push_report(buffer, reportIndex, true);
+            // 데드라인 번호(uint32)가 넘치기 전에 페이싱 타임라인을 다시 시작
+            if (inx >= G_K46_PACE_RESTART) {
+                K41_INA226_pace_end(inx);
+                K41_INA226_pace_begin(periodUs);
+                inx = 0;
+            }
+        }
+    }
+    K41_INA226_pace_end(inx);
+    K41_INA226_drdy_end();
+
+    K46_INA226_fold(shuntSum, powerSum, periodUs);
+    g_K46_Running = false;
+    K46_INA226_push_report(buffer, reportIndex, false);
+    // 새 캡처가 버퍼 앞쪽을 덮어쓰기 전에 대기 중인 보고를 전송 (연결이 끊기면 전송 태스크가 큐를 비움)
+    for (int wait = 0; (wait < G_K46_DRAIN_WAIT_MS / 10) && (K43_queue_count(g_K40_INA226_TxQueue) > 0); wait++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    ESP_LOGI(G_K46_TAG, "Integration stopped : %lld samples, %.3fs, %d range switches", g_K46_Energy.samples,
+             (double)g_K46_Energy.elapsedUs / 1000000.0, ar.switches);
+}
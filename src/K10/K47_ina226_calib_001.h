@@ -0,0 +1,234 @@
+/*
+ * INA226 보정 (범위별 오프셋/이득)
+ *
+ * 션트 저항 공차, FET 온저항, INA226 이득 오차 때문에 보드마다 측정값이 공칭 LSB 기준으로 최대 2% 정도 다릅니다.
+ * 범위(HI, LO 션트, 버스 전압)별 오프셋과 이득으로 레지스터 원시값을 "공칭 LSB 기준 원시값"으로 바꾸므로
+ * 이후의 통계, 자동 범위, 전송 형식과 클라이언트 변환(공칭 LSB)은 바뀌지 않습니다.
+ *
+ * 고정소수점 형식:
+ * - 오프셋 : 원시값 1/16 LSB 단위 (Q4), 이득 : 1.0 = 65536 (Q16)
+ * - 보정값 = ((원시값 x 16 - offsetQ4) x gainQ16) >> 20 (반올림), int16 범위로 제한
+ * - 포화 원시값(32767, -32768)은 그대로 두어 오프스케일 검사와 자동 범위 전환이 계속 동작합니다.
+ * - 분기 없이 곱셈 1회와 최소/최대 선택으로 계산하며 읽기 함수(K40_INA226_read_shunt_bus 등)에서 샘플마다 적용합니다.
+ *
+ * 보정 절차 (cv_calib 명령, 캡처 태스크가 측정):
+ * - 점 0 : 기준값을 알고 있는 입력(보통 무부하 0mA 또는 0V)에서 원시값 평균을 측정 → 이득은 유지하고 오프셋 계산
+ * - 점 1 : 기준 계측기로 측정한 전류/전압을 가하고 원시값 평균을 측정 → 점 0이 있으면 2점 보정(오프셋 + 이득), 없으면 이득만 계산
+ * - save 명령으로 K50 NVS("calib")에 저장하며, 부팅 시 불러옵니다. 저장하지 않은 보정은 재부팅하면 사라집니다.
+ *
+ * 주요 함수:
+ * 1. K47_INA226_calib_load() / K47_INA226_calib_save() / K47_INA226_calib_reset(int range)
+ *    - NVS에서 불러오기, 저장, 기본값(오프셋 0, 이득 1)으로 초기화 (range < 0 이면 모든 범위)
+ * 2. K47_INA226_calib_select(int scale)
+ *    - 션트 범위 선택 (FET 스케일 전환 시 K40에서 호출)
+ * 3. K47_INA226_cal_shunt(uint16_t raw) / K47_INA226_cal_bus(uint16_t raw)
+ *    - 샘플 보정 커널 (K47_INA226_uncal()은 하드웨어 트리거 한계값용 역변환)
+ * 4. K47_INA226_calib_point(int range, int point, int32_t rawQ4, int32_t refQ4)
+ *    - 측정한 보정 점을 기록하고 오프셋/이득을 다시 계산합니다.
+ * 5. K47_INA226_calib_info(K47_CALIB_INFO_t& info, int status)
+ *    - 현재 보정 표와 공칭 LSB를 응답 프레임(MSG_CALIB)으로 만듭니다.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "K50_nv_data_002.h"
+
+#define         G_K47_TAG    "K47_calib"
+
+// 보정 범위 (0, 1은 션트 스케일 번호와 같음)
+#define G_K47_RANGE_HI              0
+#define G_K47_RANGE_LO              1
+#define G_K47_RANGE_BUS             2
+#define G_K47_NUM_RANGES            3
+
+// 공칭 LSB (정수, 물리 단위 변환의 기준)
+#define G_K47_LSB_HI_NA             50000    // 2.5uV / 0.05Ω
+#define G_K47_LSB_LO_NA             2381     // 2.5uV / 1.05Ω
+#define G_K47_LSB_BUS_UV            1250
+
+#define G_K47_GAIN_ONE              65536    // 이득 1.0 (Q16)
+#define G_K47_GAIN_MIN              58982    // 허용 이득 범위 0.9 ~ 1.1 (범위를 벗어나면 잘못된 기준값으로 봄)
+#define G_K47_GAIN_MAX              72090
+#define G_K47_MIN_SPAN_Q4           (500 * 16)    // 2점 보정의 최소 원시값 간격 (500 LSB)
+#define G_K47_CAL_SAMPLES           256      // 보정 점당 평균 샘플 수
+
+#define G_K47_MSG_CALIB             8888     // 보정 응답 메시지 (int32 구조체)
+
+// 응답 상태
+#define G_K47_STATUS_OK             0
+#define G_K47_STATUS_SAVED          1
+#define G_K47_STATUS_BAD_POINT      2    // 이득이 허용 범위를 벗어나거나 두 점이 너무 가까움 (보정 표는 바뀌지 않음)
+#define G_K47_STATUS_OFFSCALE       3    // 측정 중 포화
+#define G_K47_STATUS_BUSY           4    // 캡처 중이라 측정/초기화하지 않음 (보정 표는 바뀌지 않음)
+
+// K47_CAL_RANGE_t 구조체 정의
+typedef struct {
+    int32_t offsetQ4;    // 오프셋 (1/16 LSB)
+    int32_t gainQ16;     // 이득 (65536 = 1.0)
+} K47_CAL_RANGE_t;
+
+// K47_CAL_POINT_t 구조체 정의
+// 보정 절차 중 측정한 점 (저장하지 않음)
+typedef struct {
+    int32_t rawQ4;       // 측정 원시값 평균 (1/16 LSB)
+    int32_t refQ4;       // 기준값 (공칭 LSB 기준, 1/16 LSB)
+    bool    valid;
+} K47_CAL_POINT_t;
+
+// K47_CALIB_INFO_t 구조체 정의 (MSG_CALIB 응답, int32 필드)
+typedef struct {
+    int32_t msg;                          // G_K47_MSG_CALIB
+    int32_t status;                       // G_K47_STATUS_xxx
+    int32_t range;                        // 마지막으로 측정/변경한 범위 (-1 : 없음)
+    int32_t rawQ4;                        // 마지막으로 측정한 원시값 평균 (1/16 LSB)
+    int32_t offsetQ4[G_K47_NUM_RANGES];   // 범위별 오프셋
+    int32_t gainQ16[G_K47_NUM_RANGES];    // 범위별 이득
+    int32_t lsbHiNa;                      // 공칭 LSB (클라이언트 변환 계수)
+    int32_t lsbLoNa;
+    int32_t lsbBusUv;
+} K47_CALIB_INFO_t;
+
+// K47_CALIB_REQUEST_t 구조체 정의
+// 웹소켓 명령이 기록하고 캡처 태스크가 측정합니다.
+typedef struct {
+    int     range;
+    int     point;       // 0 또는 1
+    int32_t refQ4;
+} K47_CALIB_REQUEST_t;
+
+// 전역 변수
+K47_CAL_RANGE_t           g_K47_Cal[G_K47_NUM_RANGES];                   // 보정 표
+static K47_CAL_POINT_t    g_K47_Points[G_K47_NUM_RANGES][2];             // 측정한 보정 점
+static const K47_CAL_RANGE_t* g_K47_ShuntCal = &g_K47_Cal[0];            // 현재 션트 범위의 보정
+K47_CALIB_REQUEST_t       g_K47_Request;                                 // 측정 요청 (cv_calib point)
+
+// 함수 선언
+void K47_INA226_calib_load();
+void K47_INA226_calib_save();
+void K47_INA226_calib_reset(int range);
+int  K47_INA226_calib_point(int range, int point, int32_t rawQ4, int32_t refQ4);
+void K47_INA226_calib_info(K47_CALIB_INFO_t& info, int status, int range = -1, int32_t rawQ4 = 0);
+
+// 보정 커널
+// 포화 값은 그대로 두고, 나머지는 int16 범위로 제한합니다.
+static inline int16_t K47_INA226_apply(const K47_CAL_RANGE_t* cal, int16_t raw) {
+    int64_t v   = ((int64_t)((int32_t)raw * 16 - cal->offsetQ4) * cal->gainQ16 + (1 << 19)) >> 20;
+    int32_t c   = (int32_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+    bool    sat = (raw == 32767) | (raw == -32768);
+    return sat ? raw : (int16_t)c;
+}
+
+static inline uint16_t K47_INA226_cal_shunt(uint16_t raw) {
+    return (uint16_t)K47_INA226_apply(g_K47_ShuntCal, (int16_t)raw);
+}
+
+static inline uint16_t K47_INA226_cal_bus(uint16_t raw) {
+    return (uint16_t)K47_INA226_apply(&g_K47_Cal[G_K47_RANGE_BUS], (int16_t)raw);
+}
+
+// 역변환 : 보정 값을 레지스터 원시값으로 (INA226 경고 한계처럼 칩이 원시값으로 비교하는 경우)
+static inline int16_t K47_INA226_uncal(const K47_CAL_RANGE_t* cal, int16_t value) {
+    int64_t v = ((((int64_t)value << 20) / cal->gainQ16) + cal->offsetQ4 + 8) >> 4;
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+// 션트 범위 선택 (HI 이외의 값은 LO)
+static inline void K47_INA226_calib_select(int scale) {
+    g_K47_ShuntCal = &g_K47_Cal[scale == G_K47_RANGE_HI ? G_K47_RANGE_HI : G_K47_RANGE_LO];
+}
+
+// 보정 표 초기화
+void K47_INA226_calib_reset(int range) {
+    for (int r = 0; r < G_K47_NUM_RANGES; r++) {
+        if ((range < 0) || (range == r)) {
+            g_K47_Cal[r].offsetQ4 = 0;
+            g_K47_Cal[r].gainQ16  = G_K47_GAIN_ONE;
+            g_K47_Points[r][0].valid = false;
+            g_K47_Points[r][1].valid = false;
+        }
+    }
+}
+
+// NVS에서 보정 표 불러오기 (없거나 크기가 다르면 기본값)
+void K47_INA226_calib_load() {
+    K47_CAL_RANGE_t cal[G_K47_NUM_RANGES];
+    K47_INA226_calib_reset(-1);
+    if (!K50_NV_calib_load(cal, sizeof(cal))) {
+        ESP_LOGI(G_K47_TAG, "No stored calibration, using nominal LSB");
+        return;
+    }
+    for (int r = 0; r < G_K47_NUM_RANGES; r++) {
+        if ((cal[r].gainQ16 >= G_K47_GAIN_MIN) && (cal[r].gainQ16 <= G_K47_GAIN_MAX)) {
+            g_K47_Cal[r] = cal[r];
+        }
+        ESP_LOGI(G_K47_TAG, "Range %d : offset %.3f LSB, gain %.5f", r, g_K47_Cal[r].offsetQ4 / 16.0f,
+                 g_K47_Cal[r].gainQ16 / (float)G_K47_GAIN_ONE);
+    }
+}
+
+// NVS에 보정 표 저장
+void K47_INA226_calib_save() {
+    K47_CAL_RANGE_t cal[G_K47_NUM_RANGES];
+    memcpy(cal, g_K47_Cal, sizeof(cal));
+    K50_NV_calib_store(cal, sizeof(cal));
+    ESP_LOGI(G_K47_TAG, "Calibration stored");
+}
+
+// 보정 점 기록 및 오프셋/이득 계산
+// 보정 값 y = (x - offset) x gain 에서 점 0만 있으면 오프셋, 점 1만 있으면 이득, 둘 다 있으면 둘 다 구합니다.
+int K47_INA226_calib_point(int range, int point, int32_t rawQ4, int32_t refQ4) {
+    if ((range < 0) || (range >= G_K47_NUM_RANGES) || (point < 0) || (point > 1)) {
+        return G_K47_STATUS_BAD_POINT;
+    }
+    K47_CAL_POINT_t* p = g_K47_Points[range];
+    K47_CAL_RANGE_t  cal = g_K47_Cal[range];
+    p[point].rawQ4 = rawQ4;
+    p[point].refQ4 = refQ4;
+    p[point].valid = true;
+
+    if (p[0].valid && p[1].valid) {
+        int32_t span = p[1].rawQ4 - p[0].rawQ4;
+        if ((span < G_K47_MIN_SPAN_Q4) && (span > -G_K47_MIN_SPAN_Q4)) {
+            p[point].valid = false;
+            return G_K47_STATUS_BAD_POINT;
+        }
+        cal.gainQ16 = (int32_t)(((int64_t)(p[1].refQ4 - p[0].refQ4) << 16) / span);
+    } else if (point == 1) {
+        int32_t span = p[1].rawQ4 - cal.offsetQ4;
+        if ((span < G_K47_MIN_SPAN_Q4) && (span > -G_K47_MIN_SPAN_Q4)) {
+            p[point].valid = false;
+            return G_K47_STATUS_BAD_POINT;
+        }
+        cal.gainQ16 = (int32_t)(((int64_t)p[1].refQ4 << 16) / span);
+    }
+    if ((cal.gainQ16 < G_K47_GAIN_MIN) || (cal.gainQ16 > G_K47_GAIN_MAX)) {
+        p[point].valid = false;
+        return G_K47_STATUS_BAD_POINT;
+    }
+    // 점 0이 있으면 점 0이 기준값에 맞도록 오프셋 계산 (점 1만 있으면 기존 오프셋 유지)
+    if (p[0].valid) {
+        cal.offsetQ4 = p[0].rawQ4 - (int32_t)(((int64_t)p[0].refQ4 << 16) / cal.gainQ16);
+    }
+    g_K47_Cal[range] = cal;
+    ESP_LOGI(G_K47_TAG, "Range %d point %d : raw %.2f ref %.2f -> offset %.3f LSB, gain %.5f", range, point, rawQ4 / 16.0f,
+             refQ4 / 16.0f, cal.offsetQ4 / 16.0f, cal.gainQ16 / (float)G_K47_GAIN_ONE);
+    return G_K47_STATUS_OK;
+}
+
+// 응답 프레임 작성
+void K47_INA226_calib_info(K47_CALIB_INFO_t& info, int status, int range, int32_t rawQ4) {
+    memset(&info, 0, sizeof(info));
+    info.msg    = G_K47_MSG_CALIB;
+    info.status = status;
+    info.range  = range;
+    info.rawQ4  = rawQ4;
+    for (int r = 0; r < G_K47_NUM_RANGES; r++) {
+        info.offsetQ4[r] = g_K47_Cal[r].offsetQ4;
+        info.gainQ16[r]  = g_K47_Cal[r].gainQ16;
+    }
+    info.lsbHiNa  = G_K47_LSB_HI_NA;
+    info.lsbLoNa  = G_K47_LSB_LO_NA;
+    info.lsbBusUv = G_K47_LSB_BUS_UV;
+}
@@ -0,0 +1,165 @@
+/*
+ * 캡처 통계 커널
+ *
+ * 버퍼 캡처의 샘플별 통계(최소, 최대, 평균, 표준편차, RMS, 근사 P50/P99)를 샘플당 일정 시간에 누적합니다.
+ *
+ * 누적 방식:
+ * - 첫 샘플을 기준값(ref)으로 두고 (x - ref)와 (x - ref)^2를 64비트 정수로 누적합니다. (shifted-data 방식)
+ *   정수 누적은 정확하므로 Welford 갱신처럼 평균이 큰 신호에서도 분산의 자릿수 손실이 없고, 샘플마다 나눗셈이 없습니다.
+ * - 분산 = (Σd^2 - (Σd)^2 / n) / (n - 1), RMS = sqrt(분산 x (n - 1) / n + 평균^2)
+ * - 64비트 누적은 자동 범위 전류(LO 단위, 최대 약 69만)에서도 1억 샘플 이상 넘치지 않습니다.
+ *
+ * 백분위 히스토그램 (선택):
+ * - 고정 크기(G_K48_HIST_BINS) 구간 표이며, 구간 폭은 2의 거듭제곱입니다. 첫 샘플 주변 폭 1에서 시작하고,
+ *   범위를 벗어난 샘플이 오면 이웃 구간을 합쳐 폭을 두 배로 늘립니다. (캡처당 최대 약 20회, 샘플당 상각 일정 시간)
+ * - 백분위는 누적 개수가 n x p에 도달한 구간의 중앙값이므로 오차는 구간 폭의 절반 이내입니다.
+ *
+ * 주요 함수:
+ * 1. K48_INA226_stats_begin(K48_STATS_t& st, K48_HIST_t* hist)
+ *    - 통계 초기화 (hist가 NULL이면 백분위를 구하지 않음)
+ * 2. K48_INA226_stats_add(K48_STATS_t& st, int32_t x)
+ *    - 샘플 누적 (원시값 또는 자동 범위의 LO LSB 단위 값)
+ * 3. K48_INA226_stats_result(const K48_STATS_t& st, K48_RESULT_t& res)
+ *    - 원시값 단위의 결과 (캡처 함수가 LSB를 곱해 물리 단위로 바꿈)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define G_K48_HIST_BINS             512     // 백분위 히스토그램 구간 수 (2의 거듭제곱)
+
+// K48_HIST_t 구조체 정의
+typedef struct {
+    uint32_t bins[G_K48_HIST_BINS];
+    int32_t  base;     // 구간 0의 절대 구간 번호 (값 >> shift)
+    int      shift;    // 구간 폭 = 1 << shift
+} K48_HIST_t;
+
+// K48_STATS_t 구조체 정의
+typedef struct {
+    int64_t     sum;      // Σ(x - ref)
+    int64_t     sumSq;    // Σ(x - ref)^2
+    int32_t     ref;      // 기준값 (첫 샘플)
+    int32_t     min;
+    int32_t     max;
+    uint32_t    n;
+    K48_HIST_t* hist;     // 백분위 히스토그램 (NULL = 사용 안 함)
+} K48_STATS_t;
+
+// K48_RESULT_t 구조체 정의 (원시값 단위)
+typedef struct {
+    float mean;
+    float std;
+    float rms;
+    float min;
+    float max;
+    float p50;
+    float p99;
+} K48_RESULT_t;
+
+// 전역 변수
+K48_HIST_t g_K48_CurrentHist;    // 전류 백분위 히스토그램 (캡처 태스크 전용, 스택 대신 정적 할당)
+
+// 함수 선언
+void K48_INA226_stats_begin(K48_STATS_t& st, K48_HIST_t* hist);
+void K48_INA226_stats_result(const K48_STATS_t& st, K48_RESULT_t& res);
+
+// 히스토그램 구간 폭을 두 배로 늘림
+// up이 true이면 기존 내용을 아래쪽 절반에 두어 위쪽에 빈 구간을 만들고, false이면 위쪽 절반에 둡니다.
+static void K48_INA226_hist_widen(K48_HIST_t& h, bool up) {
+    int32_t base = up ? (h.base >> 1) : ((h.base + G_K48_HIST_BINS - 1) >> 1) - (G_K48_HIST_BINS - 1);
+    // 새 구간 j의 원본 두 구간은 up이면 j 이상, 아니면 j 이하이므로 그 방향으로 제자리 갱신 가능
+    for (int k = 0; k < G_K48_HIST_BINS; k++) {
+        int      j = up ? k : G_K48_HIST_BINS - 1 - k;
+        int32_t  i = 2 * (base + j) - h.base;
+        uint32_t v = 0;
+        if (i >= 0 && i < G_K48_HIST_BINS) {
+            v += h.bins[i];
+        }
+        if (i + 1 >= 0 && i + 1 < G_K48_HIST_BINS) {
+            v += h.bins[i + 1];
+        }
+        h.bins[j] = v;
+    }
+    h.base = base;
+    h.shift++;
+}
+
+// 히스토그램 누적
+static inline void K48_INA226_hist_add(K48_HIST_t& h, int32_t x) {
+    int32_t i = (x >> h.shift) - h.base;
+    while ((uint32_t)i >= G_K48_HIST_BINS) {
+        K48_INA226_hist_widen(h, i >= 0);
+        i = (x >> h.shift) - h.base;
+    }
+    h.bins[i]++;
+}
+
+// 통계 초기화
+void K48_INA226_stats_begin(K48_STATS_t& st, K48_HIST_t* hist) {
+    st.sum   = 0;
+    st.sumSq = 0;
+    st.ref   = 0;
+    st.min   = INT32_MAX;
+    st.max   = INT32_MIN;
+    st.n     = 0;
+    st.hist  = hist;
+}
+
+// 샘플 누적
+static inline void K48_INA226_stats_add(K48_STATS_t& st, int32_t x) {
+    if (st.n == 0) {
+        st.ref = x;
+        if (st.hist != NULL) {
+            memset(st.hist->bins, 0, sizeof(st.hist->bins));
+            st.hist->shift = 0;
+            st.hist->base  = x - G_K48_HIST_BINS / 2;
+        }
+    }
+    int32_t d = x - st.ref;
+    st.sum += d;
+    st.sumSq += (int64_t)d * d;
+    st.min = x < st.min ? x : st.min;
+    st.max = x > st.max ? x : st.max;
+    st.n++;
+    if (st.hist != NULL) {
+        K48_INA226_hist_add(*st.hist, x);
+    }
+}
+
+// 백분위 (누적 개수가 n x p에 도달한 구간의 중앙값)
+static float K48_INA226_hist_percentile(const K48_HIST_t& h, uint32_t n, float p) {
+    uint32_t target = (uint32_t)((float)n * p);
+    uint32_t count  = 0;
+    int      i      = 0;
+    for (; i < G_K48_HIST_BINS - 1; i++) {
+        count += h.bins[i];
+        if (count > target) {
+            break;
+        }
+    }
+    return (float)((int64_t)(h.base + i) << h.shift) + (float)((1 << h.shift) - 1) * 0.5f;
+}
+
+// 결과 계산 (샘플이 없으면 모두 0)
+void K48_INA226_stats_result(const K48_STATS_t& st, K48_RESULT_t& res) {
+    memset(&res, 0, sizeof(res));
+    if (st.n == 0) {
+        return;
+    }
+    double n    = (double)st.n;
+    double mean = (double)st.sum / n;
+    double m2   = (double)st.sumSq - (double)st.sum * mean;    // Σ(x - 평균)^2
+    m2          = m2 < 0.0 ? 0.0 : m2;
+    double avg  = (double)st.ref + mean;
+    res.mean = (float)avg;
+    res.std  = (st.n > 1) ? (float)sqrt(m2 / (n - 1.0)) : 0.0f;
+    res.rms  = (float)sqrt(m2 / n + avg * avg);
+    res.min  = (float)st.min;
+    res.max  = (float)st.max;
+    if (st.hist != NULL) {
+        res.p50 = K48_INA226_hist_percentile(*st.hist, st.n, 0.50f);
+        res.p99 = K48_INA226_hist_percentile(*st.hist, st.n, 0.99f);
+    }
+}
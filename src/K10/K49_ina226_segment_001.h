@@ -0,0 +1,267 @@
+/*
+ * 분할 게이트 캡처
+ *
+ * 게이트 신호(g_K00_PIN_GATE)가 LOW인 구간(창)을 최대 N개까지 한 번의 캡처로 버퍼에 기록합니다.
+ * 창이 닫히면 클라이언트 왕복 없이 바로 다음 게이트를 기다리므로, 장치가 게이트로 알리는 연속 무선 송신 버스트 같은
+ * 반복 구간을 한 세션에서 측정할 수 있습니다.
+ *
+ * 프레임 형식:
+ * - [MSG_TX_START, periodUs, scale] (샘플 없음, 첫 게이트가 열리면 전송)
+ * - 창마다 [MSG_TX_SEGMENT, index, startUs 비트 0-15, 16-31, 32-47, 48-63] + (shunt, bus) 샘플
+ *   1초마다 MSG_TX 마커로 패킷을 나누고, 자동 범위 전환은 MSG_TX_RANGE 패킷입니다. (기존 형식과 동일)
+ * - 창이 닫히면 창 요약 [MSG_TX_SEG_END, index] + K49_SEGMENT_t (int32, 창 길이와 통계)
+ *   창 길이와 통계는 창이 끝나야 알 수 있고 창의 샘플은 진행 중에 전송되므로, 시작 시각은 창 헤더에, 나머지는 창 요약에 둡니다.
+ * - startUs는 첫 게이트가 열린 시각 기준 int64이며 (int32 us는 약 35분에 넘침), 창 길이는 게이트 핀 에지 ISR(K41)이 기록한 열림부터 닫힘까지입니다.
+ * - 창 요약의 iGateNa는 첫/마지막 샘플을 게이트 에지로 잘라 가중한 평균 전류입니다. (창 전하 = iGateNa x lengthUs, K40 게이트 캡처와 같음)
+ * - 종료 프레임(MSG_TX_COMPLETE)의 통계와 페이싱 통계는 모든 창의 샘플 기준이고, segments는 기록한 창 수입니다.
+ *   gateUs는 창 길이 합계, iGateNa는 모든 창의 전하 합계 / gateUs 입니다. (첫/마지막 샘플 필드는 0)
+ *
+ * 종료 조건:
+ * - N개 창 기록, 버퍼 부족 (진행 중인 창은 잘림), 취소 (cv_cancel, 연결 해제)
+ * - 다음 게이트 대기 시간 초과 (cv_meas.timeoutMs, 창마다 적용, status = G_K40_INA226_STATUS_TIMEOUT, 기록한 창은 그대로 전송)
+ *
+ * 주요 함수:
+ * 1. K49_INA226_capture_segmented(volatile MEASURE_t &measure, volatile int16_t* buffer)
+ *    - cv_meas.segments개의 게이트 창을 캡처합니다. 측정 요약(CV_MEASURE_t)은 모든 창의 샘플 기준입니다.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "K40_ina226_002.h"
+
+#define         G_K49_TAG    "K49_segment"
+
+#define G_K49_MAX_SEGMENTS          1000    // 캡처당 최대 창 수
+#define G_K49_HDR_WORDS             6       // 창 헤더 워드 수 [MSG_TX_SEGMENT, index, startUs 16비트 x 4]
+
+// K49_SEGMENT_t 구조체 정의
+// 창 요약 [MSG_TX_SEG_END, index] 뒤에 붙는 int32 필드입니다. (클라이언트는 메시지의 바이트 4부터 읽음)
+// 시작 시각은 int64를 하위/상위 int32로 나누어 구조체에 패딩이 생기지 않게 합니다. (리틀 엔디언 int64와 같은 배치)
+typedef struct {
+    uint32_t startUsLo;  // 창 시작 시각 (첫 게이트 열림 기준, us) 하위 32비트
+    int32_t startUsHi;   //                                          상위 32비트
+    int32_t lengthUs;    // 게이트 열림부터 닫힘까지 (us, 게이트 에지 ISR 시각)
+    int32_t nSamples;    // 창의 샘플 수
+    int32_t iAvgNa;      // 전류 평균 / 최소 / 최대 / RMS (nA, 자동 범위 블랭킹 샘플 제외)
+    int32_t iMinNa;
+    int32_t iMaxNa;
+    int32_t iRmsNa;
+    int32_t vAvgUv;      // 버스 전압 평균 (uV)
+    int32_t pAvgUw;      // 샘플별 전력 평균 (uW)
+    int32_t iGateNa;     // 에지 가중 평균 전류 (nA, 창 전하 = iGateNa x lengthUs)
+} K49_SEGMENT_t;
+
+#define G_K49_SUM_WORDS             (2 + (int)(sizeof(K49_SEGMENT_t) / sizeof(int16_t)))    // 창 요약 워드 수
+
+// 함수 선언
+void K49_INA226_capture_segmented(volatile MEASURE_t& measure, volatile int16_t* buffer);
+
+// 창 요약 기록 함수
+// 버퍼의 w 워드부터 창 요약을 기록합니다. 전류 통계는 자동 범위이면 LO LSB 단위입니다. (K40_INA226_stats_end와 같은 환산)
+static void K49_INA226_segment_record(volatile MEASURE_t& measure, volatile int16_t* buffer, int w, int index, K49_SEGMENT_t& seg,
+                                      const K48_STATS_t& cs, const K48_STATS_t& bs, const K40_INA226_POWER_STATS_t& ps) {
+    float        lsbMa = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? G_K40_INA226_LSB_HI_MA : G_K40_INA226_LSB_LO_MA;
+    K48_RESULT_t res;
+    K48_INA226_stats_result(cs, res);
+    seg.iAvgNa = (int32_t)(res.mean * lsbMa * 1000000.0f);
+    seg.iMinNa = (int32_t)(res.min * lsbMa * 1000000.0f);
+    seg.iMaxNa = (int32_t)(res.max * lsbMa * 1000000.0f);
+    seg.iRmsNa = (int32_t)(res.rms * lsbMa * 1000000.0f);
+    K48_INA226_stats_result(bs, res);
+    seg.vAvgUv = (int32_t)(res.mean * G_K40_INA226_LSB_BUS_V * 1000000.0f);
+    seg.pAvgUw = (ps.n == 0) ? 0 : (int32_t)((float)(ps.sum / ps.n) * lsbMa * G_K40_INA226_LSB_BUS_V * 1000.0f);
+
+    buffer[w]     = G_K40_INA226_MSG_TX_SEG_END;
+    buffer[w + 1] = (int16_t)index;
+    memcpy((void*)(buffer + w + 2), &seg, sizeof(seg));
+}
+
+// K49_INA226_capture_segmented: 분할 게이트 캡처 함수
+void K49_INA226_capture_segmented(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    int16_t     data_i16;
+    uint16_t    reg_bus, reg_shunt;
+    K48_STATS_t cs, bs;    // 모든 창의 전류 (자동 범위는 LO LSB 단위) 및 버스 전압 통계
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    K48_INA226_stats_begin(bs, NULL);
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
+    int maxSegments = measure.m.cv_meas.segments;
+    if ((maxSegments < 1) || (maxSegments > G_K49_MAX_SEGMENTS)) {
+        maxSegments = G_K49_MAX_SEGMENTS;
+    }
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);
+    K40_INA226_AUTORANGE_t ar;
+    K40_INA226_autorange_begin(ar, measure.m.cv_meas.scale);
+    // 버퍼 끝에 창 요약과 패킷 마커 공간을 남김 (자동 범위는 범위 패킷 헤더 공간도)
+    int limitWords = 2 * g_K40_MaxSamples - G_K49_SUM_WORDS - 1;
+    if (ar.enabled) {
+        limitWords -= 3 * G_K40_INA226_AUTO_MAX_SWITCHES;
+    }
+    K50_INA226_switch_scale(ar.scale);    // 스케일 전환 (자동이면 HI에서 시작)
+    K41_INA226_drdy_begin();              // ALERT 핀 인터럽트 연결
+    K41_INA226_gate_begin();              // 게이트 에지 시각 기록
+    int64_t halfConvUs = K40_INA226_conversion_us(measure.m.cv_meas.cfg, false) / 2;    // 변환 완료 시각 → 변환 구간 중앙
+    float   lsbMa      = (measure.m.cv_meas.scale == G_K40_INA226_SCALE_HI) ? G_K40_INA226_LSB_HI_MA : G_K40_INA226_LSB_LO_MA;
+
+    // 창 사이에도 연속 변환을 유지하여 게이트가 열리면 바로 샘플링
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, G_K40_INA226_MASK_CNVR);
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+    buffer[0]        = G_K40_INA226_MSG_TX_START;
+    buffer[1]        = K40_INA226_period_word(measure.m.cv_meas.periodUs);
+    buffer[2]        = ar.scale;
+    int  offset      = 3;        // 샘플 사이에 끼운 워드 수 (헤더, 마커, 창 헤더/요약)
+    int  numSamples  = 0;        // 모든 창의 샘플 수
+    int  packetStart = 0;        // 현재 패킷의 시작 워드
+    int  segments    = 0;        // 기록한 창 수
+    bool started     = false;    // 첫 게이트가 열려 시작 패킷을 보냄
+    bool aborted     = false;
+    int64_t  t0Us      = 0;      // 첫 게이트 열림 시각
+    uint64_t sampledUs = 0;      // 창 길이 합계 (샘플 속도 계산)
+    double   chargeNaUs = 0.0;   // 에지 가중 전하 합계 (nA x us)
+    K40_INA226_reset_tx_end();
+    K41_PACE_STATS_t pace;       // 창마다 다시 시작하는 페이싱 통계의 합계
+    memset(&pace, 0, sizeof(pace));
+    pace.periodUs = measure.m.cv_meas.periodUs;
+
+    while (!aborted && (segments < maxSegments)) {
+        // 창 헤더와 샘플 하나가 들어갈 공간이 없으면 종료
+        if (offset + 2 * numSamples + G_K49_HDR_WORDS + 2 > limitWords) {
+            ESP_LOGW(G_K49_TAG, "Buffer full after %d segments", segments);
+            break;
+        }
+        // 게이트 대기 (취소, 시간 초과 시 종료)
+        int64_t openUs;
+        if (!K40_INA226_wait_gate(measure.m.cv_meas.timeoutMs, openUs)) {
+            break;
+        }
+        uint32_t closes = g_K41_GateCloses;    // 이후의 닫힘 에지가 창의 끝
+        if (!started) {
+            t0Us    = openUs;
+            started = true;
+            K40_INA226_push_block(0, 0, G_K43_BLOCK_GATE_OPEN);    // 게이트가 열렸음을 알림
+            K40_INA226_push_block(0, offset, G_K43_BLOCK_START);
+        }
+
+        // 창 헤더
+        K49_SEGMENT_t seg;
+        memset(&seg, 0, sizeof(seg));
+        int64_t startUs = openUs - t0Us;
+        seg.startUsLo   = (uint32_t)startUs;
+        seg.startUsHi   = (int32_t)(startUs >> 32);
+        int hdr         = offset + 2 * numSamples;
+        buffer[hdr]     = G_K40_INA226_MSG_TX_SEGMENT;
+        buffer[hdr + 1] = (int16_t)segments;
+        for (int k = 0; k < 4; k++) {
+            buffer[hdr + 2 + k] = (int16_t)((startUs >> (16 * k)) & 0xFFFF);
+        }
+        offset += G_K49_HDR_WORDS;
+        packetStart = hdr;
+
+        K48_STATS_t scs, sbs;    // 창의 전류 및 버스 전압 통계
+        K48_INA226_stats_begin(scs, NULL);
+        K48_INA226_stats_begin(sbs, NULL);
+        K40_INA226_POWER_STATS_t sps;
+        K40_INA226_power_begin(sps);
+        K40_INA226_EDGE_t edge;    // 게이트 에지로 자른 첫/마지막 샘플 가중 평균
+        K40_INA226_edge_begin(edge, openUs);
+        int n = 0;    // 창의 샘플 수
+
+        K41_INA226_pace_begin(measure.m.cv_meas.periodUs);    // 창마다 게이트 열림 시각 기준 데드라인
+        while (!aborted && (digitalRead(g_K00_PIN_GATE) == LOW) && (offset + 2 * (numSamples + 1) <= limitWords)) {
+            K41_INA226_pace_wait(n);
+            int bufIndex = offset + 2 * numSamples;
+            K41_INA226_wait_drdy();
+            int64_t sampleUs = g_K41_DrdyUs - halfConvUs;    // 샘플 시각 (변환 구간 중앙)
+            K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+            data_i16         = (int16_t)reg_shunt;
+            buffer[bufIndex] = data_i16;
+            int     sampleScale = ar.scale;    // 이 샘플을 측정한 스케일 (검사 후 전환될 수 있음)
+            bool    switched;
+            int32_t value = 0;
+            bool    valid = !K40_INA226_autorange_sample(ar, data_i16, switched);
+            if (valid) {
+                value = (ar.enabled && (sampleScale == G_K40_INA226_SCALE_HI)) ? (int32_t)data_i16 * G_K40_INA226_AUTO_LO_PER_HI : data_i16;
+                K48_INA226_stats_add(cs, value);
+                K48_INA226_stats_add(scs, value);
+                K40_INA226_edge_add(edge, value, sampleUs);
+            }
+
+            data_i16             = (int16_t)reg_bus;
+            buffer[bufIndex + 1] = data_i16;
+            K48_INA226_stats_add(bs, data_i16);
+            K48_INA226_stats_add(sbs, data_i16);
+            if (valid) {
+                K40_INA226_power_add(ps, value, data_i16);
+                K40_INA226_power_add(sps, value, data_i16);
+            }
+
+            // 일정 시간마다 패킷을 분할하여 전송
+            if (((n + 1) % samplesPerSecond) == 0) {
+                offset++;
+                aborted = K40_INA226_packet_split(buffer, bufIndex + 2, packetStart, true);    // 창 패킷은 시작 헤더 뒤 (시작 패킷 아님)
+            }
+            // 범위가 바뀌면 다음 샘플부터 새 범위 패킷
+            if (switched) {
+                K40_INA226_autorange_packet(buffer, ar, offset + 2 * (numSamples + 1), offset, packetStart);
+            }
+
+            n++;
+            numSamples++;
+        }
+        int64_t closeUs = K40_INA226_gate_close_us(closes);    // 게이트 닫힘 에지 시각
+        float   wFirst, wLast;
+        float   avg  = K40_INA226_edge_result(edge, closeUs, measure.m.cv_meas.periodUs, wFirst, wLast);
+        seg.lengthUs = (int32_t)(closeUs - openUs);
+        seg.nSamples = n;
+        seg.iGateNa  = (int32_t)(avg * lsbMa * 1000000.0f);
+        chargeNaUs += (double)seg.iGateNa * seg.lengthUs;
+        K41_INA226_pace_end(n);
+        pace.samples   += g_K41_PaceStats.samples;
+        pace.overruns  += g_K41_PaceStats.overruns;
+        pace.sumLateUs += g_K41_PaceStats.sumLateUs;
+        if (g_K41_PaceStats.maxLateUs > pace.maxLateUs) {
+            pace.maxLateUs = g_K41_PaceStats.maxLateUs;
+        }
+        sampledUs += (uint32_t)seg.lengthUs;
+
+        // 남은 샘플 (빈 MSG_TX 패킷 제외) 과 창 요약 전송
+        int sum = offset + 2 * numSamples;
+        K40_INA226_packet_tail(sum, packetStart);
+        K49_INA226_segment_record(measure, buffer, sum, segments, seg, scs, sbs, sps);
+        offset += G_K49_SUM_WORDS;
+        K40_INA226_push_block(sum, G_K49_SUM_WORDS, 0);
+        ESP_LOGD(G_K49_TAG, "Segment %d : start %lldus, %dus, %d samples, %.3fmA", segments, (long long)startUs, seg.lengthUs, n, (float)seg.iAvgNa / 1000000.0f);
+        segments++;
+        aborted = aborted || K40_INA226_abort_check();
+    }
+
+    // 게이트가 한 번도 열리지 않았으면 시작 패킷만 (게이트 캡처와 같음)
+    if (!started) {
+        K40_INA226_push_block(0, offset, G_K43_BLOCK_START);
+    }
+    g_K41_PaceStats = pace;    // 종료 프레임은 모든 창의 페이싱 통계
+    g_K40_INA226_TxEnd.segments = segments;
+    g_K40_INA226_TxEnd.gateUs   = (int32_t)sampledUs;
+    g_K40_INA226_TxEnd.iGateNa  = (sampledUs == 0) ? 0 : (int32_t)(chargeNaUs / (double)sampledUs);
+    K40_INA226_capture_finish(measure, numSamples, &ps, cs, &bs);
+
+    K41_INA226_drdy_end();
+    K41_INA226_gate_end();
+    measure.m.cv_meas.nSamples   = numSamples;
+    measure.m.cv_meas.segments   = segments;
+    measure.m.cv_meas.sampleRate = (sampledUs == 0) ? 0.0f : (1000000.0f * (float)numSamples) / (float)sampledUs;
+
+    if (ar.enabled) {
+        ESP_LOGI(G_K49_TAG, "Auto range : %d switches, ended %s", ar.switches, ar.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI");
+    }
+    ESP_LOGI(G_K49_TAG, "CV Segmented : %d segments, %d samples 0x%04X %s %.1fHz %.1fV %.3fmA\n", segments, numSamples,
+             measure.m.cv_meas.cfg, ar.enabled ? "AUTO" : (measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI"),
+             measure.m.cv_meas.sampleRate, measure.m.cv_meas.vavg, measure.m.cv_meas.iavgma);
+}
@@ -26,6 +26,10 @@ void K50_NV_options_store(K50_OPTIONS_t &p_options); // 옵션을 저장하는 
 void K50_NV_options_load(K50_OPTIONS_t &p_options);  // 옵션을 로드하는 함수
 void K50_NV_options_reset(K50_OPTIONS_t &p_options); // 옵션을 초기화하는 함수
 void K50_NV_options_print(K50_OPTIONS_t &p_options); // 옵션을 출력하는 함수
+bool K50_NV_calib_load(void *p_data, size_t p_len);   // 보정 표를 로드하는 함수
+void K50_NV_calib_store(const void *p_data, size_t p_len); // 보정 표를 저장하는 함수
+uint32_t K50_NV_mem_budget_load();                   // 캡처 버퍼 예산(KB)을 로드하는 함수
+void K50_NV_mem_budget_store(uint32_t p_budgetKB);   // 캡처 버퍼 예산(KB)을 저장하는 함수
 
 
 // 옵션을 로드하는 함수
@@ -67,3 +71,39 @@ void K50_NV_options_store(K50_OPTIONS_t &p_options) {
     K50_NV_options_print(p_options); // 저장된 옵션 출력
 }
 
+// 보정 표를 로드하는 함수
+// 저장된 크기가 다르면 (보정 형식이 바뀐 경우) 읽지 않고 false를 반환합니다.
+bool K50_NV_calib_load(void *p_data, size_t p_len) {
+    if (g_K50_NV_Prefs.begin("calib", G_K50_NV_MODE_READ_ONLY) == false) {
+        g_K50_NV_Prefs.end(); // Preferences 종료
+        return false;
+    }
+    bool ok = (g_K50_NV_Prefs.getBytesLength("ranges") == p_len) && (g_K50_NV_Prefs.getBytes("ranges", p_data, p_len) == p_len);
+    g_K50_NV_Prefs.end(); // Preferences 종료
+    return ok;
+}
+
+// 보정 표를 저장하는 함수
+void K50_NV_calib_store(const void *p_data, size_t p_len) {
+    g_K50_NV_Prefs.begin("calib", G_K50_NV_MODE_READ_WRITE); // Preferences 시작
+    g_K50_NV_Prefs.putBytes("ranges", p_data, p_len); // 범위별 오프셋/이득 저장
+    g_K50_NV_Prefs.end(); // Preferences 종료
+}
+
+// 캡처 버퍼 예산을 로드하는 함수 (없으면 0 = 예비 공간을 뺀 전체)
+uint32_t K50_NV_mem_budget_load() {
+    if (g_K50_NV_Prefs.begin("capmem", G_K50_NV_MODE_READ_ONLY) == false) {
+        g_K50_NV_Prefs.end(); // Preferences 종료
+        return 0;
+    }
+    uint32_t budgetKB = g_K50_NV_Prefs.getUInt("budgetKB", 0); // 예산 읽기
+    g_K50_NV_Prefs.end(); // Preferences 종료
+    return budgetKB;
+}
+
+// 캡처 버퍼 예산을 저장하는 함수
+void K50_NV_mem_budget_store(uint32_t p_budgetKB) {
+    g_K50_NV_Prefs.begin("capmem", G_K50_NV_MODE_READ_WRITE); // Preferences 시작
+    g_K50_NV_Prefs.putUInt("budgetKB", p_budgetKB); // 예산 저장
+    g_K50_NV_Prefs.end(); // Preferences 종료
+}
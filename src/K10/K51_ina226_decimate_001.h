@@ -0,0 +1,292 @@
+/*
+ * INA226 데시메이션 캡처
+ *
+ * 긴 캡처에서 샘플 N개(데시메이션 배수, 클라이언트가 선택)마다 레코드 하나만 버퍼에 기록하여 전송합니다.
+ * 브라우저가 그릴 때 버리던 샘플을 장치에서 줄이므로 링크 트래픽이 10~100배 줄고, 같은 버퍼로 더 긴 시간을 캡처합니다.
+ * 샘플 경로(하드웨어 타이머 페이싱, ALERT 대기, 오버샘플링 읽기)는 트리거 버퍼 캡처와 같습니다.
+ *
+ * 모드:
+ * - 엔벨로프 (G_K51_MODE_ENVELOPE) : 버킷마다 [iMin, iMax, iAvg, vMin, vMax, vAvg] (원시값 6워드)
+ *   최소/최대가 그대로 남으므로 짧은 전류 피크도 보입니다.
+ * - LTTB (G_K51_MODE_LTTB) : Largest-Triangle-Three-Buckets, 버킷마다 실제 샘플 하나 [버킷 안 위치, shunt, bus] (3워드)
+ *   이전에 고른 점 A와 다음 버킷의 평균 C로 삼각형 면적이 가장 큰 전류 샘플 B를 고릅니다.
+ *   다음 버킷이 끝나야 고를 수 있으므로 원시 샘플 두 버킷(g_K51_LttbRaw)만 유지하며 스트리밍으로 계산합니다.
+ *   첫 버킷은 첫 샘플, 마지막 버킷은 마지막 샘플입니다.
+ * - 레코드 k는 버킷 k(샘플 k x N ~ k x N + N - 1)이며, 마지막 버킷은 N개보다 적을 수 있습니다.
+ *
+ * 프레임 형식:
+ * - [MSG_TX_START_DECIM, periodUs, scale, factor, mode] + 레코드, 이후 [MSG_TX] + 레코드 (약 1초 분량마다)
+ * - 종료 프레임(MSG_TX_COMPLETE)의 통계(평균/최소/최대, 표준편차, 백분위, 전력)는 줄이기 전 모든 샘플 기준입니다.
+ *
+ * 제한:
+ * - 자동 범위는 지원하지 않으며 HI 스케일로 캡처합니다. (레코드가 원시값 한 워드)
+ * - 전력/마커 채널은 지원하지 않습니다.
+ *
+ * 주요 함수:
+ * 1. K51_INA226_capture_decimated(volatile MEASURE_t &measure, volatile int16_t* buffer)
+ *    - cv_meas.nSamples개 샘플을 cv_meas.decimate 배수, cv_meas.decimMode 모드로 줄여 전송합니다.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "K40_ina226_002.h"
+
+#define         G_K51_TAG    "K51_decimate"
+
+#define G_K51_MODE_ENVELOPE         0       // 최소/최대/평균 엔벨로프
+#define G_K51_MODE_LTTB             1       // Largest-Triangle-Three-Buckets
+#define G_K51_MIN_FACTOR            2       // 데시메이션 배수 범위
+#define G_K51_MAX_FACTOR            1000    // (LTTB 원시 버킷 버퍼 크기)
+#define G_K51_ENV_WORDS             6       // 엔벨로프 레코드 워드 수
+#define G_K51_LTTB_WORDS            3       // LTTB 레코드 워드 수
+#define G_K51_HDR_WORDS             5       // 시작 헤더 워드 수
+
+// K51_ENV_t 구조체 정의
+// 엔벨로프 모드에서 채우는 버킷의 상태입니다.
+typedef struct {
+    int     n;       // 버킷의 샘플 수
+    int16_t iMin;    // 전류 / 버스 전압 최소, 최대 (원시값)
+    int16_t iMax;
+    int16_t vMin;
+    int16_t vMax;
+    int32_t iSum;    // 전류 / 버스 전압 합 (N <= 1000 이므로 32비트)
+    int32_t vSum;
+} K51_ENV_t;
+
+// K51_LTTB_t 구조체 정의
+// LTTB 모드의 상태입니다. 원시 샘플은 g_K51_LttbRaw[cur]에 채우고, 반대쪽은 점 선택을 기다리는 이전 버킷입니다.
+typedef struct {
+    int     factor;     // 버킷 크기
+    int     cur;        // 채우는 버킷 버퍼 (0, 1)
+    int     n;          // 채우는 버킷의 샘플 수
+    int32_t sum;        // 채우는 버킷의 전류 합 (다음 버킷 평균 C)
+    int     pending;    // 점 선택을 기다리는 이전 버킷의 샘플 수 (0 = 없음)
+    int32_t bucket;     // 채우는 버킷 번호
+    float   ax;         // 마지막으로 고른 점 A (샘플 번호, 전류 원시값)
+    float   ay;
+} K51_LTTB_t;
+
+static int16_t g_K51_LttbRaw[2][G_K51_MAX_FACTOR][2];    // LTTB 원시 버킷 (shunt, bus)
+
+// 함수 선언
+void K51_INA226_capture_decimated(volatile MEASURE_t& measure, volatile int16_t* buffer);
+
+// 엔벨로프 버킷 초기화 함수
+static void K51_env_begin(K51_ENV_t& e) {
+    e.n    = 0;
+    e.iMin = e.vMin = 32767;
+    e.iMax = e.vMax = -32768;
+    e.iSum = e.vSum = 0;
+}
+
+// 엔벨로프 레코드 기록 함수 (기록한 워드 수 반환, 빈 버킷은 0)
+static int K51_env_flush(K51_ENV_t& e, volatile int16_t* buffer, int w) {
+    if (e.n == 0) {
+        return 0;
+    }
+    buffer[w]     = e.iMin;
+    buffer[w + 1] = e.iMax;
+    buffer[w + 2] = (int16_t)(e.iSum / e.n);
+    buffer[w + 3] = e.vMin;
+    buffer[w + 4] = e.vMax;
+    buffer[w + 5] = (int16_t)(e.vSum / e.n);
+    K51_env_begin(e);
+    return G_K51_ENV_WORDS;
+}
+
+// 엔벨로프 샘플 추가 함수
+// 버킷이 차면 레코드를 기록하고 워드 수를 반환합니다.
+static inline int K51_env_add(K51_ENV_t& e, int factor, int16_t s, int16_t v, volatile int16_t* buffer, int w) {
+    e.iMin = s < e.iMin ? s : e.iMin;
+    e.iMax = s > e.iMax ? s : e.iMax;
+    e.vMin = v < e.vMin ? v : e.vMin;
+    e.vMax = v > e.vMax ? v : e.vMax;
+    e.iSum += s;
+    e.vSum += v;
+    e.n++;
+    return (e.n == factor) ? K51_env_flush(e, buffer, w) : 0;
+}
+
+// LTTB 초기화 함수
+static void K51_lttb_begin(K51_LTTB_t& l, int factor) {
+    memset(&l, 0, sizeof(l));
+    l.factor = factor;
+}
+
+// LTTB 레코드 기록 함수
+// 버퍼 raw의 k번째 샘플을 고른 점으로 기록하고 점 A를 갱신합니다.
+static int K51_lttb_emit(K51_LTTB_t& l, int raw, int32_t bucket, int k, volatile int16_t* buffer, int w) {
+    buffer[w]     = (int16_t)k;
+    buffer[w + 1] = g_K51_LttbRaw[raw][k][0];
+    buffer[w + 2] = g_K51_LttbRaw[raw][k][1];
+    l.ax          = (float)bucket * l.factor + k;
+    l.ay          = g_K51_LttbRaw[raw][k][0];
+    return G_K51_LTTB_WORDS;
+}
+
+// LTTB 점 선택 함수
+// 이전 버킷(반대쪽 버퍼, bucket - 1) 중 점 A와 C(cx, cy)로 만든 삼각형 면적이 가장 큰 샘플의 위치를 반환합니다.
+static int K51_lttb_select(const K51_LTTB_t& l, float cx, float cy) {
+    int   raw   = l.cur ^ 1;
+    float x0    = (float)(l.bucket - 1) * l.factor;
+    int   best  = 0;
+    float bestA = -1.0f;
+    for (int k = 0; k < l.pending; k++) {
+        float x = x0 + k;
+        float a = fabsf((l.ax - cx) * ((float)g_K51_LttbRaw[raw][k][0] - l.ay) - (l.ax - x) * (cy - l.ay));
+        if (a > bestA) {
+            bestA = a;
+            best  = k;
+        }
+    }
+    return best;
+}
+
+// LTTB 샘플 추가 함수
+// 버킷이 차면 첫 버킷은 첫 샘플, 그 외에는 기다리던 이전 버킷의 점을 골라 기록하고 워드 수를 반환합니다.
+static inline int K51_lttb_add(K51_LTTB_t& l, int16_t s, int16_t v, volatile int16_t* buffer, int w) {
+    g_K51_LttbRaw[l.cur][l.n][0] = s;
+    g_K51_LttbRaw[l.cur][l.n][1] = v;
+    l.sum += s;
+    l.n++;
+    if (l.n < l.factor) {
+        return 0;
+    }
+    int words = 0;
+    if (l.bucket == 0) {
+        words     = K51_lttb_emit(l, l.cur, 0, 0, buffer, w);    // 첫 버킷은 첫 샘플
+        l.pending = 0;
+    } else {
+        if (l.pending > 0) {
+            float cx = (float)l.bucket * l.factor + (float)(l.n - 1) / 2.0f;
+            float cy = (float)l.sum / (float)l.n;
+            words    = K51_lttb_emit(l, l.cur ^ 1, l.bucket - 1, K51_lttb_select(l, cx, cy), buffer, w);
+        }
+        l.pending = l.n;    // 이 버킷은 다음 버킷이 끝나면 선택
+    }
+    l.cur ^= 1;
+    l.n   = 0;
+    l.sum = 0;
+    l.bucket++;
+    return words;
+}
+
+// LTTB 종료 함수
+// 기다리던 버킷과 채우던 (일부) 버킷의 레코드를 기록하고 워드 수를 반환합니다. 마지막 버킷은 마지막 샘플입니다.
+static int K51_lttb_flush(K51_LTTB_t& l, volatile int16_t* buffer, int w) {
+    int words = 0;
+    if (l.pending > 0) {
+        if (l.n > 0) {
+            float cx = (float)l.bucket * l.factor + (float)(l.n - 1) / 2.0f;
+            float cy = (float)l.sum / (float)l.n;
+            words += K51_lttb_emit(l, l.cur ^ 1, l.bucket - 1, K51_lttb_select(l, cx, cy), buffer, w);
+        } else {
+            words += K51_lttb_emit(l, l.cur ^ 1, l.bucket - 1, l.pending - 1, buffer, w);
+        }
+    }
+    if (l.n > 0) {
+        words += K51_lttb_emit(l, l.cur, l.bucket, (l.bucket == 0) ? 0 : l.n - 1, buffer, w + words);
+    }
+    return words;
+}
+
+// K51_INA226_capture_decimated: 데시메이션 캡처 함수
+void K51_INA226_capture_decimated(volatile MEASURE_t& measure, volatile int16_t* buffer) {
+    uint16_t    reg_bus, reg_shunt;
+    K48_STATS_t cs, bs;    // 줄이기 전 모든 샘플의 전류 및 버스 전압 통계
+    K48_INA226_stats_begin(cs, &g_K48_CurrentHist);
+    K48_INA226_stats_begin(bs, NULL);
+    K40_INA226_POWER_STATS_t ps;
+    K40_INA226_power_begin(ps);
+    int factor = measure.m.cv_meas.decimate;
+    factor     = (factor < G_K51_MIN_FACTOR) ? G_K51_MIN_FACTOR : ((factor > G_K51_MAX_FACTOR) ? G_K51_MAX_FACTOR : factor);
+    int mode   = (measure.m.cv_meas.decimMode == G_K51_MODE_LTTB) ? G_K51_MODE_LTTB : G_K51_MODE_ENVELOPE;
+    int recWords = (mode == G_K51_MODE_LTTB) ? G_K51_LTTB_WORDS : G_K51_ENV_WORDS;
+    if (measure.m.cv_meas.scale == G_K40_INA226_SCALE_AUTO) {
+        measure.m.cv_meas.scale = G_K40_INA226_SCALE_HI;    // 자동 범위 없음 : 전체 범위 스케일
+    }
+    int oversample       = measure.m.cv_meas.oversample > 1 ? measure.m.cv_meas.oversample : 1;
+    int samplesPerSecond = K40_INA226_samples_per_second(measure.m.cv_meas.periodUs);
+    int recsPerPacket    = samplesPerSecond / factor;    // 약 1초 분량의 레코드마다 패킷 전송
+    if (recsPerPacket < 1) {
+        recsPerPacket = 1;
+    }
+    // 헤더 + 레코드 + 패킷마다 마커 1워드가 버퍼에 들어가도록 제한 (레코드 수 = 버킷 수)
+    int     maxWords   = g_K40_MaxSamples * 2 - G_K51_HDR_WORDS - 1;
+    int     maxRecords = (int)(((int64_t)maxWords * recsPerPacket) / (recWords * recsPerPacket + 1));
+    int64_t maxSamples = (int64_t)maxRecords * factor;
+    if (measure.m.cv_meas.nSamples > maxSamples) {
+        ESP_LOGW(G_K51_TAG, "Capture limited to %d samples", (int)maxSamples);
+        measure.m.cv_meas.nSamples = (int)maxSamples;
+    }
+    K51_ENV_t  env;
+    K51_LTTB_t lttb;
+    K51_env_begin(env);
+    K51_lttb_begin(lttb, factor);
+
+    K50_INA226_switch_scale(measure.m.cv_meas.scale);
+    K41_INA226_drdy_begin();    // ALERT 핀 인터럽트 연결
+
+    K40_INA226_write_reg(G_K40_INA226_REG_MASK, G_K40_INA226_MASK_CNVR);
+    K40_INA226_write_reg(G_K40_INA226_REG_CFG, measure.m.cv_meas.cfg | 0x0007);
+    // 첫 번째 샘플 무시
+    K41_INA226_wait_drdy();
+    K40_INA226_read_shunt_bus(reg_shunt, reg_bus);
+
+    uint32_t tstart = micros();
+    buffer[0]       = G_K40_INA226_MSG_TX_START_DECIM;
+    buffer[1]       = K40_INA226_period_word(measure.m.cv_meas.periodUs);
+    buffer[2]       = measure.m.cv_meas.scale;
+    buffer[3]       = (int16_t)factor;
+    buffer[4]       = (int16_t)mode;
+    int  w           = G_K51_HDR_WORDS;    // 다음 레코드 위치
+    int  packetStart = 0;
+    int  records     = 0;
+    int  inx         = 0;
+    bool aborted     = false;
+    K40_INA226_reset_tx_end();
+
+    K41_INA226_pace_begin(measure.m.cv_meas.periodUs);
+    while ((inx < measure.m.cv_meas.nSamples) && !aborted) {
+        K41_INA226_pace_wait(inx);
+        K41_INA226_wait_drdy();
+        K40_INA226_read_oversampled(oversample, reg_shunt, reg_bus);
+        int16_t s = (int16_t)reg_shunt;
+        int16_t v = (int16_t)reg_bus;
+        K48_INA226_stats_add(cs, s);
+        K48_INA226_stats_add(bs, v);
+        K40_INA226_power_add(ps, s, v);
+
+        int words = (mode == G_K51_MODE_LTTB) ? K51_lttb_add(lttb, s, v, buffer, w) : K51_env_add(env, factor, s, v, buffer, w);
+        if (words > 0) {
+            w += words;
+            records++;
+            // 일정 레코드마다 패킷을 분할하여 전송 (마커는 레코드 뒤)
+            if ((records % recsPerPacket) == 0) {
+                aborted = K40_INA226_packet_split(buffer, w, packetStart, true);
+                w++;
+            }
+        }
+        inx++;
+    }
+    K41_INA226_pace_end(inx);
+
+    // 마지막 (일부) 버킷 기록 후 남은 레코드 전송과 종료 디스크립터 추가
+    int words = (mode == G_K51_MODE_LTTB) ? K51_lttb_flush(lttb, buffer, w) : K51_env_flush(env, buffer, w);
+    records += words / recWords;
+    w += words;
+    K40_INA226_packet_tail(w, packetStart);
+    K40_INA226_capture_finish(measure, inx, &ps, cs, &bs);
+
+    uint32_t us = micros() - tstart;
+    K41_INA226_drdy_end();
+    measure.m.cv_meas.nSamples   = inx;
+    measure.m.cv_meas.sampleRate = (1000000.0f * (float)inx) / (float)us;
+
+    ESP_LOGI(G_K51_TAG, "CV Decimated : %d samples -> %d %s records (%d words, %.1fx less) 0x%04X %s %.1fHz %.1fV %.3fmA\n", inx, records,
+             mode == G_K51_MODE_LTTB ? "LTTB" : "envelope", w, (w > 0) ? (2.0f * inx) / (float)w : 0.0f, measure.m.cv_meas.cfg,
+             measure.m.cv_meas.scale == G_K40_INA226_SCALE_LO ? "LO" : "HI", measure.m.cv_meas.sampleRate, measure.m.cv_meas.vavg,
+             measure.m.cv_meas.iavgma);
+}
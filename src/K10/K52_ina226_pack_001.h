@@ -0,0 +1,218 @@
+/*
+ * INA226 샘플 압축 저장
+ *
+ * 버퍼 캡처는 샘플 쌍마다 4바이트를 쓰므로 g_K40_MaxSamples = (K53 버퍼 바이트 - 8) / 4 가 캡처 길이를 제한합니다.
+ * 이 코덱은 션트/버스 채널을 블록 단위로 델타 + 지그재그 + 비트 패킹하여 버퍼에 기록하고, 전송도 압축된 블록 그대로 합니다.
+ * 천천히 변하는 버스 전압은 샘플당 1~2비트가 되므로 같은 버퍼로 게이트 캡처를 3~5배 길게 기록할 수 있습니다.
+ *
+ * 블록 형식 (int16 워드, 블록마다 독립적으로 복원 가능):
+ * - [MSG_TX_PACKED, n, widths, shunt0, bus0] + 션트 델타 + 버스 델타
+ *   n = 블록의 샘플 수 (1 ~ G_K52_BLOCK_SAMPLES), widths = 션트 비트 폭 | (버스 비트 폭 << 8)
+ *   델타 n - 1개를 지그재그((d << 1) ^ (d >> 31)) 후 채널 비트 폭(0 ~ 17)으로 LSB부터 16비트 워드에 채웁니다. (채널마다 워드 경계에서 시작)
+ * - 비트 폭이 0이면 (블록 안에서 값이 변하지 않음) 델타 워드가 없습니다.
+ *
+ * 블록 인덱스:
+ * - 버퍼 끝에서 아래로 블록마다 (블록 시작 워드, 첫 샘플 번호)를 int32 두 개로 기록합니다. (전송하지 않음)
+ * - K52_INA226_read_sample()은 인덱스를 이분 탐색하여 블록 하나만 복원합니다. (임의 접근)
+ *
+ * 주요 함수:
+ * 1. K52_INA226_pack_begin(K52_PACK_t& p, volatile int16_t* buffer, int w, int limitWords)
+ *    - buffer[w]부터 블록을 기록하고, limitWords 아래로 인덱스를 기록합니다.
+ * 2. K52_INA226_pack_add(K52_PACK_t& p, int16_t shunt, int16_t bus)
+ *    - 샘플을 현재 블록에 추가하고, 블록이 차면 압축하여 기록합니다. (블록을 기록하면 true)
+ * 3. K52_INA226_pack_flush(K52_PACK_t& p)
+ *    - 채우던 블록을 (일부라도) 기록합니다. 범위 전환, 캡처 종료 시 호출합니다.
+ * 4. K52_INA226_pack_room(const K52_PACK_t& p)
+ *    - 최악의 경우 블록 하나와 범위 전환 헤더, 인덱스 항목이 들어갈 공간이 있는지 확인합니다.
+ * 5. K52_INA226_read_sample(const K52_PACK_t& p, int n, int16_t& shunt, int16_t& bus)
+ *    - 기록한 n번째 샘플을 복원합니다.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#define         G_K52_TAG    "K52_pack"
+
+#define G_K52_MSG_TX_PACKED             2227    // 압축 블록 [2227, n, widths, shunt0, bus0] + 델타
+#define G_K52_BLOCK_SAMPLES             128     // 블록당 최대 샘플 수
+#define G_K52_HDR_WORDS                 5       // 블록 헤더 워드 수
+#define G_K52_MAX_WIDTH                 17      // 16비트 값 델타의 지그재그 최대 비트 폭
+#define G_K52_INDEX_WORDS               4       // 블록 인덱스 항목 워드 수 (int32 x 2)
+// 최악의 블록 워드 수 (모든 델타가 17비트)
+#define G_K52_MAX_BLOCK_WORDS           (G_K52_HDR_WORDS + 2 * (((G_K52_BLOCK_SAMPLES - 1) * G_K52_MAX_WIDTH + 15) / 16))
+
+// K52_PACK_t 구조체 정의
+typedef struct {
+    volatile int16_t* buffer;
+    int     w;             // 다음 블록을 기록할 워드
+    int     limitWords;    // 인덱스 시작 (인덱스는 이 위치 아래로)
+    int     nBlocks;       // 기록한 블록 수
+    int     nSamples;      // 블록에 기록한 샘플 수 (채우는 블록 제외)
+    int     n;             // 채우는 블록의 샘플 수
+    int16_t shunt[G_K52_BLOCK_SAMPLES];    // 채우는 블록의 원시 샘플
+    int16_t bus[G_K52_BLOCK_SAMPLES];
+} K52_PACK_t;
+
+K52_PACK_t g_K52_Pack;    // 캡처 태스크의 압축 상태 (채우는 블록이 커서 스택 대신 전역)
+
+// 함수 선언
+void K52_INA226_pack_begin(K52_PACK_t& p, volatile int16_t* buffer, int w, int limitWords);
+bool K52_INA226_pack_add(K52_PACK_t& p, int16_t shunt, int16_t bus);
+void K52_INA226_pack_flush(K52_PACK_t& p);
+bool K52_INA226_pack_room(const K52_PACK_t& p);
+bool K52_INA226_read_sample(const K52_PACK_t& p, int n, int16_t& shunt, int16_t& bus);
+
+// 지그재그 변환 (작은 음수/양수를 작은 부호 없는 값으로)
+static inline uint32_t K52_zigzag(int32_t d) {
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+static inline int32_t K52_unzigzag(uint32_t z) {
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+// 채널 델타의 비트 폭 (0 ~ 17)
+static int K52_width(const int16_t* x, int n) {
+    uint32_t all = 0;
+    for (int k = 1; k < n; k++) {
+        all |= K52_zigzag((int32_t)x[k] - x[k - 1]);
+    }
+    return (all == 0) ? 0 : 32 - __builtin_clz(all);
+}
+
+// 채널 델타 패킹 함수 (기록한 워드 수 반환)
+static int K52_pack_channel(volatile int16_t* out, const int16_t* x, int n, int width) {
+    if (width == 0) {
+        return 0;
+    }
+    uint64_t acc   = 0;
+    int      bits  = 0;
+    int      words = 0;
+    for (int k = 1; k < n; k++) {
+        acc |= (uint64_t)K52_zigzag((int32_t)x[k] - x[k - 1]) << bits;
+        bits += width;
+        while (bits >= 16) {
+            out[words++] = (int16_t)(acc & 0xFFFF);
+            acc >>= 16;
+            bits -= 16;
+        }
+    }
+    if (bits > 0) {
+        out[words++] = (int16_t)(acc & 0xFFFF);
+    }
+    return words;
+}
+
+// 채널 델타 복원 함수 (읽은 워드 수 반환)
+// x[0]에 첫 값이 있어야 하며, x[1 .. n - 1]을 채웁니다.
+static int K52_unpack_channel(const volatile int16_t* in, int16_t* x, int n, int width) {
+    if (width == 0) {
+        for (int k = 1; k < n; k++) {
+            x[k] = x[0];
+        }
+        return 0;
+    }
+    uint64_t acc   = 0;
+    int      bits  = 0;
+    int      words = 0;
+    uint32_t mask  = (1u << width) - 1;
+    for (int k = 1; k < n; k++) {
+        while (bits < width) {
+            acc |= (uint64_t)(uint16_t)in[words++] << bits;
+            bits += 16;
+        }
+        x[k] = (int16_t)(x[k - 1] + K52_unzigzag((uint32_t)acc & mask));
+        acc >>= width;
+        bits -= width;
+    }
+    return words;
+}
+
+// 압축 시작 함수
+void K52_INA226_pack_begin(K52_PACK_t& p, volatile int16_t* buffer, int w, int limitWords) {
+    p.buffer     = buffer;
+    p.w          = w;
+    p.limitWords = limitWords;
+    p.nBlocks    = 0;
+    p.nSamples   = 0;
+    p.n          = 0;
+}
+
+// 채우던 블록 기록 함수
+void K52_INA226_pack_flush(K52_PACK_t& p) {
+    if (p.n == 0) {
+        return;
+    }
+    volatile int16_t* b  = p.buffer + p.w;
+    int               ws = K52_width(p.shunt, p.n);
+    int               wv = K52_width(p.bus, p.n);
+    b[0]                 = G_K52_MSG_TX_PACKED;
+    b[1]                 = (int16_t)p.n;
+    b[2]                 = (int16_t)(ws | (wv << 8));
+    b[3]                 = p.shunt[0];
+    b[4]                 = p.bus[0];
+    int words            = G_K52_HDR_WORDS;
+    words += K52_pack_channel(b + words, p.shunt, p.n, ws);
+    words += K52_pack_channel(b + words, p.bus, p.n, wv);
+
+    // 인덱스 항목 (버퍼 끝에서 아래로)
+    int32_t entry[2] = {p.w, p.nSamples};
+    memcpy((void*)(p.buffer + p.limitWords - G_K52_INDEX_WORDS * (p.nBlocks + 1)), entry, sizeof(entry));
+    p.nBlocks++;
+    p.nSamples += p.n;
+    p.w += words;
+    p.n = 0;
+}
+
+// 샘플 추가 함수
+bool K52_INA226_pack_add(K52_PACK_t& p, int16_t shunt, int16_t bus) {
+    p.shunt[p.n] = shunt;
+    p.bus[p.n]   = bus;
+    p.n++;
+    if (p.n < G_K52_BLOCK_SAMPLES) {
+        return false;
+    }
+    K52_INA226_pack_flush(p);
+    return true;
+}
+
+// 남은 공간 확인 함수
+// 다음 블록(최악), 범위 전환 헤더 3워드, 패킷 마커, 인덱스 항목 하나가 들어가는지 확인합니다.
+bool K52_INA226_pack_room(const K52_PACK_t& p) {
+    int indexBottom = p.limitWords - G_K52_INDEX_WORDS * (p.nBlocks + 1);
+    return p.w + G_K52_MAX_BLOCK_WORDS + 4 <= indexBottom;
+}
+
+// 샘플 임의 접근 함수
+// 블록 인덱스에서 n번째 샘플이 든 블록을 찾아 그 블록만 복원합니다. (블록에 기록하지 않은 샘플이면 false)
+bool K52_INA226_read_sample(const K52_PACK_t& p, int n, int16_t& shunt, int16_t& bus) {
+    if ((n < 0) || (n >= p.nSamples)) {
+        return false;
+    }
+    int lo = 0, hi = p.nBlocks - 1;
+    int32_t entry[2];
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        memcpy(entry, (const void*)(p.buffer + p.limitWords - G_K52_INDEX_WORDS * (mid + 1)), sizeof(entry));
+        if (entry[1] <= n) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    memcpy(entry, (const void*)(p.buffer + p.limitWords - G_K52_INDEX_WORDS * (lo + 1)), sizeof(entry));
+    const volatile int16_t* b = p.buffer + entry[0];
+    int     cnt = b[1];
+    int     ws  = b[2] & 0xFF;
+    int     wv  = (b[2] >> 8) & 0xFF;
+    int16_t s[G_K52_BLOCK_SAMPLES], v[G_K52_BLOCK_SAMPLES];
+    s[0]      = b[3];
+    v[0]      = b[4];
+    int words = G_K52_HDR_WORDS;
+    words += K52_unpack_channel(b + words, s, cnt, ws);
+    K52_unpack_channel(b + words, v, cnt, wv);
+    shunt = s[n - entry[1]];
+    bus   = v[n - entry[1]];
+    return true;
+}
@@ -0,0 +1,206 @@
+/*
+ * 캡처 버퍼 메모리 관리
+ *
+ * 예전에는 부팅 시 heap_caps_get_largest_free_block()을 모두 샘플 버퍼로 할당하여, 웹소켓 전송 복사본(binary()),
+ * AsyncTCP, ArduinoJson, LittleFS가 남은 조각을 나눠 쓰다가 부하가 걸리면 웹소켓 전송이 실패했습니다.
+ * 이 모듈은 샘플 버퍼를 고정 크기 블록의 풀로 할당하고, 네트워크 스택이 쓸 힙을 항상 남겨 둡니다.
+ *
+ * 할당 규칙:
+ * - 블록 수 = min(가장 큰 빈 블록, 전체 빈 힙 - 예비 공간, 예산) / G_K53_BLOCK_BYTES
+ * - 예비 공간(G_K53_NET_RESERVE_BYTES)은 할당 후에도 힙에 남아야 하는 크기입니다. (빌드 플래그로 변경 가능)
+ * - 예산은 K50 NVS("capmem")에 KB 단위로 저장하며, 0이면 예비 공간을 뺀 전체를 씁니다.
+ * - 모든 캡처가 버퍼를 선형으로 색인하므로 블록들은 한 번의 할당으로 연속 배치합니다.
+ *   블록은 할당 단위와 사용량 집계 단위이며, g_K40_MaxSamples는 블록 수에서 계산합니다.
+ * - 스트리밍 링(16 x 1003워드)이 들어가도록 최소 G_K53_MIN_BLOCKS 블록을 할당합니다.
+ *   힙이 부족해 최소 블록이 예비 공간을 침범하면 MSG_MEM 상태를 G_K53_STATUS_RESERVE로 알립니다.
+ * - 최소 블록보다 작은 예산(0 제외)은 저장하지 않고 G_K53_STATUS_REJECTED로 응답합니다.
+ *
+ * 사용량 집계:
+ * - K40_INA226_push_block()이 전송하는 마지막 워드를 기록하여 캡처마다 사용한 블록 수와 최대값을 구합니다.
+ * - 힙 지표 : 빈 힙, 가장 큰 빈 블록, 부팅 후 최소 빈 힙, 단편화 = 1 - 가장 큰 빈 블록 / 빈 힙
+ *
+ * 예산 변경 (cv_mem 명령):
+ * - 새 예산을 NVS에 저장하고 재할당을 요청합니다. 캡처 태스크가 캡처 사이에 전송 큐가 비었을 때 버퍼를 다시 할당합니다.
+ *
+ * 주요 함수:
+ * 1. K53_MEM_begin()
+ *    - NVS 예산을 불러와 샘플 버퍼를 할당합니다. (g_K10_Buffer, g_K40_MaxSamples 설정)
+ * 2. K53_MEM_resize()
+ *    - 재할당 요청이 있으면 버퍼를 새 예산으로 다시 할당합니다. (캡처 태스크, 캡처 사이, 실패하면 이전 블록 수)
+ * 3. K53_MEM_capture_begin() / K53_MEM_touch(uint32_t endWord) / K53_MEM_capture_end()
+ *    - 캡처별 블록 사용량 집계
+ * 4. K53_MEM_info(K53_MEM_INFO_t& info, int status)
+ *    - 블록 사용량과 힙 지표를 응답 프레임(MSG_MEM)으로 만듭니다.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#include "K00_config_002.h"
+#include "K50_nv_data_002.h"
+
+#define         G_K53_TAG    "K53_mem"
+
+#define G_K53_BLOCK_BYTES           4096     // 샘플 블록 크기
+#define G_K53_MIN_BLOCKS            8        // 최소 블록 수 (스트리밍 링 32096바이트)
+#ifndef G_K53_NET_RESERVE_BYTES
+#define G_K53_NET_RESERVE_BYTES     (64 * 1024)    // 네트워크 스택(AsyncTCP, 웹소켓 전송 복사본, ArduinoJson, LittleFS) 예비 힙
+#endif
+
+#define G_K53_MSG_MEM               9999     // 메모리 응답 메시지 (int32 구조체)
+#define G_K53_STATUS_OK             0
+#define G_K53_STATUS_PENDING        1        // 새 예산 저장, 다음 캡처 사이에 재할당
+#define G_K53_STATUS_RESERVE        2        // 최소 블록 할당으로 빈 힙이 예비 공간보다 작음
+#define G_K53_STATUS_REJECTED       3        // 예산이 최소 블록보다 작아 저장하지 않음
+#define G_K53_MIN_BUDGET_KB         (G_K53_MIN_BLOCKS * G_K53_BLOCK_BYTES / 1024)
+
+// K53_MEM_INFO_t 구조체 정의 (MSG_MEM 응답, int32 필드)
+typedef struct {
+    int32_t msg;             // G_K53_MSG_MEM
+    int32_t status;          // G_K53_STATUS_xxx
+    int32_t blockBytes;      // 블록 크기
+    int32_t nBlocks;         // 할당한 블록 수
+    int32_t budgetKB;        // 저장된 예산 (0 : 예비 공간을 뺀 전체)
+    int32_t reserveBytes;    // 네트워크 예비 힙
+    int32_t lastBlocks;      // 마지막 캡처가 사용한 블록 수
+    int32_t peakBlocks;      // 부팅 후 캡처가 사용한 최대 블록 수
+    int32_t maxSamples;      // g_K40_MaxSamples
+    int32_t freeBytes;       // 빈 힙
+    int32_t largestBytes;    // 가장 큰 빈 블록
+    int32_t minFreeBytes;    // 부팅 후 최소 빈 힙
+    int32_t fragPct;         // 단편화 (%)
+} K53_MEM_INFO_t;
+
+// 전역 변수
+extern int           g_K40_MaxSamples;
+uint32_t             g_K53_BudgetKB     = 0;        // 예산 (KB, 0 : 전체)
+int                  g_K53_Blocks       = 0;        // 할당한 블록 수
+volatile bool        g_K53_ResizeFlag   = false;    // 재할당 요청 (cv_mem)
+static uint32_t      g_K53_EndWord      = 0;        // 현재 캡처가 전송한 마지막 워드
+static int           g_K53_LastBlocks   = 0;
+static int           g_K53_PeakBlocks   = 0;
+static bool          g_K53_ReserveShort = false;    // 빈 힙 < 예비 공간 (MSG_MEM 상태로 보고)
+
+// 함수 선언
+bool K53_MEM_begin();
+void K53_MEM_resize();
+bool K53_MEM_budget_valid(uint32_t budgetKB);
+void K53_MEM_capture_begin();
+void K53_MEM_capture_end();
+void K53_MEM_info(K53_MEM_INFO_t& info, int status);
+
+// 전송 블록 기록 (K40_INA226_push_block에서 호출)
+static inline void K53_MEM_touch(uint32_t endWord) {
+    if (endWord > g_K53_EndWord) {
+        g_K53_EndWord = endWord;
+    }
+}
+
+// 할당할 블록 수 계산
+static int K53_MEM_blocks() {
+    int32_t freeBytes = (int32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    int32_t avail     = (int32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (avail > freeBytes - G_K53_NET_RESERVE_BYTES) {
+        avail = freeBytes - G_K53_NET_RESERVE_BYTES;
+    }
+    if ((g_K53_BudgetKB > 0) && (avail > (int32_t)(g_K53_BudgetKB * 1024))) {
+        avail = (int32_t)(g_K53_BudgetKB * 1024);
+    }
+    int blocks = avail / G_K53_BLOCK_BYTES;
+    return (blocks < G_K53_MIN_BLOCKS) ? G_K53_MIN_BLOCKS : blocks;
+}
+
+// 블록 수만큼 버퍼 할당 (실패하면 블록 수를 줄여 다시 시도)
+static bool K53_MEM_alloc(int blocks) {
+    for (; blocks >= G_K53_MIN_BLOCKS; blocks--) {
+        g_K10_Buffer = (int16_t*)heap_caps_malloc((size_t)blocks * G_K53_BLOCK_BYTES, MALLOC_CAP_8BIT);
+        if (g_K10_Buffer != NULL) {
+            break;
+        }
+    }
+    if (g_K10_Buffer == NULL) {
+        g_K53_Blocks     = 0;
+        g_K40_MaxSamples = 0;
+        return false;
+    }
+    g_K53_Blocks     = blocks;
+    g_K40_MaxSamples = (blocks * G_K53_BLOCK_BYTES - 8) / 4;    // 샘플 쌍 4바이트, 헤더 공간 8바이트
+    ESP_LOGI(G_K53_TAG, "Sample buffer %d x %d bytes (budget %uKB), Max Samples = %d, heap free %u, largest %u", blocks, G_K53_BLOCK_BYTES,
+             g_K53_BudgetKB, g_K40_MaxSamples, heap_caps_get_free_size(MALLOC_CAP_8BIT), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    g_K53_ReserveShort = (heap_caps_get_free_size(MALLOC_CAP_8BIT) < G_K53_NET_RESERVE_BYTES);
+    if (g_K53_ReserveShort) {
+        ESP_LOGW(G_K53_TAG, "Heap below network reserve (%d bytes) with the minimum sample buffer", G_K53_NET_RESERVE_BYTES);
+    }
+    return true;
+}
+
+// 부팅 시 버퍼 할당
+bool K53_MEM_begin() {
+    g_K53_BudgetKB = K50_NV_mem_budget_load();
+    return K53_MEM_alloc(K53_MEM_blocks());
+}
+
+// 재할당 (요청이 있고 전송 태스크가 버퍼를 읽고 있지 않을 때 캡처 태스크가 호출)
+// 새 크기로 할당하지 못하면 이전 블록 수로 되돌리고, 그것도 안 되면 부팅 시 할당 실패와 같이 멈춥니다. (NULL 버퍼로 캡처하지 않음)
+void K53_MEM_resize() {
+    if (!g_K53_ResizeFlag) {
+        return;
+    }
+    g_K53_ResizeFlag = false;
+    int prevBlocks   = g_K53_Blocks;
+    heap_caps_free((void*)g_K10_Buffer);
+    g_K10_Buffer = NULL;
+    if (!K53_MEM_alloc(K53_MEM_blocks()) && !K53_MEM_alloc(prevBlocks)) {
+        ESP_LOGE(G_K53_TAG, "Could not reallocate sample buffer (%d blocks before)", prevBlocks);
+        ESP_LOGE(G_K53_TAG, "Halting...");
+        while (1) {
+            vTaskDelay(1);    // 메모리 할당 실패 시 무한 대기
+        }
+    }
+    g_K53_PeakBlocks = 0;
+}
+
+// 예산 확인 (0 : 전체, 그 외에는 최소 블록 이상)
+bool K53_MEM_budget_valid(uint32_t budgetKB) {
+    return (budgetKB == 0) || (budgetKB >= G_K53_MIN_BUDGET_KB);
+}
+
+// 캡처별 사용량 집계 시작
+void K53_MEM_capture_begin() {
+    g_K53_EndWord = 0;
+}
+
+// 캡처별 사용량 집계 종료
+void K53_MEM_capture_end() {
+    g_K53_LastBlocks = (int)((g_K53_EndWord * sizeof(int16_t) + G_K53_BLOCK_BYTES - 1) / G_K53_BLOCK_BYTES);
+    if (g_K53_LastBlocks > g_K53_PeakBlocks) {
+        g_K53_PeakBlocks = g_K53_LastBlocks;
+    }
+    uint32_t freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    ESP_LOGI(G_K53_TAG, "Capture used %d / %d blocks, heap free %u, largest %u", g_K53_LastBlocks, g_K53_Blocks, freeBytes,
+             heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    g_K53_ReserveShort = (freeBytes < G_K53_NET_RESERVE_BYTES);
+    if (g_K53_ReserveShort) {
+        ESP_LOGW(G_K53_TAG, "Heap free %u below network reserve %d", freeBytes, G_K53_NET_RESERVE_BYTES);
+    }
+}
+
+// 응답 프레임 작성 (다른 상태가 없으면 예비 공간 침범을 상태로 보고)
+void K53_MEM_info(K53_MEM_INFO_t& info, int status) {
+    memset(&info, 0, sizeof(info));
+    info.msg          = G_K53_MSG_MEM;
+    info.status       = ((status == G_K53_STATUS_OK) && g_K53_ReserveShort) ? G_K53_STATUS_RESERVE : status;
+    info.blockBytes   = G_K53_BLOCK_BYTES;
+    info.nBlocks      = g_K53_Blocks;
+    info.budgetKB     = (int32_t)g_K53_BudgetKB;
+    info.reserveBytes = G_K53_NET_RESERVE_BYTES;
+    info.lastBlocks   = g_K53_LastBlocks;
+    info.peakBlocks   = g_K53_PeakBlocks;
+    info.maxSamples   = g_K40_MaxSamples;
+    info.freeBytes    = (int32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    info.largestBytes = (int32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    info.minFreeBytes = (int32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    info.fragPct      = (info.freeBytes > 0) ? (int32_t)(100 - ((int64_t)info.largestBytes * 100) / info.freeBytes) : 0;
+}
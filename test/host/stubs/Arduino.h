@@ -0,0 +1,53 @@
+/*
+ * 호스트 테스트용 Arduino / FreeRTOS / ESP-IDF 스텁
+ *
+ * src/K10의 헤더 모듈을 g++로 빌드하기 위한 최소 선언입니다.
+ * 핀, 시간, 태스크 알림, 타이머 함수는 선언만 하고 각 테스트가 시뮬레이션으로 정의합니다. (사용하지 않는 테스트는 정의하지 않아도 됨)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#define IRAM_ATTR
+
+#define LOW                     0
+#define HIGH                    1
+#define RISING                  1
+#define FALLING                 2
+#define CHANGE                  3
+
+typedef void*    TaskHandle_t;
+typedef int      BaseType_t;
+typedef uint32_t TickType_t;
+typedef struct hw_timer_s hw_timer_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))    // 1 tick = 1ms
+#define portYIELD_FROM_ISR()
+
+#define digitalPinToInterrupt(p)    (p)
+
+#define ESP_LOGE(tag, fmt, ...)     fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...)     fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...)     fprintf(stderr, "I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...)     do { } while (0)
+
+// 테스트가 정의하는 함수
+int          digitalRead(uint8_t pin);
+uint32_t     millis();
+int64_t      esp_timer_get_time();
+void         attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void         detachInterrupt(uint8_t pin);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+uint32_t     ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+void         vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
+hw_timer_t*  timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void         timerAttachInterrupt(hw_timer_t* timer, void (*isr)(), bool edge);
+void         timerAlarmDisable(hw_timer_t* timer);
+void         timerAlarmEnable(hw_timer_t* timer);
+void         timerWrite(hw_timer_t* timer, uint64_t value);
+void         timerAlarmWrite(hw_timer_t* timer, uint64_t value, bool autoreload);
@@ -0,0 +1,288 @@
+/*
+ * K41 ALERT ISR → 태스크 알림 경로 시뮬레이션 테스트
+ *
+ * INA226 연속 변환을 시뮬레이션 시각(us)으로 모델링합니다.
+ * - 변환이 끝나면 ALERT가 LOW가 되고 (하강 에지이면 연결된 ISR 호출), 결과를 읽으면 HIGH로 돌아갑니다.
+ * - ulTaskNotifyTake()는 알림이 없으면 알림 또는 제한 시간까지 시뮬레이션 시각을 진행합니다. (태스크 블록)
+ * - digitalRead()는 호출마다 1us가 걸리는 것으로 봅니다. (폴링 루프 한 바퀴)
+ *
+ * 확인 항목:
+ * 1. 변환 사이에 태스크가 블록됨 (샘플당 핀 읽기 2회, 블록 1회, 폴링은 변환 시간만큼 핀 읽기)
+ * 2. 핀 레벨 확인과 블록 사이에 온 알림을 잃지 않음
+ * 3. ISR 알림을 놓쳐도 G_K41_DRDY_RECHECK_MS 후 핀 레벨을 다시 확인하여 진행
+ * 4. ALERT가 오지 않으면 G_K41_DRDY_TIMEOUT_MS 후 false, 대기 중 블록
+ * 5. 폴링 경로와 같은 샘플 값, 같은 시각에 반환
+ */
+
+#include <Arduino.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "K41_ina226_sched_001.h"
+
+// INA226 / 태스크 시뮬레이션 상태
+static struct {
+    int64_t  us;            // 현재 시각
+    bool     running;       // 연속 변환 중
+    int64_t  convUs;        // 변환 주기
+    int64_t  nextConvUs;    // 다음 변환 완료 시각
+    int      alert;         // ALERT 핀 레벨
+    int16_t  latest;        // 마지막 변환 결과
+    int16_t  seq;           // 다음 변환 결과
+    void (*isr)();          // 연결된 ALERT ISR
+    uint32_t notify;        // 태스크 알림 값
+    int      dropEdges;     // ISR을 부르지 않을 하강 에지 수 (알림 손실 모델)
+    bool     raceArm;       // 다음 HIGH 읽기 직후 변환 완료 (확인과 블록 사이의 에지)
+    uint32_t pinReads;      // ALERT 핀 읽기 수
+    uint32_t blocks;        // ulTaskNotifyTake 호출 수
+} g_Sim;
+
+static int g_Failures = 0;
+
+#define CHECK(cond, ...)                                                 \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            fprintf(stderr, "FAIL %s:%d : %s : ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                \
+            fprintf(stderr, "\n");                                       \
+            g_Failures++;                                                \
+        }                                                                \
+    } while (0)
+
+// 변환 완료 : ALERT LOW, HIGH → LOW이면 ISR
+static void sim_complete() {
+    g_Sim.latest = g_Sim.seq;
+    g_Sim.seq    = (int16_t)(g_Sim.seq * 7 + 13);    // 샘플마다 다른 값
+    if (g_Sim.alert == HIGH) {
+        g_Sim.alert = LOW;
+        if (g_Sim.dropEdges > 0) {
+            g_Sim.dropEdges--;
+        } else if (g_Sim.isr != NULL) {
+            g_Sim.isr();
+        }
+    }
+}
+
+// t까지 시각 진행 (그 사이의 변환 완료 처리)
+static void sim_advance_to(int64_t t) {
+    while (g_Sim.running && (g_Sim.nextConvUs <= t)) {
+        g_Sim.us = g_Sim.nextConvUs;
+        sim_complete();
+        g_Sim.nextConvUs += g_Sim.convUs;
+    }
+    g_Sim.us = t;
+}
+
+// 결과 읽기 (ALERT 해제)
+static int16_t sim_read() {
+    g_Sim.alert = HIGH;
+    return g_Sim.latest;
+}
+
+static void sim_reset(int64_t convUs) {
+    memset(&g_Sim, 0, sizeof(g_Sim));
+    g_Sim.running    = true;
+    g_Sim.convUs     = convUs;
+    g_Sim.nextConvUs = convUs;
+    g_Sim.alert      = HIGH;
+    g_Sim.seq        = 1;
+}
+
+// 스텁 구현
+int digitalRead(uint8_t pin) {
+    if (pin != g_K00_PIN_INA226_ALERT) {
+        return HIGH;
+    }
+    g_Sim.pinReads++;
+    sim_advance_to(g_Sim.us + 1);
+    int level = g_Sim.alert;
+    if (g_Sim.raceArm && (level == HIGH)) {
+        // 태스크가 HIGH를 본 직후, 블록하기 전에 변환 완료
+        g_Sim.raceArm    = false;
+        g_Sim.nextConvUs = g_Sim.us;
+        sim_advance_to(g_Sim.us);
+    }
+    return level;
+}
+
+uint32_t millis() {
+    return (uint32_t)(g_Sim.us / 1000);
+}
+
+int64_t esp_timer_get_time() {
+    return g_Sim.us;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    (void)mode;
+    if (pin == g_K00_PIN_INA226_ALERT) {
+        g_Sim.isr = isr;
+    }
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin == g_K00_PIN_INA226_ALERT) {
+        g_Sim.isr = NULL;
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return (TaskHandle_t)&g_Sim;
+}
+
+// 알림이 있으면 바로 반환, 없으면 알림 또는 제한 시간까지 블록
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    g_Sim.blocks++;
+    int64_t deadline = g_Sim.us + (int64_t)ticksToWait * 1000;
+    while ((g_Sim.notify == 0) && (g_Sim.us < deadline)) {
+        int64_t next = (g_Sim.running && (g_Sim.nextConvUs < deadline)) ? g_Sim.nextConvUs : deadline;
+        sim_advance_to(next);
+    }
+    uint32_t v   = g_Sim.notify;
+    g_Sim.notify = (clearOnExit || (v == 0)) ? 0 : v - 1;
+    return v;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    (void)task;
+    g_Sim.notify++;
+    *woken = pdTRUE;
+}
+
+hw_timer_t* timerBegin(uint8_t, uint16_t, bool) { return NULL; }
+void        timerAttachInterrupt(hw_timer_t*, void (*)(), bool) {}
+void        timerAlarmDisable(hw_timer_t*) {}
+void        timerAlarmEnable(hw_timer_t*) {}
+void        timerWrite(hw_timer_t*, uint64_t) {}
+void        timerAlarmWrite(hw_timer_t*, uint64_t, bool) {}
+
+typedef struct {
+    std::vector<int16_t> values;
+    std::vector<int64_t> returnUs;
+    uint32_t             pinReads;
+    uint32_t             blocks;
+} RUN_t;
+
+// 기존 폴링 경로 : while (digitalRead(ALERT) == HIGH);
+static RUN_t run_polling(int n, int64_t convUs) {
+    RUN_t r;
+    sim_reset(convUs);
+    for (int k = 0; k < n; k++) {
+        while (digitalRead(g_K00_PIN_INA226_ALERT) == HIGH) {
+        }
+        r.returnUs.push_back(g_Sim.us);
+        r.values.push_back(sim_read());
+    }
+    r.pinReads = g_Sim.pinReads;
+    r.blocks   = g_Sim.blocks;
+    return r;
+}
+
+// 알림 경로 : K41_INA226_wait_drdy()
+static RUN_t run_notify(int n, int64_t convUs) {
+    RUN_t r;
+    sim_reset(convUs);
+    K41_INA226_drdy_begin();
+    for (int k = 0; k < n; k++) {
+        bool ok = K41_INA226_wait_drdy();
+        CHECK(ok, "sample %d", k);
+        r.returnUs.push_back(g_Sim.us);
+        r.values.push_back(sim_read());
+    }
+    K41_INA226_drdy_end();
+    r.pinReads = g_Sim.pinReads;
+    r.blocks   = g_Sim.blocks - 1;    // drdy_begin()의 남은 알림 제거 호출 제외
+    return r;
+}
+
+// 1, 5. 블록 동작과 폴링 경로와의 일치
+static void test_blocks_and_matches_polling() {
+    const int     n      = 1000;
+    const int64_t convUs = 1100;
+    RUN_t         poll   = run_polling(n, convUs);
+    RUN_t         notif  = run_notify(n, convUs);
+
+    printf("%d samples, conversion %lldus\n", n, (long long)convUs);
+    printf("  polling : %u pin reads (%.1f per sample), %u blocks\n", poll.pinReads, (double)poll.pinReads / n, poll.blocks);
+    printf("  notify  : %u pin reads (%.1f per sample), %u blocks, %u ISR\n", notif.pinReads, (double)notif.pinReads / n, notif.blocks,
+           g_K41_DrdyIsrCount);
+
+    CHECK(notif.pinReads <= 2u * n, "notify path read the pin %u times", notif.pinReads);
+    CHECK(notif.blocks == (uint32_t)n, "notify path blocked %u times for %d samples", notif.blocks, n);
+    CHECK(poll.pinReads >= (uint32_t)(n * (convUs - 10)), "polling path read the pin %u times", poll.pinReads);
+    CHECK(poll.values == notif.values, "sample values differ");
+    for (int k = 0; k < n; k++) {
+        int64_t d = notif.returnUs[k] - poll.returnUs[k];
+        if ((d < -1) || (d > 1)) {
+            CHECK(false, "sample %d returned at %lldus, polling %lldus", k, (long long)notif.returnUs[k], (long long)poll.returnUs[k]);
+            break;
+        }
+    }
+}
+
+// 2. 핀 확인 후 블록 전에 온 알림
+static void test_edge_before_block() {
+    sim_reset(1100);
+    K41_INA226_drdy_begin();
+    g_Sim.raceArm = true;
+    uint32_t blocks0 = g_Sim.blocks;
+    int64_t  t0      = g_Sim.us;
+    bool     ok      = K41_INA226_wait_drdy();
+    int64_t  waited  = g_Sim.us - t0;
+    K41_INA226_drdy_end();
+    printf("edge between pin check and block : returned after %lldus, %u blocks\n", (long long)waited, g_Sim.blocks - blocks0);
+    CHECK(ok, "wait failed");
+    CHECK(waited < 10, "waited %lldus, notification was lost", (long long)waited);
+    CHECK(g_Sim.blocks - blocks0 == 1, "blocked %u times", g_Sim.blocks - blocks0);
+}
+
+// 3. ISR 알림 손실 : 재확인 주기 후 진행
+static void test_lost_notification_recheck() {
+    sim_reset(1100);
+    K41_INA226_drdy_begin();
+    g_Sim.dropEdges  = 1;
+    uint32_t blocks0 = g_Sim.blocks;
+    int64_t  t0      = g_Sim.us;
+    bool     ok      = K41_INA226_wait_drdy();
+    int64_t  waited  = g_Sim.us - t0;
+    K41_INA226_drdy_end();
+    printf("lost ISR notification : returned after %lldus, %u blocks\n", (long long)waited, g_Sim.blocks - blocks0);
+    CHECK(ok, "wait failed");
+    CHECK((waited >= G_K41_DRDY_RECHECK_MS * 1000) && (waited <= G_K41_DRDY_RECHECK_MS * 1000 + 10), "waited %lldus", (long long)waited);
+    CHECK(g_Sim.blocks - blocks0 == 1, "blocked %u times", g_Sim.blocks - blocks0);
+}
+
+// 4. ALERT가 오지 않음 : 타임아웃, 대기 중에도 블록
+static void test_timeout() {
+    sim_reset(1100);
+    g_Sim.running      = false;
+    K41_INA226_drdy_begin();
+    uint32_t timeouts0 = g_K41_DrdyTimeouts;
+    uint32_t blocks0   = g_Sim.blocks;
+    int64_t  t0        = g_Sim.us;
+    bool     ok        = K41_INA226_wait_drdy();
+    int64_t  waited    = g_Sim.us - t0;
+    K41_INA226_drdy_end();
+    uint32_t blocks    = g_Sim.blocks - blocks0;
+    printf("no ALERT : timed out after %lldus, %u blocks, %u pin reads\n", (long long)waited, blocks, g_Sim.pinReads);
+    CHECK(!ok, "wait succeeded without a conversion");
+    CHECK(g_K41_DrdyTimeouts == timeouts0 + 1, "timeouts %u", g_K41_DrdyTimeouts);
+    CHECK((waited >= G_K41_DRDY_TIMEOUT_MS * 1000) && (waited < (G_K41_DRDY_TIMEOUT_MS + 2 * G_K41_DRDY_RECHECK_MS) * 1000),
+          "waited %lldus", (long long)waited);
+    CHECK(blocks <= G_K41_DRDY_TIMEOUT_MS / G_K41_DRDY_RECHECK_MS + 1, "blocked %u times", blocks);
+    CHECK(g_Sim.pinReads <= blocks + 1, "spun on the pin %u times", g_Sim.pinReads);
+}
+
+int main() {
+    test_blocks_and_matches_polling();
+    test_edge_before_block();
+    test_lost_notification_recheck();
+    test_timeout();
+    if (g_Failures != 0) {
+        printf("test_k41_sched : %d failures\n", g_Failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_k41_sched : OK\n");
+    return EXIT_SUCCESS;
+}
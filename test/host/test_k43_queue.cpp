@@ -0,0 +1,132 @@
+/*
+ * K43 블록 디스크립터 큐 테스트
+ *
+ * 1. 단일 스레드 : 가득 찬 큐의 push 실패, count, head/tail 32비트 인덱스 wrap-around
+ * 2. 두 스레드 스트레스 : 생산자/소비자를 pthread로 실행하여 2M 디스크립터를 순서, 손실, 중복 없이 전달하는지 확인
+ *    - 소비자가 주기적으로 멈춰 큐가 가득 차는 역압(backpressure) 구간을 만듭니다.
+ *    - 인덱스를 UINT32_MAX 근처에서 시작하여 스트레스 중에도 카운터 wrap-around를 지나게 합니다.
+ */
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include "K43_block_queue_001.h"
+
+#define TEST_DESCRIPTORS        2000000
+#define TEST_STALL_EVERY        50000      // 소비자가 이 개수마다 멈춤 (큐가 가득 차도록)
+#define TEST_STALL_US           2000
+
+static int g_Failures = 0;
+
+#define CHECK(cond, ...)                                                 \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            fprintf(stderr, "FAIL %s:%d : %s : ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                \
+            fprintf(stderr, "\n");                                       \
+            g_Failures++;                                                \
+        }                                                                \
+    } while (0)
+
+static K43_BLOCK_QUEUE_t g_Queue;
+
+// 순번 n의 디스크립터 (모든 필드로 순번을 복원할 수 있게)
+static K43_BLOCK_DESC_t make_desc(uint32_t n) {
+    K43_BLOCK_DESC_t d;
+    d.offset = n;
+    d.words  = (uint16_t)(n * 2654435761u >> 16);
+    d.flags  = (uint16_t)(n >> 16);
+    return d;
+}
+
+static bool same_desc(const K43_BLOCK_DESC_t& a, const K43_BLOCK_DESC_t& b) {
+    return (a.offset == b.offset) && (a.words == b.words) && (a.flags == b.flags);
+}
+
+static void queue_reset(uint32_t start) {
+    g_Queue.head.store(start);
+    g_Queue.tail.store(start);
+}
+
+// 1. 단일 스레드 : 가득 참, wrap-around
+static void test_single_thread() {
+    K43_BLOCK_DESC_t d;
+    queue_reset(0xFFFFFFF0u);    // 채우는 중에 head가 0으로 넘어감
+    CHECK(!K43_queue_peek(g_Queue, d), "empty queue returned a descriptor");
+    for (uint32_t n = 0; n < G_K43_QUEUE_SIZE; n++) {
+        CHECK(K43_queue_push(g_Queue, make_desc(n)), "push %u failed", n);
+    }
+    CHECK(K43_queue_count(g_Queue) == G_K43_QUEUE_SIZE, "count %u", K43_queue_count(g_Queue));
+    CHECK(!K43_queue_push(g_Queue, make_desc(999)), "push into a full queue succeeded");
+    for (uint32_t n = 0; n < 3 * G_K43_QUEUE_SIZE; n++) {
+        CHECK(K43_queue_peek(g_Queue, d) && same_desc(d, make_desc(n)), "descriptor %u", n);
+        K43_queue_pop(g_Queue);
+        CHECK(K43_queue_push(g_Queue, make_desc(n + G_K43_QUEUE_SIZE)), "push %u after pop failed", n + G_K43_QUEUE_SIZE);
+    }
+    K43_queue_drain(g_Queue);
+    CHECK(K43_queue_count(g_Queue) == 0, "count after drain %u", K43_queue_count(g_Queue));
+    CHECK(!K43_queue_peek(g_Queue, d), "drained queue returned a descriptor");
+}
+
+// 2. 두 스레드 스트레스
+static void test_two_threads() {
+    queue_reset(0xFFFFFFFFu - TEST_DESCRIPTORS / 2);    // 중간에 인덱스 wrap-around
+    uint32_t fullStalls = 0;
+    uint32_t received   = 0;
+    uint32_t errors     = 0;
+
+    std::thread producer([&]() {
+        for (uint32_t n = 0; n < TEST_DESCRIPTORS; n++) {
+            K43_BLOCK_DESC_t d = make_desc(n);
+            while (!K43_queue_push(g_Queue, d)) {
+                fullStalls++;    // 가득 참 : K40_INA226_push_block처럼 양보 후 재시도
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&]() {
+        K43_BLOCK_DESC_t d;
+        while (received < TEST_DESCRIPTORS) {
+            if (!K43_queue_peek(g_Queue, d)) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (!same_desc(d, make_desc(received))) {
+                if (errors++ < 10) {
+                    fprintf(stderr, "descriptor %u : got offset %u words %u flags %u\n", received, d.offset, d.words, d.flags);
+                }
+                received = d.offset;    // 이후 순서 확인을 계속
+            }
+            K43_queue_pop(g_Queue);
+            received++;
+            if ((received % TEST_STALL_EVERY) == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(TEST_STALL_US));    // 전송 지연 흉내
+            }
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    K43_BLOCK_DESC_t d;
+    printf("%u descriptors through %u slots, %u full-queue retries, %u errors\n", received, G_K43_QUEUE_SIZE, fullStalls, errors);
+    CHECK(errors == 0, "%u out of order, lost or duplicated descriptors", errors);
+    CHECK(received == TEST_DESCRIPTORS, "received %u", received);
+    CHECK(fullStalls > 0, "queue never filled, backpressure not exercised");
+    CHECK(!K43_queue_peek(g_Queue, d) && (K43_queue_count(g_Queue) == 0), "queue not empty at the end");
+}
+
+int main() {
+    test_single_thread();
+    test_two_threads();
+    if (g_Failures != 0) {
+        printf("test_k43_queue : %d failures\n", g_Failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_k43_queue : OK\n");
+    return EXIT_SUCCESS;
+}
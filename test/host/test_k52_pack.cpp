@@ -0,0 +1,242 @@
+/*
+ * K52 압축 저장 코덱 테스트
+ *
+ * 1. 왕복 : 블록 크기의 배수가 아닌 랜덤 워크 샘플을 압축한 뒤 전송 스트림 복원과 K52_INA226_read_sample()로 모두 일치하는지 확인
+ * 2. 비트 폭 0 (블록 안에서 값이 변하지 않음, 델타 워드 없음) 과 17 (-32768 <-> 32767 교대)
+ * 3. 범위 전환 레코드 [MSG_TX_RANGE, scale, blank]가 블록 사이에 섞인 스트림 (게이트 캡처와 같은 기록 순서)
+ * 4. 인덱스 탐색 경계 : 음수, 기록한 샘플 수 이상, 아직 기록하지 않은 채우는 블록의 샘플
+ * 5. 공간 확인 : pack_room()이 true인 동안만 기록하면 블록이 인덱스 영역을 침범하지 않음
+ *
+ * 스트림 복원은 코덱 함수를 쓰지 않고 블록 형식(모듈 주석)대로 따로 구현하여 형식 자체를 확인합니다. (클라이언트 unpack_deltas와 같은 방식)
+ */
+
+#include <Arduino.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "K52_ina226_pack_001.h"
+
+#define TEST_MSG_TX_RANGE       2224       // K40 G_K40_INA226_MSG_TX_RANGE
+#define TEST_BUFFER_WORDS       (64 * 1024)
+#define TEST_HDR_WORDS          4          // 게이트 캡처의 압축 시작 헤더 [MSG_TX_START_PACKED, periodUs, scale, blockSamples]
+
+static int g_Failures = 0;
+
+#define CHECK(cond, ...)                                                 \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            fprintf(stderr, "FAIL %s:%d : %s : ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                \
+            fprintf(stderr, "\n");                                       \
+            g_Failures++;                                                \
+        }                                                                \
+    } while (0)
+
+static int16_t g_Buffer[TEST_BUFFER_WORDS];
+
+struct SAMPLES_t {
+    std::vector<int16_t> shunt;
+    std::vector<int16_t> bus;
+    std::vector<int>     ranges;    // 범위 레코드 뒤 첫 샘플 번호
+};
+
+// 채널 델타 복원 (LSB부터, 채널마다 워드 경계에서 시작)
+static int stream_channel(const int16_t* in, int16_t first, int n, int width, std::vector<int16_t>& out) {
+    out.push_back(first);
+    int      words = 0;
+    int      bits  = 0;
+    uint64_t acc   = 0;
+    int16_t  x     = first;
+    for (int k = 1; k < n; k++) {
+        uint32_t z = 0;
+        if (width > 0) {
+            while (bits < width) {
+                acc |= (uint64_t)(uint16_t)in[words++] << bits;
+                bits += 16;
+            }
+            z = (uint32_t)(acc & ((1u << width) - 1));
+            acc >>= width;
+            bits -= width;
+        }
+        int32_t d = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+        x         = (int16_t)(x + d);
+        out.push_back(x);
+    }
+    return words;
+}
+
+// 전송 스트림 복원 (압축 블록과 범위 레코드)
+static bool stream_decode(int from, int to, SAMPLES_t& out) {
+    int w = from;
+    while (w < to) {
+        if (g_Buffer[w] == TEST_MSG_TX_RANGE) {
+            out.ranges.push_back((int)out.shunt.size());
+            w += 3;
+            continue;
+        }
+        if (g_Buffer[w] != G_K52_MSG_TX_PACKED) {
+            fprintf(stderr, "word %d : unexpected message %d\n", w, g_Buffer[w]);
+            return false;
+        }
+        int n  = g_Buffer[w + 1];
+        int ws = g_Buffer[w + 2] & 0xFF;
+        int wv = (g_Buffer[w + 2] >> 8) & 0xFF;
+        if ((n < 1) || (n > G_K52_BLOCK_SAMPLES) || (ws > G_K52_MAX_WIDTH) || (wv > G_K52_MAX_WIDTH)) {
+            fprintf(stderr, "word %d : bad block header n %d widths %d %d\n", w, n, ws, wv);
+            return false;
+        }
+        int words = G_K52_HDR_WORDS;
+        words += stream_channel(g_Buffer + w + words, g_Buffer[w + 3], n, ws, out.shunt);
+        words += stream_channel(g_Buffer + w + words, g_Buffer[w + 4], n, wv, out.bus);
+        w += words;
+    }
+    return w == to;
+}
+
+static void pack_start(K52_PACK_t& p) {
+    memset(g_Buffer, 0x5A, sizeof(g_Buffer));
+    K52_INA226_pack_begin(p, g_Buffer, TEST_HDR_WORDS, TEST_BUFFER_WORDS);
+}
+
+// 스트림 복원과 임의 접근이 원본과 같은지 확인
+static void check_samples(const char* name, const K52_PACK_t& p, const SAMPLES_t& in) {
+    SAMPLES_t out;
+    CHECK(stream_decode(TEST_HDR_WORDS, p.w, out), "%s : stream decode failed", name);
+    CHECK(out.shunt.size() == in.shunt.size(), "%s : %zu samples decoded, %zu written", name, out.shunt.size(), in.shunt.size());
+    CHECK(out.ranges == in.ranges, "%s : range records at different samples", name);
+    CHECK(p.nSamples == (int)in.shunt.size(), "%s : nSamples %d", name, p.nSamples);
+    int bad = 0;
+    for (size_t k = 0; (k < in.shunt.size()) && (k < out.shunt.size()); k++) {
+        int16_t s = 0, v = 0;
+        bool    ok = K52_INA226_read_sample(p, (int)k, s, v);
+        if ((out.shunt[k] != in.shunt[k]) || (out.bus[k] != in.bus[k]) || !ok || (s != in.shunt[k]) || (v != in.bus[k])) {
+            if (bad++ < 5) {
+                fprintf(stderr, "%s : sample %zu wrote (%d, %d) stream (%d, %d) read_sample %d (%d, %d)\n", name, k, in.shunt[k], in.bus[k],
+                        out.shunt[k], out.bus[k], ok, s, v);
+            }
+        }
+    }
+    CHECK(bad == 0, "%s : %d samples differ", name, bad);
+}
+
+static void add(K52_PACK_t& p, SAMPLES_t& in, int16_t s, int16_t v) {
+    K52_INA226_pack_add(p, s, v);
+    in.shunt.push_back(s);
+    in.bus.push_back(v);
+}
+
+// 1. 랜덤 워크 왕복
+static void test_round_trip() {
+    K52_PACK_t& p = g_K52_Pack;
+    SAMPLES_t   in;
+    pack_start(p);
+    srand(1);
+    int16_t s = 0, v = 9600;
+    for (int k = 0; k < 10 * G_K52_BLOCK_SAMPLES + 37; k++) {
+        s = (int16_t)(s + (rand() % 201) - 100);
+        v = (int16_t)(v + (rand() % 3) - 1);
+        add(p, in, s, v);
+    }
+    K52_INA226_pack_flush(p);
+    CHECK(p.nBlocks == 11, "round trip : %d blocks", p.nBlocks);
+    check_samples("round trip", p, in);
+    printf("round trip : %zu samples in %d words (%.2f bits/sample pair)\n", in.shunt.size(), p.w - TEST_HDR_WORDS,
+           16.0f * (p.w - TEST_HDR_WORDS) / in.shunt.size());
+}
+
+// 2. 비트 폭 0과 17
+static void test_widths() {
+    K52_PACK_t& p = g_K52_Pack;
+    SAMPLES_t   in;
+    pack_start(p);
+    for (int k = 0; k < G_K52_BLOCK_SAMPLES; k++) {
+        add(p, in, -1234, 9600);    // 변하지 않음 : 두 채널 모두 폭 0
+    }
+    CHECK(g_Buffer[TEST_HDR_WORDS + 2] == 0, "constant block widths 0x%04X", (uint16_t)g_Buffer[TEST_HDR_WORDS + 2]);
+    CHECK(p.w == TEST_HDR_WORDS + G_K52_HDR_WORDS, "constant block %d words", p.w - TEST_HDR_WORDS);
+
+    int block = p.w;
+    for (int k = 0; k < G_K52_BLOCK_SAMPLES; k++) {
+        add(p, in, (k & 1) ? 32767 : -32768, (k & 1) ? -32768 : 32767);    // 델타 ±65535 : 두 채널 모두 폭 17
+    }
+    CHECK(g_Buffer[block + 2] == (G_K52_MAX_WIDTH | (G_K52_MAX_WIDTH << 8)), "full-scale block widths 0x%04X", (uint16_t)g_Buffer[block + 2]);
+    CHECK(p.w - block == G_K52_MAX_BLOCK_WORDS, "full-scale block %d words, worst case %d", p.w - block, G_K52_MAX_BLOCK_WORDS);
+
+    add(p, in, 5, 5);    // 샘플 하나뿐인 블록 (델타 없음)
+    K52_INA226_pack_flush(p);
+    check_samples("widths", p, in);
+}
+
+// 3. 범위 레코드가 섞인 스트림 (게이트 캡처 : 전환 시 flush 후 레코드 기록)
+static void test_range_records() {
+    K52_PACK_t& p = g_K52_Pack;
+    SAMPLES_t   in;
+    pack_start(p);
+    srand(2);
+    for (int k = 0; k < 1000; k++) {
+        add(p, in, (int16_t)(rand() % 4000 - 2000), (int16_t)(12000 + rand() % 5));
+        if ((k % 173) == 172) {
+            K52_INA226_pack_flush(p);
+            g_Buffer[p.w]     = TEST_MSG_TX_RANGE;
+            g_Buffer[p.w + 1] = (int16_t)(k & 1);
+            g_Buffer[p.w + 2] = 2;
+            p.w += 3;
+            in.ranges.push_back((int)in.shunt.size());
+        }
+    }
+    K52_INA226_pack_flush(p);
+    CHECK(in.ranges.size() == 5, "%zu range records", in.ranges.size());
+    check_samples("range records", p, in);
+}
+
+// 4. 인덱스 탐색 경계
+static void test_read_bounds() {
+    K52_PACK_t& p = g_K52_Pack;
+    SAMPLES_t   in;
+    pack_start(p);
+    int16_t s, v;
+    CHECK(!K52_INA226_read_sample(p, 0, s, v), "read from an empty pack succeeded");
+    for (int k = 0; k < 2 * G_K52_BLOCK_SAMPLES + 10; k++) {
+        add(p, in, (int16_t)k, (int16_t)-k);
+    }
+    CHECK(p.nSamples == 2 * G_K52_BLOCK_SAMPLES, "nSamples %d before flush", p.nSamples);
+    CHECK(!K52_INA226_read_sample(p, -1, s, v), "read of sample -1 succeeded");
+    CHECK(!K52_INA226_read_sample(p, 2 * G_K52_BLOCK_SAMPLES, s, v), "read of an unflushed sample succeeded");
+    CHECK(K52_INA226_read_sample(p, G_K52_BLOCK_SAMPLES - 1, s, v) && (s == G_K52_BLOCK_SAMPLES - 1), "last sample of block 0 : %d", s);
+    CHECK(K52_INA226_read_sample(p, G_K52_BLOCK_SAMPLES, s, v) && (s == G_K52_BLOCK_SAMPLES), "first sample of block 1 : %d", s);
+    K52_INA226_pack_flush(p);
+    CHECK(K52_INA226_read_sample(p, 2 * G_K52_BLOCK_SAMPLES + 9, s, v) && (s == 2 * G_K52_BLOCK_SAMPLES + 9) && (v == -s),
+          "last sample after flush : %d %d", s, v);
+    CHECK(!K52_INA226_read_sample(p, 2 * G_K52_BLOCK_SAMPLES + 10, s, v), "read past the last sample succeeded");
+}
+
+// 5. 공간 확인 : 최악의 블록만 기록해도 인덱스 영역을 침범하지 않음
+static void test_room() {
+    K52_PACK_t& p = g_K52_Pack;
+    SAMPLES_t   in;
+    pack_start(p);
+    int k = 0;
+    while (K52_INA226_pack_room(p)) {
+        add(p, in, (k & 1) ? 32767 : -32768, (k & 1) ? -32768 : 32767);
+        k++;
+    }
+    K52_INA226_pack_flush(p);
+    int indexBottom = TEST_BUFFER_WORDS - G_K52_INDEX_WORDS * p.nBlocks;
+    CHECK(p.w <= indexBottom, "blocks end at %d, index starts at %d", p.w, indexBottom);
+    check_samples("room", p, in);
+}
+
+int main() {
+    test_round_trip();
+    test_widths();
+    test_range_records();
+    test_read_bounds();
+    test_room();
+    if (g_Failures != 0) {
+        printf("test_k52_pack : %d failures\n", g_Failures);
+        return EXIT_FAILURE;
+    }
+    printf("test_k52_pack : OK\n");
+    return EXIT_SUCCESS;
+}